@@ -34,6 +34,9 @@ int link(const char *oldpath, const char *newpath);
 int mkdir(const char *pathname);
 int rmdir(const char *pathname);
 
+/* 批量解析路径并加入目录项缓存，exist不为nullptr时返回每个路径是否存在 */
+int lookup_paths(const char *const pathnames[], size_t num, bool exist[] = nullptr);
+
 int init(int argc, char *argv[]);
 void fini();
 
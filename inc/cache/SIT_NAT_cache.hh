@@ -9,10 +9,11 @@ struct hscfs_nat_block;
 
 namespace hscfs {
 
-class SIT_NAT_cache_entry
+/* 继承replacer_hook，供侵入式的clock_replacer使用 */
+class SIT_NAT_cache_entry: public replacer_hook<uint32_t>
 {
 public:
-    SIT_NAT_cache_entry(uint32_t lpa) {
+    SIT_NAT_cache_entry(uint32_t lpa) : cache(false) {
         lpa_ = lpa;
         ref_count = 0;
     }
@@ -133,8 +134,22 @@ public:
         sub_refcount(p);
     }
 
+    /* 
+     * 获取lpa对应缓存项当前的引用计数(句柄数与未被SSD确认的主机侧版本数之和)
+     * lpa未被缓存时返回0，不会从SSD读取，也不视为一次访问
+     */
+    uint32_t get_refcount(uint32_t lpa)
+    {
+        SIT_NAT_cache_entry *p = cache_manager.get(lpa, false);
+        return p == nullptr ? 0 : p->ref_count;
+    }
+
 private:
-    generic_cache_manager<uint32_t, SIT_NAT_cache_entry> cache_manager;
+    /* 
+     * SIT/NAT块对应一段连续的segment/nid，访问局部性好，用CLOCK近似lru即可
+     * 每次分配LPA、查找NAT都会访问此缓存，使用无逐项内存分配的开放寻址索引和侵入式置换器
+     */
+    generic_cache_manager<uint32_t, SIT_NAT_cache_entry, open_addressing_index, clock_replacer> cache_manager;
     size_t expect_size, cur_size;
     comm_dev *dev;
 
@@ -156,7 +171,7 @@ private:
     {
         ++entry->ref_count;
         if (entry->ref_count == 1)
-            cache_manager.pin(entry->lpa_);
+            cache_manager.pin(entry->lpa_, entry);
     }
 
     /*
@@ -168,7 +183,7 @@ private:
         --entry->ref_count;
         if (entry->ref_count == 0)
         {
-            cache_manager.unpin(entry->lpa_);
+            cache_manager.unpin(entry->lpa_, entry);
             do_replace();
         }
     }
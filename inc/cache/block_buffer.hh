@@ -3,16 +3,24 @@
 #include "utils/declare_utils.hh"
 #include "communication/comm_api.h"
 #include <cstdint>
+#include <cstddef>
 
 struct comm_dev;
 
 namespace hscfs {
 
-/* 块缓存区的容器，构造时分配4KB块缓存区，析构时释放 */
+/* 
+ * 块缓存区的容器，构造时从dma_block_pool分配4KB块缓存区，析构时归还
+ * 默认将块清零；随后会用读取或拷贝的内容覆盖整个块时，以zero_fill = false构造，省去清零
+ */
 class block_buffer
 {
 public:
-    block_buffer();
+    block_buffer() : block_buffer(true) {}
+    explicit block_buffer(bool zero_fill);
+
+    /* 构造不持有块缓存区的空对象，之后按需调用alloc分配 */
+    explicit block_buffer(std::nullptr_t) noexcept : buffer(nullptr) {}
     block_buffer(const block_buffer&);
     block_buffer(block_buffer&&) noexcept;
     block_buffer &operator=(const block_buffer&);
@@ -29,6 +37,9 @@ public:
     /* 从SSD读lpa到buffer中，同步，完成读操作后返回 */
     void read_from_lpa(comm_dev *dev, uint32_t lpa);
 
+    /* 从SSD读lpa到buffer中，异步，立刻返回 */
+    void read_from_lpa_async(comm_dev *dev, uint32_t lpa, comm_async_cb_func cb_func, void *cb_arg);
+
     /* 把buffer中的内容写入lpa，同步，完成写操作后返回 */
     void write_to_lpa_sync(comm_dev *dev, uint32_t lpa);
 
@@ -40,6 +51,17 @@ public:
         return buffer;
     }
 
+    bool is_empty() const noexcept
+    {
+        return buffer == nullptr;
+    }
+
+    /* 为空对象分配块缓存区，zero_fill为true时清零 */
+    void alloc(bool zero_fill);
+
+    /* 将块缓存区归还dma_block_pool，之后成为空对象 */
+    void release() noexcept;
+
 private:
     char *buffer;
 };
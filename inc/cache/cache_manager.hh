@@ -7,6 +7,10 @@
 #include <memory>
 #include <system_error>
 #include <cassert>
+#include <algorithm>
+#include <vector>
+#include <type_traits>
+#include <cstdint>
 
 // #include "utils/hscfs_multithread.h"
 // #include "utils/lock_guards.hh"
@@ -34,7 +38,7 @@ public:
     void add(const key_t &key, std::unique_ptr<entry_t> &&p_entry)
     {
         assert(index.count(key) == 0);
-        index.emplace(key, p_entry);
+        index.emplace(key, std::move(p_entry));
     }
 
     std::unique_ptr<entry_t> remove(const key_t &key)
@@ -47,9 +51,10 @@ public:
 
     entry_t *get(const key_t &key)
     {
-        if (index.count(key) == 0)
+        auto itr = index.find(key);
+        if (itr == index.end())
             return nullptr;
-        return index[key].get();
+        return itr->second.get();
     }
 
     iterator_t begin()
@@ -71,6 +76,204 @@ private:
     std::unordered_map<key_t, std::unique_ptr<entry_t>> index;
 };
 
+/*
+ * 开放寻址缓存索引(线性探测)
+ * 接口与cache_hash_index相同，当缓存项添加到索引后，由索引获得其所有权
+ * 
+ * 所有槽保存在连续数组中，没有逐项的结点分配，查找时只计算一次hash，然后沿数组顺序探测
+ * 删除时将槽标记为墓碑，不移动其它槽，所以remove和erase不会使其它迭代器失效
+ * add可能触发重建，会使所有迭代器失效(与unordered_map的rehash相同)
+ */
+template <typename key_t, typename entry_t>
+class open_addressing_index
+{
+private:
+    enum class slot_state : uint8_t
+    {
+        empty,
+        used,
+        deleted
+    };
+
+    using slot_t = std::pair<key_t, std::unique_ptr<entry_t>>;
+
+public:
+    class iterator_t
+    {
+    public:
+        iterator_t(open_addressing_index *index, size_t pos) noexcept
+        {
+            this->index = index;
+            this->pos = pos;
+        }
+
+        slot_t& operator*() const noexcept
+        {
+            return index->slots[pos];
+        }
+
+        slot_t* operator->() const noexcept
+        {
+            return &index->slots[pos];
+        }
+
+        iterator_t& operator++() noexcept
+        {
+            pos = index->next_used(pos + 1);
+            return *this;
+        }
+
+        iterator_t& operator--() noexcept
+        {
+            do
+                --pos;
+            while (index->states[pos] != slot_state::used);
+            return *this;
+        }
+
+        bool operator==(const iterator_t &o) const noexcept
+        {
+            return index == o.index && pos == o.pos;
+        }
+
+        bool operator!=(const iterator_t &o) const noexcept
+        {
+            return !(*this == o);
+        }
+
+    private:
+        open_addressing_index *index;
+        size_t pos;
+
+        friend class open_addressing_index;
+    };
+
+public:
+    open_addressing_index()
+        : slots(init_capacity), states(init_capacity, slot_state::empty)
+    {
+        used_num = deleted_num = 0;
+    }
+
+    void add(const key_t &key, std::unique_ptr<entry_t> &p_entry)
+    {
+        add(key, std::move(p_entry));
+    }
+
+    void add(const key_t &key, std::unique_ptr<entry_t> &&p_entry)
+    {
+        assert(find_pos(key) == npos);
+        if ((used_num + deleted_num + 1) * 2 > slots.size())
+            rebuild(used_num * 4 > slots.size() ? slots.size() * 2 : slots.size());
+
+        /* key不在索引中，可以直接复用探测路径上的第一个墓碑 */
+        size_t mask = slots.size() - 1;
+        size_t pos = hash_pos(key);
+        while (states[pos] == slot_state::used)
+            pos = (pos + 1) & mask;
+        if (states[pos] == slot_state::deleted)
+            --deleted_num;
+        states[pos] = slot_state::used;
+        slots[pos].first = key;
+        slots[pos].second = std::move(p_entry);
+        ++used_num;
+    }
+
+    std::unique_ptr<entry_t> remove(const key_t &key)
+    {
+        size_t pos = find_pos(key);
+        assert(pos != npos);
+        std::unique_ptr<entry_t> ret = std::move(slots[pos].second);
+        release_slot(pos);
+        return ret;
+    }
+
+    entry_t *get(const key_t &key)
+    {
+        size_t pos = find_pos(key);
+        if (pos == npos)
+            return nullptr;
+        return slots[pos].second.get();
+    }
+
+    iterator_t begin()
+    {
+        return iterator_t(this, next_used(0));
+    }
+
+    iterator_t end()
+    {
+        return iterator_t(this, slots.size());
+    }
+
+    iterator_t erase(const iterator_t pos)
+    {
+        slots[pos.pos].second.reset();
+        release_slot(pos.pos);
+        return iterator_t(this, next_used(pos.pos + 1));
+    }
+
+private:
+    std::vector<slot_t> slots;  // 槽数组，大小为2的幂
+    std::vector<slot_state> states;
+    size_t used_num, deleted_num;
+
+    static constexpr size_t init_capacity = 16;
+    static constexpr size_t npos = SIZE_MAX;
+
+    /* 对std::hash的结果再做一次乘法散列，防止整数key的恒等hash在线性探测下形成聚集 */
+    size_t hash_pos(const key_t &key) const noexcept
+    {
+        uint64_t h = static_cast<uint64_t>(std::hash<key_t>()(key)) * 0x9E3779B97F4A7C15ULL;
+        return static_cast<size_t>(h >> 32) & (slots.size() - 1);
+    }
+
+    size_t find_pos(const key_t &key) const
+    {
+        size_t mask = slots.size() - 1;
+        size_t pos = hash_pos(key);
+        while (states[pos] != slot_state::empty)
+        {
+            if (states[pos] == slot_state::used && slots[pos].first == key)
+                return pos;
+            pos = (pos + 1) & mask;
+        }
+        return npos;
+    }
+
+    /* 释放一个已使用的槽。如果下一个槽为空，则探测链在此结束，不需要留下墓碑 */
+    void release_slot(size_t pos)
+    {
+        size_t mask = slots.size() - 1;
+        states[pos] = states[(pos + 1) & mask] == slot_state::empty ? slot_state::empty : slot_state::deleted;
+        if (states[pos] == slot_state::deleted)
+            ++deleted_num;
+        --used_num;
+    }
+
+    size_t next_used(size_t pos) const noexcept
+    {
+        while (pos < slots.size() && states[pos] != slot_state::used)
+            ++pos;
+        return pos;
+    }
+
+    /* 以new_capacity重建槽数组，清除所有墓碑 */
+    void rebuild(size_t new_capacity)
+    {
+        std::vector<slot_t> old_slots(new_capacity);
+        std::vector<slot_state> old_states(new_capacity, slot_state::empty);
+        old_slots.swap(slots);
+        old_states.swap(states);
+        used_num = deleted_num = 0;
+        for (size_t i = 0; i < old_slots.size(); ++i)
+        {
+            if (old_states[i] == slot_state::used)
+                add(old_slots[i].first, std::move(old_slots[i].second));
+        }
+    }
+};
+
 /*
  * 缓存lru置换器
  * 使用缓存项的key代表缓存项
@@ -190,6 +393,337 @@ private:
     }
 };
 
+/*
+ * 缓存2Q置换器(抗扫描)
+ * 使用缓存项的key代表缓存项
+ * 
+ * 缓存项分别位于两个队列：
+ * a1in：首次加入的缓存项，FIFO，在a1in中的再次访问不会使其晋升(过滤短时间内的相关访问，如顺序读同一块的多次读)
+ * am：在a1in中被置换后，又在短时间内再次加入的缓存项，lru
+ * 被置换出a1in的key记录在幽灵队列a1out中(只记录key，不持有缓存项)，再次加入时若命中a1out，则直接进入am
+ * 
+ * 一次扫描加入的缓存项只会在a1in中停留，然后被优先置换，不会冲刷am中的热点缓存项
+ * 由于replacer不知道缓存容量，a1in的目标大小按当前缓存项总数的比例确定，
+ * a1out的容量按缓存项总数的历史最大值的比例确定(缓存项被大量手动移除后，仍能记住之前置换的key)
+ */
+template <typename key_t>
+class two_queue_replacer
+{
+public:
+    /* 
+     * 将key加入置换器
+     * 默认key可进行置换
+     */
+    void add(const key_t &key)
+    {
+        assert(key_states.count(key) == 0);
+        auto ghost = a1out_pos.find(key);
+        queue_type q = queue_type::a1in;
+        if (ghost != a1out_pos.end())
+        {
+            a1out.erase(ghost->second);
+            a1out_pos.erase(ghost);
+            q = queue_type::am;
+        }
+        key_state &state = key_states[key];
+        max_key_num = std::max(max_key_num, key_states.size());
+        state.q = q;
+        state.pinned = false;
+        add_to_list_tail(unpinned_list(q), key, state);
+        ++queue_size[static_cast<int>(q)];
+    }
+
+    /* 返回可以被置换的缓存项数目 */
+    size_t get_num_can_replace()
+    {
+        return a1in_list.size() + am_list.size();
+    }
+
+    /* 
+     * 进行置换，返回应当被置换的key
+     * a1in超过目标大小时(或am中没有可置换的缓存项时)从a1in置换，并将key记录到a1out，否则从am置换
+     */
+    key_t pop_replaced()
+    {
+        assert(get_num_can_replace() != 0);
+        size_t a1in_target = std::max<size_t>(key_states.size() * a1in_ratio_percent / 100, 1);
+        bool from_a1in = !a1in_list.empty() 
+            && (queue_size[static_cast<int>(queue_type::a1in)] > a1in_target || am_list.empty());
+        std::list<key_t> &ls = from_a1in ? a1in_list : am_list;
+        
+        key_t key = ls.front();
+        assert(key_states.at(key).pinned == false);
+        ls.pop_front();
+        --queue_size[static_cast<int>(key_states.at(key).q)];
+        key_states.erase(key);
+        if (from_a1in)
+            add_to_a1out(key);
+        return key;
+    }
+
+    /* 
+     * 锁住key，让其不能被置换
+     * 如果已经被锁住，什么也不做
+     */
+    void pin(const key_t &key)
+    {
+        auto &state = key_states.at(key);
+        if (state.pinned)
+            return;
+        state.pinned = true;
+        unpinned_list(state.q).erase(state.itr);
+        add_to_list_tail(pinned_list, key, state);
+    }
+
+    /*
+     * 解锁key，使其可以被置换
+     * 解锁后放置到所在队列的队尾
+     * 如果没有被锁住，什么都不做
+     */
+    void unpin(const key_t &key)
+    {
+        auto &state = key_states.at(key);
+        if (!state.pinned)
+            return;
+        state.pinned = false;
+        pinned_list.erase(state.itr);
+        add_to_list_tail(unpinned_list(state.q), key, state);
+    }
+
+    /* 
+     * 告知replacer对key进行了一次访问
+     * 只有am中未被pin住的key会移到队尾
+     */
+    void access(const key_t &key)
+    {
+        assert(key_states.count(key) == 1);
+        auto &state = key_states.at(key);
+        if (state.pinned || state.q == queue_type::a1in)
+            return;
+        am_list.erase(state.itr);
+        add_to_list_tail(am_list, key, state);
+    }
+
+    /* 手动移除key，无论是否被pin住。手动移除的key不记录到a1out */
+    void remove(const key_t &key)
+    {
+        assert(key_states.count(key) == 1);
+        auto &state = key_states.at(key);
+        if (state.pinned)
+            pinned_list.erase(state.itr);
+        else
+            unpinned_list(state.q).erase(state.itr);
+        --queue_size[static_cast<int>(state.q)];
+        key_states.erase(key);
+    }
+
+private:
+    enum class queue_type
+    {
+        a1in = 0,
+        am = 1
+    };
+
+    using list_iterator_t = typename std::list<key_t>::iterator;
+
+    struct key_state
+    {
+        queue_type q;  // key所属的队列
+        bool pinned;  // 为true则被pin住，此时itr指向pinned_list中的元素，否则指向q对应队列的链表中的元素
+        list_iterator_t itr;
+    };
+
+    /* a1in与am中未被pin住的key，首元素为最先被置换的key */
+    std::list<key_t> a1in_list, am_list;
+    std::list<key_t> pinned_list;
+    size_t queue_size[2] = {0, 0};  // a1in与am中key的数目(包括被pin住的)
+    std::unordered_map<key_t, key_state> key_states;
+    size_t max_key_num = 0;  // key_states大小的历史最大值
+
+    /* 幽灵队列，首元素为最早记录的key */
+    std::list<key_t> a1out;
+    std::unordered_map<key_t, list_iterator_t> a1out_pos;
+
+    /* a1in的目标大小，与a1out的容量，占缓存项总数的百分比(参考2Q论文中Kin = 25%，Kout = 50%) */
+    static constexpr size_t a1in_ratio_percent = 25;
+    static constexpr size_t a1out_ratio_percent = 50;
+
+    std::list<key_t> &unpinned_list(queue_type q)
+    {
+        return q == queue_type::a1in ? a1in_list : am_list;
+    }
+
+    void add_to_list_tail(std::list<key_t> &ls, const key_t &key, key_state &state)
+    {
+        ls.emplace_back(key);
+        state.itr = --ls.end();
+    }
+
+    void add_to_a1out(const key_t &key)
+    {
+        assert(a1out_pos.count(key) == 0);
+        a1out.emplace_back(key);
+        a1out_pos[key] = --a1out.end();
+        size_t a1out_cap = std::max<size_t>(max_key_num * a1out_ratio_percent / 100, 1);
+        while (a1out.size() > a1out_cap)
+        {
+            a1out_pos.erase(a1out.front());
+            a1out.pop_front();
+        }
+    }
+};
+
+/*
+ * 侵入式置换器的钩子，使用侵入式置换器的缓存项需要继承此结构
+ * 置换器的链表指针和状态保存在缓存项中，置换器本身不分配任何内存
+ * replacer_key由generic_cache_manager在加入缓存项时设置，用于返回被置换的key
+ */
+template <typename key_t>
+struct replacer_hook
+{
+    replacer_hook *prev = nullptr, *next = nullptr;
+    key_t replacer_key;
+    bool pinned = false;
+    bool referenced = false;
+};
+
+/*
+ * 侵入式CLOCK置换器，近似lru
+ * 与lru_replacer不同，置换器以缓存项中的钩子(replacer_hook)标识缓存项，定义了hook_t类型，接口为：
+ * void add(const key_t &key, hook_t *hook);
+ * size_t get_num_can_replace();
+ * key_t pop_replaced();
+ * void pin(hook_t *hook);
+ * void unpin(hook_t *hook);
+ * void access(hook_t *hook);
+ * void remove(hook_t *hook);
+ * 
+ * 未被pin住的缓存项组成环形双向链表，访问只设置referenced位，不移动链表结点
+ * 置换时从时钟指针hand开始扫描，清除遇到的referenced位，置换第一个referenced位为0的缓存项
+ */
+template <typename key_t>
+class clock_replacer
+{
+public:
+    using hook_t = replacer_hook<key_t>;
+
+    /* 
+     * 将缓存项加入置换器
+     * 默认可进行置换
+     */
+    void add(const key_t &key, hook_t *hook)
+    {
+        hook->replacer_key = key;
+        hook->pinned = false;
+        hook->referenced = false;
+        link(hook);
+    }
+
+    /* 返回可以被置换的缓存项数目 */
+    size_t get_num_can_replace() const noexcept
+    {
+        return unpinned_num;
+    }
+
+    /* 进行置换，返回应当被置换的key */
+    key_t pop_replaced()
+    {
+        assert(hand != nullptr);
+        while (hand->referenced)
+        {
+            hand->referenced = false;
+            hand = hand->next;
+        }
+        hook_t *victim = hand;
+        unlink(victim);
+        return victim->replacer_key;
+    }
+
+    /* 
+     * 锁住缓存项，让其不能被置换
+     * 如果已经被锁住，什么也不做
+     */
+    void pin(hook_t *hook)
+    {
+        if (hook->pinned)
+            return;
+        hook->pinned = true;
+        unlink(hook);
+    }
+
+    /*
+     * 解锁缓存项，使其可以被置换
+     * unpin被视为一次访问
+     * 如果没有被锁住，什么都不做
+     */
+    void unpin(hook_t *hook)
+    {
+        if (!hook->pinned)
+            return;
+        hook->pinned = false;
+        hook->referenced = true;
+        link(hook);
+    }
+
+    /* 告知replacer对缓存项进行了一次访问 */
+    void access(hook_t *hook) noexcept
+    {
+        hook->referenced = true;
+    }
+
+    /* 手动移除缓存项，无论是否被pin住 */
+    void remove(hook_t *hook)
+    {
+        if (!hook->pinned)
+            unlink(hook);
+        hook->pinned = false;
+    }
+
+private:
+    hook_t *hand = nullptr;  // 时钟指针，为nullptr时没有可置换的缓存项
+    size_t unpinned_num = 0;
+
+    /* 将hook插入到hand之前，即最后被扫描到的位置 */
+    void link(hook_t *hook) noexcept
+    {
+        if (hand == nullptr)
+        {
+            hook->prev = hook->next = hook;
+            hand = hook;
+        }
+        else
+        {
+            hook->next = hand;
+            hook->prev = hand->prev;
+            hand->prev->next = hook;
+            hand->prev = hook;
+        }
+        ++unpinned_num;
+    }
+
+    void unlink(hook_t *hook) noexcept
+    {
+        if (hook->next == hook)
+            hand = nullptr;
+        else
+        {
+            if (hand == hook)
+                hand = hook->next;
+            hook->prev->next = hook->next;
+            hook->next->prev = hook->prev;
+        }
+        hook->prev = hook->next = nullptr;
+        --unpinned_num;
+    }
+};
+
+/* 定义了hook_t类型的置换器为侵入式置换器 */
+template <typename replacer_t, typename = void>
+struct is_intrusive_replacer: std::false_type {};
+
+template <typename replacer_t>
+struct is_intrusive_replacer<replacer_t, std::void_t<typename replacer_t::hook_t>>: std::true_type {};
+
 /*
  * 通用缓存管理器
  * 要求：
@@ -213,6 +747,7 @@ private:
  * void unpin(const key_t &key);
  * void access(const key_t &key);
  * void remove(const key_t &key);
+ * 也可以是侵入式置换器(见clock_replacer)，此时entry_t需要继承replacer_t<key_t>::hook_t
  */
 template <typename key_t, typename entry_t, 
     template <typename, typename> class index_t = cache_hash_index, 
@@ -226,14 +761,16 @@ public:
     /* 增加缓存项p_entry，并把该缓存项的所有权交给cache_manager */
     void add(const key_t &key, std::unique_ptr<entry_t> &p_entry)
     {
+        entry_t *entry = p_entry.get();
         index.add(key, p_entry);
-        replacer.add(key);
+        replacer_add(key, entry);
     }
 
     void add(const key_t &key, std::unique_ptr<entry_t> &&p_entry)
     {
+        entry_t *entry = p_entry.get();
         index.add(key, std::move(p_entry));
-        replacer.add(key);
+        replacer_add(key, entry);
     }
 
     /* 
@@ -245,20 +782,33 @@ public:
     {
         entry_t *ret = index.get(key);
         if (ret != nullptr && is_access)
-            replacer.access(key);
+            replacer.access(replacer_arg(key, ret));
         return ret;
     }
 
-    /* pin住缓存项，标识其不能被置换 */
+    /* 
+     * pin住缓存项，标识其不能被置换
+     * 调用者已持有缓存项时，应通过entry给出，侵入式置换器不必再查找索引(unpin、remove同理)
+     */
     void pin(const key_t &key)
     {
-        replacer.pin(key);
+        replacer.pin(replacer_arg(key));
+    }
+
+    void pin(const key_t &key, entry_t *entry)
+    {
+        replacer.pin(replacer_arg(key, entry));
     }
 
     /* unpin缓存项，使其可以被置换 */
     void unpin(const key_t &key)
     {
-        replacer.unpin(key);
+        replacer.unpin(replacer_arg(key));
+    }
+
+    void unpin(const key_t &key, entry_t *entry)
+    {
+        replacer.unpin(replacer_arg(key, entry));
     }
 
     /*
@@ -276,7 +826,14 @@ public:
     /* 手动移除缓存项，无论是否被pin住 */
     void remove(const key_t &key)
     {
-        replacer.remove(key);
+        replacer.remove(replacer_arg(key));
+        index.remove(key);
+    }
+
+    /* entry为key对应的缓存项，移除后被释放 */
+    void remove(const key_t &key, entry_t *entry)
+    {
+        replacer.remove(replacer_arg(key, entry));
         index.remove(key);
     }
 
@@ -292,15 +849,42 @@ public:
 
     iterator_t erase(const iterator_t pos)
     {
-        const key_t &key = pos->first;
-        replacer.remove(key);
+        replacer.remove(replacer_arg(pos->first, pos->second.get()));
         iterator_t ret = index.erase(pos);
         return ret;
     }
 
 private:
+    using replacer_type = replacer_t<key_t>;
+    static constexpr bool intrusive = is_intrusive_replacer<replacer_type>::value;
+
     index_t<key_t, entry_t> index;  // 缓存索引
-    replacer_t<key_t> replacer;  // 置换器
+    replacer_type replacer;  // 置换器
+
+    /* 
+     * 获取置换器接口的参数：非侵入式置换器以key标识缓存项，侵入式置换器以缓存项中的钩子标识缓存项
+     * 对于侵入式置换器，若调用者没有给出缓存项，则通过索引查找
+     */
+    decltype(auto) replacer_arg(const key_t &key, entry_t *entry = nullptr)
+    {
+        if constexpr (intrusive)
+        {
+            if (entry == nullptr)
+                entry = index.get(key);
+            assert(entry != nullptr);
+            return static_cast<typename replacer_type::hook_t*>(entry);
+        }
+        else
+            return key;
+    }
+
+    void replacer_add(const key_t &key, entry_t *entry)
+    {
+        if constexpr (intrusive)
+            replacer.add(key, static_cast<typename replacer_type::hook_t*>(entry));
+        else
+            replacer.add(key);
+    }
 };
 
 
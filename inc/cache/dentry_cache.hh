@@ -3,6 +3,7 @@
 #include <vector>
 #include <string>
 #include <cassert>
+#include <unordered_set>
 #include "cache/cache_manager.hh"
 
 namespace hscfs {
@@ -281,7 +282,7 @@ public:
         auto p_root = std::make_unique<dentry>(root_ino, nullptr, root_ino, "/", fs_manager);
         dentry *raw_p = p_root.get();
         cache_manager.add(p_root->key, p_root);
-        cache_manager.pin(raw_p->key);
+        cache_manager.pin(raw_p->key, raw_p);
         add_refcount(raw_p);
         ++cur_size;
         return dentry_handle(raw_p, this);
@@ -305,10 +306,30 @@ public:
         return ret;
     }
 
+    /* 只取出inos中目录下的dirty dentry，其它dirty dentry保持dirty状态 */
+    std::vector<dentry_handle> get_and_clear_dirty_list(const std::unordered_set<uint32_t> &inos)
+    {
+        std::vector<dentry_handle> ret, remain;
+        for (auto &handle: dirty_list)
+        {
+            if (inos.count(handle.entry->key.dir_ino))
+            {
+                handle.entry->is_dirty = false;
+                ret.emplace_back(std::move(handle));
+            }
+            else
+                remain.emplace_back(std::move(handle));
+        }
+        dirty_list.swap(remain);
+        return ret;
+    }
+
 private:
     size_t expect_size, cur_size;
     file_system_manager *fs_manager;
-    generic_cache_manager<dentry_key, dentry> cache_manager;
+
+    /* 路径上的父目录项被子目录项pin住，不会被置换，lru即可 */
+    generic_cache_manager<dentry_key, dentry, cache_hash_index, lru_replacer> cache_manager;
     std::vector<dentry_handle> dirty_list;
 
     void add_refcount(dentry *entry)
@@ -316,14 +337,14 @@ private:
         ++entry->ref_count;
         /* 引用计数同时维护了淘汰保护、脏、被引用、读写等状态。只要引用计数不为0，就需要pin */
         if (entry->ref_count == 1)
-            cache_manager.pin(entry->key);
+            cache_manager.pin(entry->key, entry);
     }
 
     void sub_refcount(dentry *entry)
     {
         --entry->ref_count;
         if (entry->ref_count == 0)
-            cache_manager.unpin(entry->key);
+            cache_manager.unpin(entry->key, entry);
     }
 
     void do_replace();
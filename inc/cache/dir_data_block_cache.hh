@@ -6,6 +6,7 @@
 #include <cassert>
 #include <vector>
 #include <tuple>
+#include <unordered_set>
 
 struct hscfs_dentry_block;
 
@@ -206,6 +207,12 @@ public:
         return dir_data_block_handle(p_entry, this);
     }
 
+    /* 是否缓存了目录文件ino的块blkoff，不视作对缓存项的访问 */
+    bool contains(uint32_t ino, uint32_t blkoff)
+    {
+        return cache_manager.get(dir_data_block_entry_key(ino, blkoff), false) != nullptr;
+    }
+
     /* 移除目录文件ino的所有数据缓存，即使它们是dirty的。在删除目录文件时调用 */
     void remove_ino_blks(uint32_t ino)
     {
@@ -222,6 +229,15 @@ public:
         }
     }
 
+    /* dirty的dir data block数 */
+    size_t get_dirty_num() const noexcept
+    {
+        size_t ret = 0;
+        for (auto &entry: dirty_blks)
+            ret += entry.second.size();
+        return ret;
+    }
+
     /* 
      * 清除dirty blks中的dir data缓存项的dirty标记，清空dirty blks，并返回原先的dirty blks用作淘汰保护
      * 返回的dirty blks中的元素，已经不带脏标记。
@@ -245,9 +261,34 @@ public:
         return ret;
     }
 
+    /* 与get_and_clear_dirty_blks相同，但只取出inos中目录的dirty blks */
+    std::unordered_map<uint32_t, std::vector<dir_data_block_handle>> get_and_clear_dirty_blks(
+        const std::unordered_set<uint32_t> &inos)
+    {
+        std::unordered_map<uint32_t, std::vector<dir_data_block_handle>> ret;
+        for (uint32_t ino: inos)
+        {
+            auto it = dirty_blks.find(ino);
+            if (it == dirty_blks.end())
+                continue;
+            for (auto &handle: it->second)
+            {
+                assert(handle.entry->state == dir_data_block_entry_state::dirty &&
+                    handle.entry->ref_count >= 1);
+                handle.entry->state = dir_data_block_entry_state::uptodate;
+            }
+            ret.emplace(ino, std::move(it->second));
+            dirty_blks.erase(it);
+        }
+        return ret;
+    }
+
 private:
     size_t expect_size, cur_size;
-    generic_cache_manager<dir_data_block_entry_key, dir_data_block_entry> cache_manager;
+
+    /* 在大目录中查找目录项会扫描多个目录块，使用2Q置换 */
+    generic_cache_manager<dir_data_block_entry_key, dir_data_block_entry, cache_hash_index, 
+        two_queue_replacer> cache_manager;
 
     /* 有删除一个目录文件所有缓存的需求，因此把一个目录的脏block组织为vector，使用目录ino索引 */
     std::unordered_map<uint32_t, std::vector<dir_data_block_handle>> dirty_blks;
@@ -258,14 +299,14 @@ private:
         ++entry->ref_count;
         /* dirty状态会增加一点引用计数，并加入dirty_list中，所以不需要额外判断dirty */
         if (entry->ref_count == 1)
-            cache_manager.pin(entry->get_key());
+            cache_manager.pin(entry->get_key(), entry);
     }
 
     void sub_refcount(dir_data_block_entry *entry)
     {
         --entry->ref_count;
         if (entry->ref_count == 0)
-            cache_manager.unpin(entry->get_key());
+            cache_manager.unpin(entry->get_key(), entry);
     }
 
     void mark_dirty(const dir_data_block_handle &handle)
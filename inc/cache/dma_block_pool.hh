@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "utils/declare_utils.hh"
+
+namespace hscfs {
+
+/* DMA块池的统计信息 */
+struct dma_block_pool_stat
+{
+    uint64_t slab_num = 0;  // 已向SPDK申请的slab数
+    uint64_t total_blocks = 0;  // 所有slab中的块数
+    uint64_t free_blocks = 0;  // 空闲块数，包括全局空闲链表和各线程缓存中的块
+    uint64_t alloc_num = 0;  // 分配次数
+    uint64_t thread_cache_hit = 0;  // 其中由线程缓存直接满足的次数
+    uint64_t zeroed_num = 0;  // 其中需要清零的次数
+};
+
+/*
+ * 4KB DMA块池
+ * 以slab为单位向SPDK申请DMA内存并切分为4KB块，块释放后回到池中复用，slab在进程生命期内不归还SPDK
+ *
+ * 每个线程有一个空闲块缓存，分配和释放在线程缓存中O(1)完成，不加锁
+ * 线程缓存为空或过多时，才加depot_mtx与全局空闲链表成批交换块，全局链表为空时再申请新slab
+ * 线程缓存析构后(线程退出时，其它thread_local或静态对象的析构中)，该线程的分配和释放直接加depot_mtx访问全局链表
+ * 空闲块的前8字节用作链表指针，因此分配出的块内容是任意的，需要时由调用者要求清零
+ */
+class dma_block_pool
+{
+public:
+    static constexpr size_t block_size = 4096;
+    static constexpr size_t blocks_per_slab = 256;  // 一个slab为1MB
+    static constexpr size_t batch_size = 32;  // 线程缓存与全局链表一次交换的块数
+    static constexpr size_t thread_cache_limit = 2 * batch_size;  // 线程缓存最多保存的空闲块数
+
+    no_copy_assignable(dma_block_pool)
+
+    /* 进程内唯一的块池，不析构，保证其它静态对象和线程析构时仍能释放块 */
+    static dma_block_pool *get_instance();
+
+    /* 分配一个4KB DMA块，zero为true时将其清零。分配失败抛出alloc_error */
+    char *alloc(bool zero);
+
+    /* 释放alloc分配的块，blk为nullptr时不做任何事 */
+    void free(char *blk) noexcept;
+
+    dma_block_pool_stat get_stat();
+
+private:
+    struct free_block
+    {
+        free_block *next;
+    };
+
+    /*
+     * 线程的空闲块缓存，只由所属线程修改
+     * 统计字段使用原子变量，只为get_stat能在其它线程读取，所属线程更新时不需要原子读改写
+     */
+    struct thread_cache
+    {
+        dma_block_pool *pool;
+        free_block *head = nullptr;
+        std::atomic<size_t> num{0};
+        std::atomic<uint64_t> alloc_num{0}, hit_num{0}, zeroed_num{0};
+
+        thread_cache(dma_block_pool *pool);
+        ~thread_cache();  // 线程退出时，将空闲块和统计并入全局
+    };
+
+    std::mutex depot_mtx;  // 保护以下字段
+    free_block *depot_head = nullptr;
+    size_t depot_num = 0;
+    std::vector<void*> slabs;
+    std::vector<thread_cache*> thread_caches;  // 存活线程的缓存，用于统计
+    dma_block_pool_stat retired_stat;  // 已退出线程，及不经过线程缓存的分配统计
+
+    dma_block_pool() = default;
+
+    /* 返回本线程的线程缓存，已经析构时返回nullptr */
+    thread_cache *get_thread_cache();
+
+    /* 没有线程缓存时，直接从全局链表分配、向全局链表释放 */
+    char *alloc_from_depot(bool zero);
+    void free_to_depot(free_block *blk) noexcept;
+
+    /* 从全局链表取最多batch_size个块到tc，全局链表为空时申请新slab */
+    void refill(thread_cache &tc);
+
+    /* 将tc中的num个块归还全局链表 */
+    void flush(thread_cache &tc, size_t num) noexcept;
+
+    /* 申请一个slab，将其中的块加入全局链表。调用者持有depot_mtx */
+    void add_slab();
+};
+
+}  // namespace hscfs
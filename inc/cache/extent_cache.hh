@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <map>
+
+namespace hscfs {
+
+/* extent缓存的统计信息 */
+struct extent_cache_stat
+{
+    uint64_t hit_num = 0;  // 查询命中次数
+    uint64_t miss_num = 0;  // 查询未命中次数
+};
+
+/*
+ * 一个文件的extent缓存，记录文件块偏移到lpa的映射
+ * 一个extent表示块偏移[blkoff, blkoff + len)依次映射到[lpa, lpa + len)，插入时与相邻且连续的extent合并
+ * 只缓存有效的映射，不记录空洞，查询未命中时调用者应查询file mapping
+ *
+ * 缓存中的映射必须与file mapping一致：file mapping被修改时(回写、截断、segment清理迁移)，调用者应同步修改缓存
+ * 此类不加锁，由调用者保护(见file中的使用)
+ */
+class extent_cache
+{
+public:
+    /* extent数的上限，超过时清空缓存，由之后的查询重新填充 */
+    static constexpr size_t max_extent_num = 1024;
+
+    /* 查询blkoff的lpa，命中返回true，并通过lpa返回 */
+    bool lookup(uint32_t blkoff, uint32_t &lpa);
+
+    /* 记录[blkoff, blkoff + len)映射到[lpa, lpa + len)，覆盖范围内原有的映射 */
+    void insert(uint32_t blkoff, uint32_t lpa, uint32_t len = 1);
+
+    /* 删除块偏移[start_blkoff, end_blkoff)内的映射 */
+    void remove(uint32_t start_blkoff, uint32_t end_blkoff);
+
+    void clear() noexcept
+    {
+        extents.clear();
+    }
+
+    size_t get_extent_num() const noexcept
+    {
+        return extents.size();
+    }
+
+    const extent_cache_stat& get_stat() const noexcept
+    {
+        return stat;
+    }
+
+private:
+    struct extent
+    {
+        uint32_t len;
+        uint32_t lpa;
+    };
+
+    std::map<uint32_t, extent> extents;  // 以extent的起始块偏移为key，extent之间不重叠
+    extent_cache_stat stat;
+};
+
+}  // namespace hscfs
@@ -6,6 +6,7 @@
 
 #include <cassert>
 #include <list>
+#include <unordered_set>
 
 struct comm_dev;
 
@@ -216,6 +217,12 @@ public:
         return node_block_cache_entry_handle(p_entry, this);
     }
 
+    /* nid是否在缓存中，不视作对缓存项的访问 */
+    bool contains(uint32_t nid)
+    {
+        return cache_manager.get(nid, false) != nullptr;
+    }
+
     /* 
      * 清除dirty list中的node缓存项的dirty标记，清空dirty list，并返回原先的dirty list用作淘汰保护
      * 返回的dirty list中的元素，已经不带脏标记。
@@ -231,18 +238,48 @@ public:
 
         std::list<node_block_cache_entry_handle> ret;
         dirty_list.swap(ret);
+        dirty_pos.clear();
         assert(dirty_list.size() == 0);
         return ret;
     }
 
+    /*
+     * 与get_and_clear_dirty_list相同，但只取出属于inos中文件(footer中的ino属于inos)的dirty node
+     * 其它dirty node保持dirty状态，留在dirty list中
+     */
+    std::list<node_block_cache_entry_handle> get_and_clear_dirty_list(const std::unordered_set<uint32_t> &inos)
+    {
+        std::list<node_block_cache_entry_handle> ret;
+        for (auto it = dirty_list.begin(); it != dirty_list.end();)
+        {
+            auto cur = it++;
+            node_block_cache_entry *entry = cur->entry;
+            assert(entry->state == node_block_cache_entry_state::dirty && entry->ref_count >= 1);
+            if (inos.count(entry->get_node_block_ptr()->footer.ino) == 0)
+                continue;
+            entry->state = node_block_cache_entry_state::uptodate;
+            dirty_pos.erase(entry);
+            ret.splice(ret.end(), dirty_list, cur);
+        }
+        return ret;
+    }
+
     void force_replace()
     {
         do_replace();
     }
 
+    /* 当前dirty node的数量 */
+    size_t get_dirty_num() const noexcept
+    {
+        return dirty_list.size();
+    }
+
 private:
     size_t expect_size, cur_size;
-    generic_cache_manager<uint32_t, node_block_cache_entry> cache_manager;
+
+    /* 顺序读写大文件时，每个direct node通常只被连续访问一段时间，使用2Q置换，避免冲刷热点inode和间接node */
+    generic_cache_manager<uint32_t, node_block_cache_entry, cache_hash_index, two_queue_replacer> cache_manager;
     std::list<node_block_cache_entry_handle> dirty_list;
     std::unordered_map<node_block_cache_entry*, std::list<node_block_cache_entry_handle>::iterator> dirty_pos;
     file_system_manager *fs_manager;
@@ -253,7 +290,7 @@ private:
         ++entry->ref_count;
         /* 引用计数同时维护了淘汰保护、脏、被引用、读写等状态。只要引用计数不为0，就需要pin */
         if (entry->ref_count == 1)
-            cache_manager.pin(entry->nid);
+            cache_manager.pin(entry->nid, entry);
     }
 
     void sub_refcount(node_block_cache_entry *entry);
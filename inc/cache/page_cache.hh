@@ -2,12 +2,14 @@
 
 #include "cache/block_buffer.hh"
 #include "cache/cache_manager.hh"
+#include "fs/fs.h"
 #include "utils/hscfs_multithread.h"
 #include "utils/declare_utils.hh"
 #include <mutex>
 #include <condition_variable>
 #include <map>
 #include <atomic>
+#include <vector>
 
 namespace hscfs {
 
@@ -18,9 +20,50 @@ enum class page_state
      * 处于invalid状态时，origin_lpa和commit_lpa是随机值
      */
     invalid,
+    reading,  // 已提交异步读(预读)，I/O尚未完成，完成后变为ready(失败则变为invalid)
     ready  // 缓存块内容有效
 };
 
+class page_cache;
+
+/* 
+ * page_pool置换器中标识page的key：所属文件page cache的代号与文件内块偏移
+ * 不使用page_entry地址，因为page_entry会被复用，且2Q置换器需要记住已被置换的page
+ * 
+ * 代号在每个page_cache构造时分配，不会重复。page_cache释放后其地址可能被另一个文件的page_cache复用，
+ * 若以地址区分文件，幽灵队列中残留的key会被误认为新文件的page
+ * owner只用于置换时找到所属的page_cache，不参与比较
+ */
+struct page_key
+{
+    page_cache *owner;
+    uint64_t generation;
+    uint32_t blkoff;
+
+    bool operator==(const page_key &o) const noexcept
+    {
+        return generation == o.generation && blkoff == o.blkoff;
+    }
+};
+
+}  // namespace hscfs
+
+namespace std {
+
+template<>
+struct hash<hscfs::page_key>
+{
+    size_t operator()(const hscfs::page_key &key) const
+    {
+        size_t h = hash<uint64_t>()(key.generation);
+        return h ^ (hash<uint32_t>()(key.blkoff) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2));
+    }
+};
+
+}  // namespace std
+
+namespace hscfs {
+
 class page_entry
 {
 public:
@@ -32,11 +75,40 @@ public:
         return page_lock;
     }
 
-    block_buffer& get_page_buffer() noexcept
+    /*
+     * 获取page的块缓存区，用于修改page内容或从SSD读入
+     * 若page还不持有块缓存区则分配一个：page为零页时写时复制(分配清零的块)，否则内容将被完整读入，不清零
+     */
+    block_buffer& get_page_buffer()
     {
+        if (page.is_empty())
+            page.alloc(zero);
+        zero = false;
         return page;
     }
 
+    /* 只读访问page的内容，零页返回共享的全0块，不分配块缓存区。page需处于ready状态 */
+    const char *get_content_ptr() noexcept
+    {
+        return zero ? zero_block : page.get_ptr();
+    }
+
+    /*
+     * 将page置为内容全0的ready状态(文件空洞或超出文件范围)，释放其块缓存区，引用共享的零页直到首次写入
+     * 零页的引用计数减为0时，page_cache直接将其移除，不占用缓存
+     */
+    void set_zero_page() noexcept
+    {
+        page.release();
+        zero = true;
+        content_state = page_state::ready;
+    }
+
+    bool is_zero_page() const noexcept
+    {
+        return zero;
+    }
+
     page_state get_state() const noexcept
     {
         return content_state;
@@ -60,6 +132,22 @@ public:
     void set_lpa(uint32_t lpa) noexcept
     {
         this->lpa = lpa;
+        lpa_unresolved = false;
+    }
+
+    /*
+     * 整页覆盖写时不查询file mapping，page的旧lpa暂时未知
+     * 回写时再从file mapping得到旧lpa，用于无效化
+     */
+    void set_lpa_unresolved() noexcept
+    {
+        lpa = INVALID_LPA;
+        lpa_unresolved = true;
+    }
+
+    bool is_lpa_unresolved() const noexcept
+    {
+        return lpa_unresolved;
     }
 
 private:
@@ -74,12 +162,17 @@ private:
 private:
     uint32_t blkoff;   // 文件内块偏移
     uint32_t lpa;  // 块地址（如果是新创建但没写回，则为INVALID_LPA）
+    bool lpa_unresolved;  // 为true时lpa未知，见set_lpa_unresolved
+
+    /* 异步读完成时，由I/O回调修改，所以使用atomic变量 */
+    std::atomic<page_state> content_state;
+    block_buffer page;  // 按需分配，零页和内容无效的page可能不持有块缓存区
+    bool zero;  // 是否为零页，此时不持有块缓存区
 
-    page_state content_state;
-    block_buffer page;
+    static const char zero_block[4096];  // 所有零页共享的全0块
 
     /*
-     * 保护page、content_state、origin_lpa的锁
+     * 保护page、zero、content_state、lpa、lpa_unresolved的锁
      * 获得file_op_lock独占时，不需要再加此锁
      */
     std::mutex page_lock;
@@ -88,8 +181,8 @@ private:
      * 引用计数，在调用方与page_entry_handle生命周期绑定，一个page_entry_handle增加1引用计数
      * page cache内的dirty page set中的page entry也增加引用计数
      * 
-     * 通过page_cache.get获取page_entry_handle时，对page_cache加cache_lock锁后增加ref_count
-     * ref_count为0时，一定是page cache内部独占访问page_entry(内部加了cache_lock锁，外部没有句柄，无法访问)
+     * 通过page_cache.get获取page_entry_handle时，对page_pool加pool_lock锁后增加ref_count
+     * ref_count为0时，一定是page cache内部独占访问page_entry(内部加了pool_lock锁，外部没有句柄，无法访问)
      * 
      * page_entry_handle拷贝时，对ref_count原子加，不对page_cache加锁(此时ref_count一定大于等于1)
      * page_entry_handle析构时，调用page_cache的sub_refcount方法
@@ -100,11 +193,10 @@ private:
     std::atomic_bool is_dirty;
 
     friend class page_cache;
+    friend class page_pool;
     friend class page_entry_handle;
 };
 
-class page_cache;
-
 /* 外部操作page_entry的句柄 */
 class page_entry_handle
 {
@@ -148,14 +240,69 @@ private:
     friend class page_cache;
 };
 
+/*
+ * 全局页缓存池
+ * 所有文件的page_cache共享一个以字节为单位的内存预算，由page_pool在所有文件的page间统一进行置换
+ * 
+ * pool_lock同时保护置换器、所有page_cache的缓存索引与页数统计
+ * 因此跨文件置换时，只需加pool_lock一把锁，不存在多个文件的锁之间的加锁顺序问题
+ */
+class page_pool
+{
+public:
+    /* budget为页缓存可使用的内存字节数，按4KB折算为页数，至少为1页 */
+    page_pool(size_t budget);
+    ~page_pool();
+
+    /* 预算页数 */
+    size_t get_budget_pages() const noexcept
+    {
+        return budget_pages;
+    }
+
+    /* 当前所有文件缓存的总页数(包括暂时无法置换而超出预算的页) */
+    size_t get_cur_pages();
+
+private:
+    spinlock_t pool_lock;
+
+    /* 
+     * 置换出的page通过key中的owner找到所属的page_cache
+     * 使用2Q置换器，防止大文件的顺序读冲刷其它文件的热点page
+     */
+    two_queue_replacer<page_key> replacer;
+    size_t budget_pages, cur_pages;
+    uint64_t next_generation;  // 下一个page_cache的代号
+
+    /*
+     * 为新缓存项获取一个page_entry，调用者需要加pool_lock
+     * 如果已达到预算，则置换任意文件中的一个page，直接复用其资源，防止多次分配和释放4KB block
+     * 如果未达到预算，或找不到能置换的page，再新建
+     * 返回的page_entry的blkoff等成员由调用者重新设置
+     */
+    std::unique_ptr<page_entry> alloc_entry();
+
+    /* 
+     * 置换page，直到总页数不超过预算或没有能置换的page，调用者需要加pool_lock
+     * 被置换的page_entry移入evicted，由调用者在释放pool_lock后析构(释放block可能需要获取其它锁)
+     */
+    void do_replace(std::vector<std::unique_ptr<page_entry>> &evicted);
+
+    /* 将victim从所属page_cache的索引中移除，返回其所有权，调用者需要加pool_lock */
+    std::unique_ptr<page_entry> evict(const page_key &victim);
+
+    friend class page_cache;
+};
+
 /* 
  * 文件页缓存
- * page_cache只作为page的缓存索引和置换管理器，不关心文件的实际大小
+ * page_cache只作为文件page的缓存索引，不关心文件的实际大小
+ * 缓存容量和置换由所有文件共享的page_pool管理，page_cache记录本文件缓存的页数
  */
 class page_cache
 {
 public:
-    page_cache(size_t expect_size);
+    page_cache(page_pool *pool);
     ~page_cache();
 
     /*
@@ -167,11 +314,11 @@ public:
     page_entry_handle get(uint32_t blkoff);
 
     /*
-     * 截断文件后调用，将page cache内块偏移严格大于max_blkoff的缓存page的dirty位清除，置位invalid状态，但
-     * 不将它们删除，因为也许之后又会访问
+     * 截断文件后调用，将page cache内块偏移不小于blk_num(截断后文件的块数)的缓存page(包括干净的page)的dirty位清除，
+     * 置位invalid状态，但不将它们删除，因为也许之后又会访问
      * 调用者必须持有对应文件的file_op_lock独占锁（此时仅有一个线程能操作文件的page cache）
      */
-    void truncate(uint32_t max_blkoff);
+    void truncate(uint32_t blk_num);
 
     /*
      * 获取dirty pages集合
@@ -185,28 +332,82 @@ public:
     /* 将dirty pages中所有page的dirty位清除 */
     void clear_dirty_pages();
 
+    /*
+     * 提交异步读page的请求(用于预读)，从lpa读取page内容，将page置为reading状态
+     * I/O完成后，page被置为ready状态，若I/O失败，则恢复为invalid状态
+     * I/O完成前，page_cache持有page的引用，page不会被置换
+     * 调用者需持有该page的page_lock，且page处于invalid状态
+     */
+    void read_page_async(page_entry_handle &page, comm_dev *dev, uint32_t lpa);
+
+    /*
+     * 等待page的异步读完成，返回时page不再处于reading状态
+     * 调用者需持有该page的page_lock
+     */
+    void wait_page_read_cplt(page_entry_handle &page);
+
+    /* 本文件当前缓存的页数 */
+    size_t get_page_num();
+
+    /*
+     * 若blkoff对应的page在缓存中，且其lpa为old_lpa，则将lpa修改为new_lpa，不存在时不创建page
+     * 用于segment清理迁移block后，修正缓存中记录的地址
+     * 调用者需持有fs_freeze_lock独占(此时没有线程操作文件的page)
+     */
+    void update_lpa(uint32_t blkoff, uint32_t old_lpa, uint32_t new_lpa);
+
+    /* 本文件当前的脏页数 */
+    size_t get_dirty_page_num();
+
 private:
-    generic_cache_manager<uint32_t, page_entry> cache_manager;
-    spinlock_t cache_lock;  // 保护cache_manager
+    page_pool *pool;
+    uint64_t generation;  // 本page_cache的代号，见page_key
+
+    /* 文件的缓存索引，与cur_size一起由pool的pool_lock保护 */
+    cache_hash_index<uint32_t, page_entry> index;
+    size_t cur_size;
 
     /* 由于dirty_pages有范围remove需求，所以用map<blkoff, page_handle>维护 */
     std::map<uint32_t, page_entry_handle> dirty_pages;
     spinlock_t dirty_pages_lock;
 
-    size_t expect_size, cur_size;
+    /* 
+     * 尚未完成的异步读个数，与等待异步读完成的条件变量
+     * async_read_mtx只在修改异步读状态时短暂持有，不会在持有时进行I/O
+     */
+    size_t inflight_read_num;
+    std::mutex async_read_mtx;
+    std::condition_variable async_read_cond;
+
+    /* 异步读的回调参数，持有page的引用直到I/O完成 */
+    struct async_read_ctx
+    {
+        page_cache *cache;
+        page_entry_handle page;
+    };
 
-    /* 调用者需要加cache_lock，除非能够保证调用时ref_count不会为0 */
+    static void async_read_callback(comm_cmd_result res, void *arg);
+
+    /* 等待所有异步读完成 */
+    void wait_all_async_read();
+
+    /* 调用者需要加pool_lock，除非能够保证调用时ref_count不会为0 */
     void add_refcount(page_entry *entry);
 
     void sub_refcount(page_entry *entry);
-    void do_replace();
 
     /* 
      * 由page_entry_handle的mark_dirty方法调用
-     * 调用时能保证ref_count不为0，因为发起调用的page_entry_handle仍有效，所以内部不加cache_lock锁
+     * 调用时能保证ref_count不为0，因为发起调用的page_entry_handle仍有效，所以内部不加pool_lock锁
      */
     void add_to_dirty_pages(page_entry_handle &page);
 
+    page_key get_key(uint32_t blkoff) noexcept
+    {
+        return page_key{this, generation, blkoff};
+    }
+
+    friend class page_pool;
     friend class page_entry_handle;
 };
 
@@ -6,6 +6,7 @@ extern "C" {
 
 #include <stdint.h>
 #include <stddef.h>
+#include <sys/uio.h>
 
 #include "utils/hscfs_multithread.h"
 
@@ -83,6 +84,21 @@ int comm_channel_send_write_cmd_no_lock(comm_channel_handle handle, void *buffer
 int comm_channel_send_write_cmd(comm_channel_handle handle, void *buffer, uint64_t lba, uint32_t lba_count,
     channel_cmd_cb_func cb_func, void *cb_arg);
 
+/*
+通过handle发送向量read/write命令。
+iov中的缓存区依次对应从lba开始的lba_count个LBA，其总长度应等于lba_count个LBA的大小。
+channel拷贝iov数组，调用返回后调用者可以释放iov数组，但缓存区在命令完成前需保持有效。
+返回0成功，否则返回对应errno。
+*/
+int comm_channel_send_readv_cmd_no_lock(comm_channel_handle handle, const struct iovec *iov, int iovcnt, 
+    uint64_t lba, uint32_t lba_count, channel_cmd_cb_func cb_func, void *cb_arg);
+int comm_channel_send_readv_cmd(comm_channel_handle handle, const struct iovec *iov, int iovcnt, 
+    uint64_t lba, uint32_t lba_count, channel_cmd_cb_func cb_func, void *cb_arg);
+int comm_channel_send_writev_cmd_no_lock(comm_channel_handle handle, const struct iovec *iov, int iovcnt, 
+    uint64_t lba, uint32_t lba_count, channel_cmd_cb_func cb_func, void *cb_arg);
+int comm_channel_send_writev_cmd(comm_channel_handle handle, const struct iovec *iov, int iovcnt, 
+    uint64_t lba, uint32_t lba_count, channel_cmd_cb_func cb_func, void *cb_arg);
+
 /* 
 发送自定义命令。
 上层负责构造comm_raw_cmd中的命令相关字段。
@@ -6,6 +6,7 @@
 extern "C" {
 #endif
 
+#include <sys/uio.h>
 #include "communication/vendor_cmds.h"
 
 typedef struct comm_dev comm_dev;
@@ -29,6 +30,15 @@ int comm_submit_sync_rw_request(comm_dev *dev, void *buffer, uint64_t lba, uint3
 int comm_submit_async_rw_request(comm_dev *dev, void *buffer, uint64_t lba, uint32_t lba_count,
     comm_async_cb_func cb_func, void *cb_arg, comm_io_direction dir);
 
+// 向量读写。iov中的缓存区依次对应从lba开始的连续lba_count个LBA，总长度应等于lba_count个LBA的大小，缓存区必须是可DMA的内存。
+// 调用返回后iov数组即可释放，但缓存区在命令完成前需保持有效。
+int comm_submit_sync_rwv_request(comm_dev *dev, const struct iovec *iov, int iovcnt, uint64_t lba, uint32_t lba_count, 
+    comm_io_direction dir);
+int comm_submit_async_rwv_request(comm_dev *dev, const struct iovec *iov, int iovcnt, uint64_t lba, uint32_t lba_count,
+    comm_async_cb_func cb_func, void *cb_arg, comm_io_direction dir);
+
+// segment迁移命令。将起始地址为migrate_src_lpa的segment中，victim_seg_info位图标记的第i个块，
+// 复制到migrate_dst_lpa + i，共migrate_lpa_cnt个块。task必须是可DMA的内存。
 int comm_submit_sync_migrate_request(comm_dev *dev, migrate_task *task);
 int comm_submit_async_migrate_request(comm_dev *dev, migrate_task *task, comm_async_cb_func cb_func, void *cb_arg);
 
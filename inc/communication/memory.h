@@ -21,6 +21,15 @@ __attribute__((unused)) static void *comm_alloc_dma_mem(size_t size)
     return ret; 
 }
 
+// 分配起始地址按align对齐的DMA内存
+__attribute__((unused)) static void *comm_alloc_dma_mem_aligned(size_t size, size_t align)
+{
+    void *ret = spdk_zmalloc(size, align, NULL, SPDK_ENV_SOCKET_ID_ANY, SPDK_MALLOC_DMA);
+    if (ret == NULL)
+        HSCFS_LOG(HSCFS_LOG_ERROR, "alloc aligned dma memory failed.");
+    return ret; 
+}
+
 __attribute__((unused)) static void comm_free_dma_mem(void *buf)
 {
     spdk_free(buf);
@@ -41,8 +41,8 @@ struct path_lookup_result
     u32 path_inos[MAX_PATH_DEPTH];   /*路径各级的ino，INVALID_NID表示该级文件不存在*/
 
 
-    char parent_dir_node_page[4096];   /*若目标文件存在，该项是索引对应dentry所在的block的node page的内容*/
-    char parent_dir_data_page[4096];   /*若目标文件存在，该项是存放对应dentry的data block的内容*/
+    char parent_dir_node_page[4096];   /*若目标文件存在，或dentryBitPos表示有效的插入位置，该项是索引对应dentry所在的block的node page的内容*/
+    char parent_dir_data_page[4096];   /*若目标文件存在，或dentryBitPos表示有效的插入位置，该项是存放对应dentry的data block的内容*/
 };
 typedef struct path_lookup_result path_lookup_result;
 
@@ -3,6 +3,8 @@
 #include <cstdint>
 #include <utility>
 
+struct hscfs_sit_entry;
+
 namespace hscfs {
 
 class file_system_manager;
@@ -25,6 +27,9 @@ public:
         change_lpa_state(lpa, true);
     }
 
+    /* 将同一segment内从start_lpa开始的num个lpa有效化，只写入一条修改日志 */
+    void validate_lpa_range(uint32_t start_lpa, uint32_t num);
+
     /* 得到lpa所处的segment id和segment内块偏移<segid, off> */
     std::pair<uint32_t, uint32_t> get_seg_pos_of_lpa(uint32_t lpa);
 
@@ -34,6 +39,15 @@ public:
     /* 得到segid对应segment的第一个block的lpa */
     uint32_t get_first_lpa_of_segid(uint32_t segid);
 
+    /* 得到segid的SIT表项的拷贝 */
+    hscfs_sit_entry get_sit_entry(uint32_t segid);
+
+    /* 
+     * 由位图统计SIT表项中的有效块数
+     * 表项中的有效块计数只有9位，记录不了512个有效块，需要准确数目时应使用此方法
+     */
+    static uint32_t count_valid_blocks(const hscfs_sit_entry &entry);
+
 private:
     file_system_manager *fs_manager;
     uint32_t seg0_start_lpa;
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <mutex>
+#include <chrono>
+#include <vector>
+#include <unordered_set>
+
+#include "utils/declare_utils.hh"
+
+namespace hscfs {
+
+class file_system_manager;
+class server_thread;
+
+/* 后台回写策略 */
+struct flush_policy
+{
+    std::chrono::milliseconds period{1000};  // 后台回写的周期
+    std::chrono::milliseconds dirty_expire{5000};  // 脏文件、脏元数据超过该时间后回写
+    size_t dirty_pages_limit = SIZE_MAX;  // 脏页总数超过该值时，从最早变脏的文件开始回写
+    size_t dirty_nodes_limit = SIZE_MAX;  // dirty node数超过该值时，回写所有脏元数据
+};
+
+/* 后台回写的统计信息 */
+struct flush_stat
+{
+    uint64_t run_num = 0;  // 执行回写的轮数(不包括跳过的轮次)
+    uint64_t file_num = 0;  // 回写数据的文件数
+    uint64_t tx_num = 0;  // 回写元数据生成的事务数
+};
+
+/*
+ * 后台周期回写，作为服务线程的周期性任务执行
+ * 每轮回写超时或超出脏页限制的脏文件的数据，并为这些文件回写元数据、生成一个事务；
+ * 若脏元数据超时或dirty node数超出限制，则回写所有脏元数据
+ * 使fsync和文件系统退出时只需要回写少量剩余的脏数据
+ *
+ * 回写时只尝试加锁，fs_freeze_lock或文件的file_op_lock被前台占用时跳过，不阻塞服务线程
+ * fs_meta_lock按文件分别获取，回写完一个文件的数据即释放，最后回写元数据时再获取，前台操作只需等待一个文件的回写
+ * 不等待日志落盘，持久化仍由fsync保证
+ */
+class background_flusher
+{
+public:
+    background_flusher(file_system_manager *fs_manager, server_thread *server, const flush_policy &policy);
+    no_copy_assignable(background_flusher)
+
+    /* 修改回写策略，在服务线程中以新的周期执行 */
+    void set_policy(const flush_policy &policy);
+    flush_policy get_policy();
+
+    flush_stat get_stat();
+
+    /* 执行一轮后台回写，由服务线程周期调用 */
+    void run();
+
+private:
+    file_system_manager *fs_manager;
+    server_thread *server;
+    size_t task_id;  // 在服务线程中的周期性任务id
+
+    std::mutex mtx;  // 保护policy和stat
+    flush_policy policy;
+    flush_stat stat;
+
+    /* 以下成员只在服务线程中访问 */
+    bool meta_dirty;  // 上一轮检查时是否有脏元数据
+    std::chrono::steady_clock::time_point meta_dirty_since;  // 检查到脏元数据的最早时间
+
+    /* 以下方法的调用者持有fs_freeze_lock共享锁和fs_meta_lock */
+
+    /* 选出需要回写数据的文件，返回它们的inode号 */
+    std::vector<uint32_t> select_files(const flush_policy &p, std::chrono::steady_clock::time_point now);
+
+    /* 回写文件ino的数据。文件已不在缓存中、不再dirty或被前台占用时跳过，返回false */
+    bool flush_file(uint32_t ino);
+
+    /* 回写元数据，inos为本轮回写了数据的文件 */
+    void flush_meta(const flush_policy &p, std::chrono::steady_clock::time_point now,
+        const std::unordered_set<uint32_t> &inos);
+};
+
+}  // namespace hscfs
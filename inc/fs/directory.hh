@@ -61,6 +61,12 @@ public:
      */
     dentry_info lookup(const std::string &name);
 
+    /*
+     * 估计在主机侧lookup(name)需要从SSD读取的块数，用于选择查找方式(见lookup_policy)
+     * 按目录项不存在、需要遍历每一级哈希表中对应的桶估计，不读取任何块
+     */
+    uint32_t estimate_lookup_reads(const std::string &name);
+
     /*
      * 在目录文件中删除目录项dentry，内部会将修改过的数据和元数据标记dirty
      * 调用者应保证该目录项存在
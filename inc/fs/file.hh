@@ -3,7 +3,11 @@
 #include <memory>
 #include <ctime>
 #include <atomic>
+#include <vector>
+#include <chrono>
 #include "cache/dentry_cache.hh"
+#include "cache/extent_cache.hh"
+#include "fs/write_back_helper.hh"
 #include "utils/hscfs_multithread.h"
 
 namespace hscfs {
@@ -11,6 +15,7 @@ namespace hscfs {
 class page_cache;
 class page_entry_handle;
 class file_system_manager;
+struct block_addr_info;
 
 /* 
  * 作用类似VFS的inode，代表文件系统中的一个文件
@@ -73,6 +78,12 @@ public:
         return file_op_lock;
     }
 
+    /* 文件是否有未回写的数据或元数据(是否在dirty set中) */
+    bool need_write_back() const noexcept
+    {
+        return is_dirty.load();
+    }
+
     /*
      * 调整文件大小到tar_size
      * 不调整文件page cache中多余的部分。该部分应在write和write back时特殊处理
@@ -92,10 +103,19 @@ public:
     /*
      * 从pos开始读最多count字节
      * 更新file内的atime(但不更新inode中对应元数据)
+     * 若miss_num不为空，则通过它返回读过程中需要同步从SSD读取的page数
      * 调用者应在稍后使用file_handle标记dirty
      * 调用者应持有该文件的pos_lock锁和file_op_lock锁
      */
-    ssize_t read(char *buffer, ssize_t count, uint64_t pos);
+    ssize_t read(char *buffer, ssize_t count, uint64_t pos, uint32_t *miss_num = nullptr);
+
+    /*
+     * 预读块偏移在[start_blkno, start_blkno + num)内的page，超出文件大小的部分不预读
+     * 对内容无效的page提交异步读，立刻返回，不等待I/O完成
+     * 正在被其它线程使用(无法获取page_lock)、内容已经有效或在文件空洞中的page将被跳过
+     * 调用者应持有file_op_lock共享锁，不得持有fs_meta_lock
+     */
+    void readahead(uint32_t start_blkno, uint32_t num);
 
     /*
      * 从pos开始写入count字节
@@ -113,8 +133,22 @@ public:
      * 
      * 此方法由handle代理调用，则handle中能够去除file对象的dirty状态，单独的fsync应使用handle代理
      * 文件系统内部回写时，可以直接调用此方法，因为文件系统可以通过其他方式维护file_obj_cache和file的dirty状态
+     * 
+     * src为回写的发起者，用于选择数据块写入的活跃segment
+     */
+    void write_back(write_back_source src);
+
+    /*
+     * 文件块blkoff从old_lpa迁移到new_lpa后，修正extent缓存，若该page在缓存中且地址为old_lpa，将其修改为new_lpa
+     * segment清理迁移文件数据块后调用，调用者应持有fs_freeze_lock独占
      */
-    void write_back();
+    void update_page_lpa(uint32_t blkoff, uint32_t old_lpa, uint32_t new_lpa);
+
+    /* 调用者需持有fs_meta_lock */
+    const extent_cache_stat& get_extent_cache_stat() const noexcept
+    {
+        return extents.get_stat();
+    }
 
 private:
     uint32_t ino;  // inode号
@@ -133,6 +167,9 @@ private:
      */
     std::atomic_bool is_dirty;
 
+    /* 最近一次变脏(加入dirty set)的时间，由file_obj_cache的dirty_files_lock保护 */
+    std::chrono::steady_clock::time_point dirty_time;
+
     /*
      * 硬连接数，访问时加fs_meta_lock
      * close时，应当检查该字段。如果为0，且fd_ref_count也为0，需要删除文件，修改目录项的状态为已删除且未引用 
@@ -162,6 +199,12 @@ private:
 
     std::unique_ptr<page_cache> page_cache_;
 
+    /* 
+     * 文件块偏移到lpa的extent缓存，查询page的lpa时先查此缓存，命中时不需要访问node缓存
+     * 由fs_meta_lock保护，修改file mapping(回写、截断、segment清理迁移)时同步修改
+     */
+    extent_cache extents;
+
 private:
 
     /* 对is_dirty进行CAS操作(由false更改为true)，成功返回true。由file_handle中mark_dirty调用 */
@@ -212,11 +255,49 @@ private:
      * 
      * 即使该page在文件空洞中、或超出了文件当前范围，此方法也不会将page标记为dirty
      * 原因：对于read，不标记dirty，则维持文件空洞状态，不必分配SSD block。对于write，则应在write方法内标记为dirty。
-     * 但由于前期设计时block_buffer和内存分配耦合，会出现不必要的内存分配（未优化）
+     * 此时page置为零页，引用共享的全0块，不分配块缓存区，write首次修改时才分配
+     * 
+     * 只在查询page的lpa时持有fs_meta_lock，从SSD读page内容时不持有fs_meta_lock。读成功后才将page置为ready
+     * 若page正在被预读，则等待预读完成
      * 
-     * 调用者需持有该page的page_lock，不得持有fs_meta_lock
+     * 如果同步从SSD读取了page内容，返回true，否则返回false
+     * 调用者需持有该page的page_lock和file_op_lock共享锁，不得持有fs_meta_lock
      */
-    void prepare_page_content(page_entry_handle &page);
+    bool prepare_page_content(page_entry_handle &page);
+
+    /*
+     * 查询块偏移为blkoff的page的lpa。若page超出文件范围或在文件空洞中，返回INVALID_LPA
+     * 优先查询extent缓存，未命中时查询file mapping，并将结果所在direct node中lpa连续的一段加入extent缓存
+     * 内部获取fs_meta_lock，调用者不得持有fs_meta_lock
+     */
+    uint32_t get_lpa_of_page(uint32_t blkoff);
+
+    /* 同get_lpa_of_page，但调用者需持有fs_meta_lock */
+    uint32_t get_lpa_of_page_no_lock(uint32_t blkoff);
+
+    /* 
+     * 以file mapping查询得到的blkoff的地址addr为中心，在其所在的inode或direct node中
+     * 向前后找出lpa连续的最长一段，加入extent缓存。调用者需持有fs_meta_lock
+     */
+    void cache_extent_of_block(uint32_t blkoff, block_addr_info &addr);
+
+    /* 需要从SSD读取内容的page，及其page_lock和lpa */
+    struct page_to_read;
+
+    /*
+     * 收集[start_blkno, end_blkno)中内容无效(invalid)、且能立即获取page_lock的page，持有它们的page_lock
+     * 在一次fs_meta_lock中查询它们的lpa(空洞和超出inode范围的page，lpa为INVALID_LPA)
+     * 调用者不得持有fs_meta_lock和这些page的page_lock
+     */
+    void collect_pages_to_read(uint32_t start_blkno, uint32_t end_blkno, std::vector<page_to_read> &pages);
+
+    /*
+     * 将[start_blkno, end_blkno)中内容无效的page一次性完成映射查询，并发地从SSD异步读取，等待全部完成后置为ready
+     * 读入的page加入pinned_pages，调用者通过它保持page的引用，防止被置换
+     * 返回从SSD读取的page数
+     * 调用者应持有file_op_lock共享锁，不得持有fs_meta_lock和范围内任何page的page_lock
+     */
+    uint32_t batch_read_pages(uint32_t start_blkno, uint32_t end_blkno, std::vector<page_entry_handle> &pinned_pages);
 
     /* 
      * 更新file内的元数据(文件大小和修改时间)到文件的inode
@@ -306,7 +387,7 @@ public:
      * 回写的代理函数，清除file的dirty标记，并调用file的write_back方法 
      * 锁要求与file的write_back相同
      */
-    void write_back();
+    void write_back(write_back_source src);
 
     /*
      * 删除该文件，释放该文件的全部资源，从file_obj_cache中移除entry
@@ -344,6 +425,18 @@ public:
      */
     std::unordered_map<uint32_t, file_handle> get_and_clear_dirty_files();
 
+    /*
+     * 选出需要后台回写的脏文件(不清除dirty标记)，按变脏时间从早到晚排列：
+     * 变脏时间不晚于expire_time的文件；若剩余文件的脏页总数仍超过dirty_pages_limit，再按变脏时间从早到晚选取，
+     * 直到剩余脏页数不超过限制
+     * 调用者需要获取fs_meta_lock (返回的handle析构时需要)
+     */
+    std::vector<file_handle> get_dirty_files_to_flush(std::chrono::steady_clock::time_point expire_time,
+        size_t dirty_pages_limit);
+
+    /* 当前脏文件数 */
+    size_t get_dirty_file_num();
+
 private:
     size_t expect_size, cur_size;
     file_system_manager *fs_manager;
@@ -75,6 +75,9 @@ public:
      */
     static int get_node_path(uint64_t block, uint32_t offset[4], uint32_t noffset[4]);
 
+    /* noffset(见get_node_path)对应的node是否为indirect node */
+    static bool is_indirect_node_offset(uint32_t noffset);
+
     /*
      * 封装从node和offset获取下一级nid的过程
      * 若node是inode，则cur_level应为0，否则应为非0
@@ -46,7 +46,20 @@ struct hscfs_super_block
     __le32 free_segment_count;
     __le32 next_free_nid;  // 空闲nid链表，链表尾为INVALID_NID
 
-	__u8 reserved[3964];		/* valid reserved region */
+    /* 
+     * hot/cold活跃segment，current_data/node_segment作为warm活跃segment
+     * blkoff为0表示该活跃segment还未打开(旧版本格式化的镜像中为0)
+     */
+    __le32 hot_data_segment_id;
+    __le32 hot_data_segment_blkoff;
+    __le32 cold_data_segment_id;
+    __le32 cold_data_segment_blkoff;
+    __le32 hot_node_segment_id;
+    __le32 hot_node_segment_blkoff;
+    __le32 cold_node_segment_id;
+    __le32 cold_node_segment_blkoff;
+
+	__u8 reserved[3932];		/* valid reserved region */
 };
 
 #define HSCFS_MAGIC_NUMBER 0x336699cc
@@ -185,7 +198,7 @@ struct hscfs_nat_block {
 #define SET_NEXT_SEG(raw_sit, next_seg)         \
     do  \
     { \
-        ((raw_sit)->vblocks) |= ((next_seg) << SIT_VBLOCKS_SHIFT);   \
+        ((raw_sit)->vblocks) = (((raw_sit)->vblocks) & SIT_VBLOCKS_MASK) | ((next_seg) << SIT_VBLOCKS_SHIFT);   \
     }while(0)
 
 struct hscfs_sit_entry {
@@ -20,6 +20,11 @@ class dir_data_block_cache;
 class journal_container;
 class replace_protect_manager;
 class server_thread;
+class page_pool;
+class group_committer;
+class background_flusher;
+class segment_cleaner;
+class lookup_policy;
 
 /* super_manager, SIT cache, NAT cache等对象的组合容器 */
 class file_system_manager
@@ -31,8 +36,12 @@ public:
     /* 
      * g_fs_manager初始化，必须在通信层初始化之后进行
      * 初始化文件系统缓存层资源，启动文件系统层后台线程
+     * page_cache_budget为所有文件共享的页缓存可使用的内存字节数
      */
-    static void init(comm_dev *dev);
+    static void init(comm_dev *dev, size_t page_cache_budget = default_page_cache_budget);
+
+    /* 默认的页缓存内存预算 */
+    static constexpr size_t default_page_cache_budget = 64UL * 1024 * 1024;
 
     /* 程序结束时，将所有未回写的数据回写，然后停止后台服务线程。
      * 此方法应先于日志层和通信层的析构调用，因为此方法依赖它们的功能 
@@ -105,9 +114,10 @@ public:
         return srmap_util.get();
     }
 
-    size_t get_page_cache_size() const noexcept
+    /* 获取所有文件共享的页缓存池 */
+    page_pool* get_page_pool() const noexcept
     {
-        return 32;
+        return pg_pool.get();
     }
 
     comm_dev* get_device() const noexcept
@@ -139,6 +149,30 @@ public:
         return rp_manager.get();
     }
 
+    /* 获取fsync组提交器 */
+    group_committer* get_group_committer() const noexcept
+    {
+        return committer.get();
+    }
+
+    /* 获取后台回写器 */
+    background_flusher* get_background_flusher() const noexcept
+    {
+        return flusher.get();
+    }
+
+    /* 获取segment清理器 */
+    segment_cleaner* get_segment_cleaner() const noexcept
+    {
+        return cleaner.get();
+    }
+
+    /* 获取缓存不命中时查找方式的选择策略 */
+    lookup_policy* get_lookup_policy() const noexcept
+    {
+        return lk_policy.get();
+    }
+
     server_thread* get_server_thread_handle() noexcept 
     {
         return server_th.get();
@@ -164,6 +198,9 @@ private:
     std::unique_ptr<node_block_cache> node_cache;
     std::unique_ptr<dir_data_block_cache> dir_data_cache;
     std::unique_ptr<SIT_NAT_cache> sit_cache, nat_cache;
+
+    /* 文件对象析构时会将其page从pg_pool中移除，所以pg_pool应在file_cache和fd_arr之后析构 */
+    std::unique_ptr<page_pool> pg_pool;
     std::unique_ptr<file_obj_cache> file_cache;
     std::unique_ptr<srmap_utils> srmap_util;
 
@@ -173,7 +210,11 @@ private:
 
     std::unique_ptr<journal_container> cur_journal;
     std::unique_ptr<replace_protect_manager> rp_manager;
+    std::unique_ptr<group_committer> committer;
     std::unique_ptr<server_thread> server_th;
+    std::unique_ptr<background_flusher> flusher;  // 作为server_th的周期任务执行
+    std::unique_ptr<segment_cleaner> cleaner;  // 作为server_th的周期任务执行
+    std::unique_ptr<lookup_policy> lk_policy;
     bool is_unrecoverable;
 
     static std::unique_ptr<file_system_manager> g_fs_manager;
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <chrono>
+
+#include "utils/declare_utils.hh"
+
+namespace hscfs {
+
+class file_system_manager;
+class file_handle;
+
+/* fsync组提交的统计信息 */
+struct group_commit_stat
+{
+    static constexpr size_t latency_bucket_num = 20;
+
+    uint64_t tx_num = 0;  // 组提交回写元数据的次数，即生成的事务数
+    uint64_t fsync_num = 0;  // 完成的fsync次数
+    uint64_t max_group_size = 0;  // 单个事务包含的最多fsync次数
+    uint64_t total_latency_us = 0;
+
+    /* fsync时延分布：第i个桶统计时延在[2^(i-1), 2^i)us内的fsync次数，第0个桶为<1us，最后一个桶包含所有更大的时延 */
+    uint64_t latency_hist[latency_bucket_num] = {0};
+
+    double get_commits_per_tx() const noexcept
+    {
+        return tx_num == 0 ? 0 : static_cast<double>(fsync_num) / tx_num;
+    }
+
+    /* 返回时延分布中p分位数(0 < p <= 1)所在桶的时延上界(us) */
+    uint64_t get_latency_percentile_us(double p) const noexcept;
+};
+
+/*
+ * fsync组提交
+ * 并发的fsync各自回写文件数据后加入当前组，组中第一个加入的fsync作为leader，
+ * 等待其它正在回写数据的fsync加入(最多等待window)，然后为整组回写一次元数据、生成一个事务，
+ * 等待日志写入SSD后，再唤醒组中所有fsync
+ * 同一时刻只有一组在回写元数据，期间到达的fsync组成下一组；上一组等待日志落盘时，下一组即可回写元数据
+ */
+class group_committer
+{
+public:
+    group_committer(file_system_manager *fs_manager,
+        std::chrono::microseconds window = std::chrono::microseconds(default_window_us));
+    no_copy_assignable(group_committer)
+
+    /* 默认的组提交等待窗口 */
+    static constexpr uint64_t default_window_us = 50;
+
+    /*
+     * 回写handle对应文件的数据与元数据，元数据与同组的其它fsync一起回写，在包含它的事务日志写入SSD后返回
+     * 调用者应持有fs_freeze_lock共享锁和文件的file_op_lock，不应持有fs_meta_lock
+     * 若该组回写元数据失败，组中所有fsync抛出相同的异常
+     */
+    void fsync(file_handle &handle);
+
+    group_commit_stat get_stat();
+
+private:
+    struct waiter
+    {
+        uint32_t ino;
+        bool done = false;
+        std::exception_ptr err;
+
+        waiter(uint32_t ino) : ino(ino) { }
+    };
+
+    file_system_manager *fs_manager;
+    std::chrono::microseconds window;
+
+    std::mutex mtx;  // 保护以下成员
+    std::condition_variable cond;
+    size_t active_num;  // 正在回写数据，还没有加入组的fsync数量
+    std::vector<waiter*> pending;  // 当前收集中的组
+    bool has_leader;  // 当前收集中的组是否已有leader
+    bool flushing;  // 是否有组正在回写元数据
+    group_commit_stat stat;
+
+    /* 回写组中所有文件的元数据，生成一个事务，返回需要等待落盘的事务号上界 */
+    uint64_t flush_group(const std::vector<waiter*> &group);
+
+    void record_latency(std::chrono::steady_clock::time_point start);
+};
+
+}  // namespace hscfs
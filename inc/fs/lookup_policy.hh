@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+
+#include "utils/declare_utils.hh"
+
+namespace hscfs {
+
+/* 缓存不命中时，路径解析和file mapping查询的执行方式 */
+enum class lookup_mode {
+    adaptive,  // 按代价估计，逐次选择主机侧查找或交给SSD
+    host,  // 总是在主机侧查找，按需从SSD读取目录块和node
+    ssd  // 总是交给SSD查找(新建目录中的查找除外，见path_lookup_processor)
+};
+
+/* 查找方式选择的统计信息 */
+struct lookup_policy_stat
+{
+    uint64_t host_path_num = 0;  // 在主机侧查找的目录项数
+    uint64_t ssd_path_num = 0;  // 交给SSD的路径解析次数
+    uint64_t host_filemapping_num = 0;  // 在主机侧读取的node数
+    uint64_t ssd_filemapping_num = 0;  // 交给SSD的file mapping查询次数
+    uint64_t probe_num = 0;  // 自适应模式下，为更新代价估计而选择估计代价较高的方式的次数
+
+    /* 当前的代价估计(us) */
+    double host_read_us = 0;  // 主机侧读取一个块
+    double ssd_path_us = 0;  // 一次SSD路径解析
+    double ssd_filemapping_us = 0;  // 一次SSD file mapping查询
+};
+
+/*
+ * 缓存不命中时，选择在主机侧查找还是交给SSD查找
+ *
+ * 主机侧查找的代价为需从SSD读取的块数乘以一次读的时延，块数由调用者根据缓存情况估计
+ * SSD查找的代价为一次对应命令的时延。SSD繁忙时命令排队，测得的时延随之上升，主机侧查找就会更多地被选中
+ * 两种时延都用实际测得的值做指数加权平均
+ *
+ * 自适应模式下，若一种方式连续probe_interval次未被选中，则选择它一次，以免它的代价估计过期
+ * 除set_mode和get_mode外，调用者需持有fs_meta_lock
+ */
+class lookup_policy
+{
+public:
+    /* 没有测量值时使用的初始时延估计 */
+    static constexpr double default_latency_us = 80;
+
+    /* 路径中还未查找的目录项(当前目录项之后)，估计每个需要读取inode和一个目录块 */
+    static constexpr uint32_t unknown_component_reads = 2;
+
+    static constexpr uint32_t probe_interval = 32;
+
+    lookup_policy();
+    no_copy_assignable(lookup_policy)
+
+    void set_mode(lookup_mode mode) noexcept
+    {
+        this->mode.store(mode, std::memory_order_relaxed);
+    }
+
+    lookup_mode get_mode() const noexcept
+    {
+        return mode.load(std::memory_order_relaxed);
+    }
+
+    /*
+     * 路径解析中目录项不命中时调用，返回true表示在主机侧查找该目录项，false表示将剩余路径交给SSD
+     * host_reads为主机侧查找该目录项估计需要读取的块数，remain_num为包括该目录项在内还未查找的目录项数
+     */
+    bool lookup_path_on_host(uint32_t host_reads, uint32_t remain_num);
+
+    /*
+     * file mapping查询中node不命中时调用，返回true表示在主机侧读取该node，false表示交给SSD
+     * miss_level_num为索引路径上不在缓存中的node数
+     */
+    bool search_filemapping_on_host(uint32_t miss_level_num);
+
+    /* 记录一次主机侧查找的耗时，用于更新读时延估计。host_reads为该次查找估计读取的块数 */
+    void record_host_lookup(uint32_t host_reads, std::chrono::steady_clock::time_point start);
+
+    /* 记录一次SSD命令的耗时 */
+    void record_ssd_path_lookup(std::chrono::steady_clock::time_point start);
+    void record_ssd_filemapping_search(std::chrono::steady_clock::time_point start);
+
+    const lookup_policy_stat& get_stat() const noexcept
+    {
+        return stat;
+    }
+
+private:
+    std::atomic<lookup_mode> mode;
+    lookup_policy_stat stat;
+    uint32_t host_skipped, ssd_skipped;  // 自适应模式下，两种方式各自连续未被选中的次数
+
+    /* 比较两种方式的代价，返回是否选择主机侧 */
+    bool choose_host(double host_cost, double ssd_cost);
+
+    static void update_estimate(double &estimate, double sample) noexcept;
+};
+
+}  // namespace hscfs
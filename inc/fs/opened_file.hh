@@ -3,6 +3,7 @@
 #include <mutex>
 #include <cstdint>
 #include "fs/file.hh"
+#include "fs/readahead.hh"
 
 namespace hscfs {
 
@@ -52,6 +53,7 @@ private:
     uint64_t pos;  // 当前文件读写位置
     std::mutex pos_lock;  // 保护pos的锁
     file_handle file;
+    readahead_window ra_window;  // 顺序读预读窗口，由pos_lock保护
 
     enum class rw_operation {
         read, write
@@ -2,6 +2,7 @@
 
 #include <cstring>
 #include <string>
+#include <vector>
 #include "cache/dentry_cache.hh"
 
 namespace hscfs {
@@ -106,6 +107,7 @@ private:
 
 
 class file_system_manager;
+class ssd_path_lookup_controller;
 
 /* 
  * 路径解析的执行器
@@ -143,10 +145,34 @@ public:
      */
     dentry_handle do_path_lookup(dentry_store_pos *pos_info = nullptr);
 
+    /*
+     * 批量解析多个绝对路径，返回与abs_paths一一对应的最后一级目录项handle，含义与do_path_lookup相同
+     * 每个路径先在主机侧解析到需要交给SSD查找的目录项，然后所有路径剩余的部分以异步命令同时下发给SSD，
+     * 只等待一次SSD应用日志，全部完成后依次将结果合并到dentry cache
+     * 多个不命中的路径只需等待约一次SSD命令的时延，而不是逐个等待
+     */
+    static std::vector<dentry_handle> do_batch_path_lookup(file_system_manager *fs_manager, 
+        const std::vector<std::string> &abs_paths);
+
 private:
     file_system_manager *fs_manager;
     std::string path;
     dentry_handle start_dentry;
+
+    /*
+     * 从cur_dentry开始，在主机侧(dentry cache，或由lookup_policy选择在主机侧查找目录)解析itr及之后的目录项
+     * 返回true表示解析已完成，cur_dentry为结果(为空表示不存在)，pos_info的含义与do_path_lookup相同
+     * 返回false表示itr指向的目录项需要交给SSD查找，cur_dentry为它所在的目录
+     */
+    bool lookup_on_host(const path_parser &p_parser, path_dentry_iterator &itr, dentry_handle &cur_dentry, 
+        dentry_store_pos *pos_info);
+
+    /* 将SSD从cur_dentry开始解析itr及之后目录项的结果插入dentry cache，返回最后一级目录项 */
+    dentry_handle merge_ssd_result(ssd_path_lookup_controller &ctrlr, const path_parser &p_parser, 
+        path_dentry_iterator itr, dentry_handle cur_dentry, dentry_store_pos *pos_info);
+
+    /* 从itr(包括itr)到路径末尾的目录项数 */
+    static uint32_t get_remain_component_num(path_dentry_iterator itr, const path_dentry_iterator &end_itr);
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+
+namespace hscfs {
+
+/*
+ * 顺序读检测与自适应预读窗口，每个opened_file维护一个
+ *
+ * 若一次读的起始块紧接上次读的尾后块(或仍在上次读的最后一个块内)，则认为是顺序读
+ * 顺序读时，维护一个预读窗口：当已预读但尚未被读到的page数少于窗口的一半时，发起新一轮预读，
+ * 将预读范围推进到本次读的尾后块之后window个page
+ * 
+ * 每轮预读前根据上一轮的命中情况调整窗口大小：
+ * 上一轮以来的读都命中了page cache(或预读中的page)，则窗口加倍，直到max_window
+ * 若出现了需要同步从SSD读取的page(预读的page被置换，或预读没有覆盖)，则窗口减半
+ * 非顺序读时，窗口清零，停止预读
+ * 
+ * 此对象不是线程安全的，由opened_file的pos_lock保护
+ */
+class readahead_window
+{
+public:
+    readahead_window(uint32_t max_window);
+
+    /*
+     * 一次读完成后调用，更新窗口状态
+     * [start_blkno, end_blkno)为本次读涉及的块范围，miss_num为本次读中需要同步从SSD读取的page数
+     * 若需要发起预读，返回true，并通过ra_start和ra_num返回需预读的范围
+     */
+    bool update(uint32_t start_blkno, uint32_t end_blkno, uint32_t miss_num, uint32_t &ra_start, uint32_t &ra_num);
+
+private:
+    uint32_t max_window;
+    uint32_t window;  // 当前窗口大小(page数)，为0表示当前不是顺序读
+    uint32_t pre_end_blkno;  // 上次读的尾后块号
+    uint32_t ra_end_blkno;  // 已发起预读范围的尾后块号
+    uint32_t miss_since_ra;  // 上一轮预读以来，同步从SSD读取的page数
+
+    static constexpr uint32_t init_window = 4;
+};
+
+}  // namespace hscfs
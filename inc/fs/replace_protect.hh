@@ -4,6 +4,7 @@
 #include <memory>
 #include <list>
 #include <unordered_set>
+#include <unordered_map>
 #include <mutex>
 #include <condition_variable>
 
@@ -25,7 +26,8 @@ class transaction_replace_protect_record
 public:
     transaction_replace_protect_record(uint64_t tx_id, std::list<node_block_cache_entry_handle> &&dirty_nodes_,
         std::vector<dentry_handle> &&dirty_dentrys_, std::unique_ptr<journal_container> &&tx_journal_, 
-        std::vector<uint32_t> &&uncommit_node_segs_, std::vector<uint32_t> &&uncommit_data_segs_);
+        std::vector<uint32_t> &&uncommit_node_segs_, std::vector<uint32_t> &&uncommit_data_segs_,
+        std::vector<uint32_t> &&prefree_node_segs_, std::vector<uint32_t> &&prefree_data_segs_);
 
     no_copy_assignable(transaction_replace_protect_record)
 
@@ -45,6 +47,15 @@ private:
     /* 该事务写满的node和data segments。SSD应用完日志后，将它们加入到系统的node和data segments中 */
     std::vector<uint32_t> uncommit_node_segs, uncommit_data_segs;
 
+    /* 该事务清理的node和data segments。SSD应用完日志后，将它们释放到空闲segment链表 */
+    std::vector<uint32_t> prefree_node_segs, prefree_data_segs;
+
+    /* 
+     * 该事务修改了索引树的文件：日志中NAT表项所属的文件、依赖该日志的文件、脏node所属的文件
+     * 日志应用前，SSD侧看到的这些文件的NAT表项和node可能与主机侧不一致
+     */
+    std::unordered_set<uint32_t> affected_inos;
+
 private:
     /* 只用于在内外层作用域间move */
     transaction_replace_protect_record() = default;
@@ -79,6 +90,16 @@ public:
      */
     void wait_all_journal_applied_in_SSD();
 
+    /*
+     * 等待修改了ino索引树的已提交事务(见transaction_replace_protect_record::affected_inos)都被SSD应用
+     * 只涉及ino的索引树的任务(如file mapping查询)，不需要等待其它无关事务，没有相关事务时立即返回
+     * 调用者需持有fs_meta_lock，保证等待期间不会有新事务提交
+     */
+    void wait_ino_journal_applied_in_SSD(uint32_t ino);
+
+    /* 是否有修改了ino索引树、但还未被SSD应用的已提交事务 */
+    bool is_ino_journal_pending(uint32_t ino);
+
 private:
     
     std::list<transaction_replace_protect_record> trp_list;  /* 日志还未应用的事务淘汰保护信息列表 */
@@ -89,6 +110,12 @@ private:
      */
     std::condition_variable trp_list_empty_cond;
 
+    /* trp_list中的事务修改了索引树的文件，及每个文件涉及的事务数 */
+    std::unordered_map<uint32_t, uint32_t> pending_inos;
+
+    /* 每个事务的日志被SSD应用后进行通知，调用wait_ino_journal_applied_in_SSD的线程会等待 */
+    std::condition_variable tx_applied_cond;
+
     /* 
      * 正在进行淘汰保护状态处理的已应用事务id集合
      * 即发送了replace_protect_task，但该task还没有执行完的事务
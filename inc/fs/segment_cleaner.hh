@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <unordered_set>
+#include <mutex>
+#include <chrono>
+
+#include "utils/declare_utils.hh"
+
+namespace hscfs {
+
+class file_system_manager;
+class server_thread;
+
+/* segment清理策略 */
+struct gc_policy
+{
+    std::chrono::milliseconds period{200};  // 后台清理的检查周期
+    uint32_t background_free_segs = 4;  // 空闲segment数(包括待释放的segment)低于该值时，后台立即提交回收的segment并迁移清理
+    uint32_t foreground_free_segs = 2;  // 空闲segment数低于该值时，write和fsync前同步清理
+    uint32_t max_victims_per_run = 4;  // 一轮最多清理的segment数
+};
+
+/* segment清理的统计信息 */
+struct gc_stat
+{
+    uint64_t run_num = 0;  // 执行清理的轮数(不包括跳过的轮次)
+    uint64_t foreground_run_num = 0;  // 其中同步清理的轮数
+    uint64_t victim_num = 0;  // 清理的segment数
+    uint64_t migrated_blocks = 0;  // 迁移的有效块数
+    uint64_t reclaimed_num = 0;  // 不需要迁移，直接回收的无有效块segment数
+};
+
+/*
+ * 主机侧segment清理(GC)
+ * 所有block都已无效的segment不需要迁移，直接标记为待释放
+ * 空闲空间仍不足时，按cost-benefit从node/data segment链表中选择victim segment，用migrate命令在SSD内迁移其中的有效块，
+ * 再根据SRMAP修正file mapping、NAT表和缓存中的地址，最后将victim标记为待释放，随事务一同提交
+ * 事务日志被SSD应用后，victim由淘汰保护任务释放到空闲segment链表
+ *
+ * 迁移时持有fs_freeze_lock独占，此时没有其它线程操作文件系统层，回收无有效块的segment只需要共享锁
+ * 后台清理作为服务线程的周期性任务执行，只尝试加锁；write和fsync在空闲segment不足时同步清理，限制写入速度
+ */
+class segment_cleaner
+{
+public:
+    segment_cleaner(file_system_manager *fs_manager, server_thread *server, const gc_policy &policy);
+    no_copy_assignable(segment_cleaner)
+
+    void set_policy(const gc_policy &policy);
+    gc_policy get_policy();
+
+    gc_stat get_stat();
+
+    /*
+     * 空闲segment少于foreground_free_segs时同步清理，等待清理出的segment被释放后返回
+     * 调用者不应持有任何文件系统层的锁
+     */
+    void balance();
+
+    /* 执行一轮后台清理，由服务线程周期调用 */
+    void run_background();
+
+    /*
+     * 清理最多max_victims个segment，生成一个事务，返回清理的segment数
+     * 调用者应持有fs_freeze_lock独占，不应持有fs_meta_lock
+     */
+    uint32_t clean(uint32_t max_victims);
+
+private:
+    struct victim_info
+    {
+        uint32_t segid;
+        bool is_node;
+        uint32_t valid_num;
+        double score;
+    };
+
+    file_system_manager *fs_manager;
+    server_thread *server;
+    size_t task_id;  // 在服务线程中的周期性任务id
+
+    std::mutex mtx;  // 保护policy和stat
+    gc_policy policy;
+    gc_stat stat;
+
+    /* 含有无法通过SRMAP确定归属的有效块的segment，不再选为victim。持有fs_meta_lock访问 */
+    std::unordered_set<uint32_t> bad_segs;
+
+    /* 
+     * 将记录的无有效块segment标记为待释放，返回标记的segment数
+     * 调用者持有fs_meta_lock
+     */
+    uint32_t reclaim_empty_segments();
+
+    /* 若有还未提交的待释放segment，回写所有脏元数据，生成一个事务。调用者持有fs_meta_lock */
+    void commit_prefree();
+
+    /* 迁移清理最多max_victims个segment，不提交事务。调用者持有fs_freeze_lock独占和fs_meta_lock */
+    uint32_t do_clean(uint32_t max_victims);
+
+    /*
+     * 按cost-benefit选出victim，保证迁移它们的有效块、回写当前的脏元数据所需的segment不超过空闲segment数
+     * 调用者持有fs_meta_lock
+     */
+    std::vector<victim_info> select_victims(uint32_t max_victims);
+
+    /*
+     * 迁移victim中的有效块，修正它们的映射，使victim中不再有有效块
+     * 若存在无法确定归属的有效块，不做任何修改，返回false
+     * 调用者持有fs_meta_lock
+     */
+    bool migrate_segment(const victim_info &victim);
+
+    /* 检查有效块lpa的SRMAP是否与当前映射一致 */
+    bool check_node_owner(uint32_t lpa, uint32_t nid);
+    bool check_data_owner(uint32_t lpa, uint32_t ino, uint32_t blkoff);
+
+    /* 迁移后修正lpa所在块的映射与缓存 */
+    void fix_node_mapping(uint32_t nid, uint32_t src_lpa, uint32_t dst_lpa);
+    void fix_data_mapping(uint32_t ino, uint32_t blkoff, uint32_t src_lpa, uint32_t dst_lpa);
+
+    /* 向SSD下发migrate命令，将segment中src_offs对应的块依次迁移到以dst_lpa起始的连续地址 */
+    void submit_migrate(uint32_t seg_start_lpa, const std::vector<uint32_t> &src_offs, uint32_t dst_lpa);
+};
+
+}  // namespace hscfs
@@ -1,7 +1,10 @@
 #pragma once
 
 #include <deque>
+#include <vector>
+#include <algorithm>
 #include <functional>
+#include <chrono>
 #include <mutex>
 #include <condition_variable>
 #include <thread>
@@ -38,6 +41,34 @@ public:
         th_handle.join();
     }
 
+    /* 
+     * 添加周期性任务，服务线程每隔period执行一次task，返回任务id
+     * 周期性任务与post的任务在同一线程中串行执行
+     */
+    size_t add_periodic_task(std::function<task_t> &&task, std::chrono::milliseconds period)
+    {
+        size_t id;
+        {
+            std::lock_guard<std::mutex> lg(mtx);
+            id = periodic_tasks.size();
+            periodic_tasks.push_back({std::move(task), period, std::chrono::steady_clock::now() + period});
+        }
+        cond.notify_all();
+        return id;
+    }
+
+    /* 修改周期性任务id的执行周期，从现在开始计时 */
+    void set_periodic_task_period(size_t id, std::chrono::milliseconds period)
+    {
+        {
+            std::lock_guard<std::mutex> lg(mtx);
+            periodic_task &p_task = periodic_tasks.at(id);
+            p_task.period = period;
+            p_task.next_time = std::chrono::steady_clock::now() + period;
+        }
+        cond.notify_all();
+    }
+
     void post_task(std::function<task_t> &&task)
     {
         bool need_wakeup;
@@ -54,7 +85,14 @@ private:
 
     std::deque<std::function<task_t>> task_queue;
     bool exit_req;
-    std::mutex mtx;  // 保护上两个成员的锁
+    struct periodic_task
+    {
+        std::function<task_t> task;
+        std::chrono::milliseconds period;
+        std::chrono::steady_clock::time_point next_time;
+    };
+    std::vector<periodic_task> periodic_tasks;  // 周期性任务只增加不删除，下标即任务id
+    std::mutex mtx;  // 保护以上成员的锁
     std::condition_variable cond;
 
     std::thread th_handle;
@@ -67,20 +105,48 @@ private:
 
         while (true)
         {
-            /* 若后续需要服务线程周期性的回写或GC，则需将此处修改为wait_for，增加相应逻辑 */
-            cond.wait(mtx_lg, [this]() {
+            /* 有周期性任务时，最多等待到最早的周期性任务的执行时间 */
+            auto has_task = [this]() {
                 return !this->task_queue.empty() || this->exit_req;
-            });
+            };
+            if (!periodic_tasks.empty())
+            {
+                auto next_time = periodic_tasks.front().next_time;
+                for (auto &p_task : periodic_tasks)
+                    next_time = std::min(next_time, p_task.next_time);
+                cond.wait_until(mtx_lg, next_time, has_task);
+            }
+            else
+                cond.wait(mtx_lg, has_task);
 
             if (task_queue.empty() && exit_req)  // 收到退出信号，且没有需要执行的任务，则退出
                 break;
             
             /* 还有任务需要执行 */
-            if (!task_queue.empty())  // 此处仍然增加判断(当前逻辑本不需要)，为后续wait_for做兼容
+            if (!task_queue.empty())
             {
                 std::function<task_t> task = std::move(task_queue.front());
                 task_queue.pop_front();
+
+                /* 
+                 * 执行任务时不持有mtx：任务可能等待fs_meta_lock，而持有fs_meta_lock的线程可能在等待日志处理线程，
+                 * 日志处理线程又需要通过post_task发送任务，持有mtx会导致死锁
+                 */
+                mtx_lg.unlock();
+                task();
+                mtx_lg.lock();
+            }
+
+            /* 执行到达周期的周期性任务。执行前拷贝一份，执行期间可能有其它线程添加任务 */
+            for (size_t i = 0; i < periodic_tasks.size(); ++i)
+            {
+                if (std::chrono::steady_clock::now() < periodic_tasks[i].next_time)
+                    continue;
+                std::function<task_t> task = periodic_tasks[i].task;
+                periodic_tasks[i].next_time = std::chrono::steady_clock::now() + periodic_tasks[i].period;
+                mtx_lg.unlock();
                 task();
+                mtx_lg.lock();
             }
         }
 
@@ -21,6 +21,12 @@ public:
 
     void write_srmap_of_node(uint32_t node_lpa, uint32_t nid);
 
+    /* 
+     * 读取lpa的反向映射<nid, ofs_in_node>
+     * data block为<所属文件inode号, 块偏移>，node block的nid字段为它的nid
+     */
+    std::pair<uint32_t, uint32_t> read_srmap_of_lpa(uint32_t lpa);
+
     /* 将所有dirty的srmap block写回原位 */
     void write_dirty_srmap_sync();
 
@@ -2,6 +2,11 @@
 
 #include <cstdint>
 #include <vector>
+#include <utility>
+#include <unordered_set>
+#include <atomic>
+
+struct hscfs_sit_entry;
 
 namespace hscfs {
 
@@ -10,9 +15,9 @@ class super_cache;
 
 struct lpa_alloc_context
 {
-    uint32_t &cur_seg_id;  // 指向current_data_segment_id或current_node_segment_id
+    uint32_t &cur_seg_id;  // 指向某一温度的活跃data或node segment id，如current_data_segment_id
     uint32_t seg_id_addr_offset;  // cur_seg_id在hscfs_super_block中的偏移量，记录日志用
-    uint32_t &cur_seg_off;  // 指向current_data_segment_blkoff或current_node_segment_blkoff
+    uint32_t &cur_seg_off;  // 指向cur_seg_id对应的blkoff，如current_data_segment_blkoff
     uint32_t seg_off_addr_offset;  // cur_seg_off在hscfs_super_block中的偏移量，记录日志用
     std::vector<uint32_t> &uncommit_segs;  // 指向uncommit_node_segs或uncommit_data_segs
 
@@ -25,6 +30,38 @@ struct lpa_alloc_context
     }
 };
 
+/* 
+ * 活跃segment(日志头)的温度，node和data各有hot、warm、cold三个活跃segment
+ * 更新频率相近的block写入同一segment，使segment中的block倾向于同时失效，减少segment清理的迁移量
+ */
+enum class log_temp : uint32_t {
+    hot = 0, warm, cold
+};
+
+constexpr uint32_t LOG_TEMP_NUM = 3;
+
+/* 写放大统计，WA = (所有写入的block数) / (用户写入的文件数据block数) */
+struct write_amp_stat
+{
+    uint64_t user_blks = 0;  // 回写的普通文件数据block数
+    uint64_t node_blks[LOG_TEMP_NUM] = {};  // 写入各温度node活跃segment的block数(包括清理迁移的block)
+    uint64_t data_blks[LOG_TEMP_NUM] = {};  // 写入各温度data活跃segment的block数(包括目录数据块和清理迁移的block)
+
+    uint64_t get_total_blks() const noexcept
+    {
+        uint64_t total = 0;
+        for (uint32_t i = 0; i < LOG_TEMP_NUM; ++i)
+            total += node_blks[i] + data_blks[i];
+        return total;
+    }
+
+    /* 还没有用户写入时返回0 */
+    double get_write_amplification() const noexcept
+    {
+        return user_blks == 0 ? 0 : static_cast<double>(get_total_blks()) / user_blks;
+    }
+};
+
 /* 负责超级块中的资源分配、释放和维护 */
 class super_manager
 {
@@ -44,13 +81,42 @@ public:
     void free_nid(uint32_t nid);
 
     /* 
-     * 为node/data block分配一个lpa，在对应的活跃segment上进行分配，
+     * 为node/data block分配一个lpa，在temp对应的活跃segment上进行分配，
      * 如果活跃segment已满，将其加入对应uncommit_segs，从free segs上分配一个作为新的活跃segment。
+     * hot/cold活跃segment需要新segment，但空闲segment数不超过temp_log_reserved_segs时，改为在warm活跃segment上分配
      * 内部会将lpa有效化
      * 返回分配的lpa 
      */
-    uint32_t alloc_node_lpa();
-    uint32_t alloc_data_lpa();
+    uint32_t alloc_node_lpa(log_temp temp = log_temp::warm);
+    uint32_t alloc_data_lpa(log_temp temp = log_temp::warm);
+
+    /* 
+     * 在temp对应的活跃segment上一次分配(预留)连续的lpa，活跃segment的选择与alloc_node/data_lpa相同
+     * 分配数量为num与活跃segment剩余block数中的较小值，分配位置的super block日志与SIT日志只记录一次
+     * 返回分配的lpa范围[start, end)，内部会将这些lpa有效化
+     */
+    std::pair<uint32_t, uint32_t> reserve_node_lpas(uint32_t num, log_temp temp = log_temp::warm);
+    std::pair<uint32_t, uint32_t> reserve_data_lpas(uint32_t num, log_temp temp = log_temp::warm);
+
+    /* 
+     * 设置为hot/cold活跃segment保留的空闲segment数，空闲segment不多于该值时不再打开新的hot/cold活跃segment
+     * 保证空闲空间不足、需要清理时，所有分配都在warm活跃segment上进行
+     */
+    void set_temp_log_reserved_segs(uint32_t segs) noexcept
+    {
+        temp_log_reserved_segs = segs;
+    }
+
+    /* 记录回写的普通文件数据block数，用于统计写放大 */
+    void add_user_written_blocks(uint64_t blk_num) noexcept
+    {
+        wa_stat.user_blks += blk_num;
+    }
+
+    const write_amp_stat& get_write_amp_stat() const noexcept
+    {
+        return wa_stat;
+    }
 
     /* 将segid对应的segment加入node/data segment链表，并记录修改日志 */
     void add_to_node_segment_list(uint32_t segid);
@@ -59,18 +125,89 @@ public:
     std::vector<uint32_t> get_and_clear_uncommit_node_segs();
     std::vector<uint32_t> get_and_clear_uncommit_data_segs();
 
+    uint32_t get_free_segment_count();
+
+    /* 不加锁读取空闲segment数，可能不是最新值，用于快速判断空闲空间是否充足 */
+    uint32_t get_free_segment_count_hint() const noexcept
+    {
+        return free_segment_count_hint.load(std::memory_order_relaxed);
+    }
+
+    /* 当前warm活跃node/data segment中还未分配的block数 */
+    uint32_t get_cur_node_segment_free_blocks();
+    uint32_t get_cur_data_segment_free_blocks();
+
+    /* 按链表顺序(从最近加入的segment开始)返回node/data segment链表中的所有segid */
+    std::vector<uint32_t> get_node_segments();
+    std::vector<uint32_t> get_data_segments();
+
+    /* 
+     * 将已清理(所有block都已无效)的node/data segment标记为待释放
+     * 待释放的segment随下一个事务提交，该事务的日志被SSD应用后，才能将它们释放到空闲链表
+     * 在此之前，SSD侧可能仍然使用它们中的旧数据
+     */
+    void add_prefree_node_seg(uint32_t segid);
+    void add_prefree_data_seg(uint32_t segid);
+    bool is_prefree(uint32_t segid) const;
+
+    /* 已标记待释放但还未释放的segment数 */
+    uint32_t get_prefree_segment_count() const noexcept
+    {
+        return prefree_segs.size();
+    }
+
+    std::vector<uint32_t> get_and_clear_prefree_node_segs();
+    std::vector<uint32_t> get_and_clear_prefree_data_segs();
+
+    /* 是否有还未随事务提交的待释放segment */
+    bool has_uncommit_prefree() const noexcept
+    {
+        return !prefree_node_segs.empty() || !prefree_data_segs.empty();
+    }
+
+    /* 
+     * 记录所有block都已无效的segment，由SIT_operator在segment的有效块数降为0时，
+     * 以及segment加入node/data segment链表时(若已无有效块)调用
+     */
+    void note_empty_segment(uint32_t segid);
+
+    /* 返回记录的无有效块segment并清空记录。返回的segment可能已不在链表中，或重新有了有效块 */
+    std::vector<uint32_t> get_and_clear_empty_segs();
+
+    /* 将segid从node/data segment链表中移除，加入空闲segment链表，并记录修改日志 */
+    void free_node_segment(uint32_t segid);
+    void free_data_segment(uint32_t segid);
+
 private:
     file_system_manager *fs_manager;
     super_cache &super;
     std::vector<uint32_t> uncommit_node_segs, uncommit_data_segs;
 
+    /* 还未随事务提交的待释放segment，与所有已标记待释放但还未释放的segment */
+    std::vector<uint32_t> prefree_node_segs, prefree_data_segs;
+    std::unordered_set<uint32_t> prefree_segs;
+
+    std::unordered_set<uint32_t> empty_segs;  // 有效块数降为0，等待回收的segment
+    std::atomic<uint32_t> free_segment_count_hint;  // super->free_segment_count的副本
+
+    uint32_t temp_log_reserved_segs;
+    write_amp_stat wa_stat;
+
 private:
 
     enum class lpa_alloc_type {
         node, data
     };
 
-    lpa_alloc_context create_lpa_alloc_context(lpa_alloc_type type);
+    lpa_alloc_context create_lpa_alloc_context(lpa_alloc_type type, log_temp temp);
+
+    std::pair<uint32_t, uint32_t> reserve_lpas(lpa_alloc_type type, log_temp temp, uint32_t num);
+
+    /* 
+     * 保证hot/cold活跃segment可以分配：已满时将其加入uncommit_segs并关闭，未打开时分配一个新segment打开
+     * 空闲segment不足、无法打开时返回false
+     */
+    bool prepare_temp_log(lpa_alloc_context &ctx);
 
     /* 从空闲segment链表中分配一个segment，记录修改日志，返回segment id */
     uint32_t alloc_segment();
@@ -78,7 +215,22 @@ private:
     /* 将segid加入目标链表(node或data segment链表) */
     void add_seg_to_list(uint32_t segid, uint32_t &list_head_segid, uint32_t list_head_addr_off);
 
-    uint32_t alloc_lpa_inner(lpa_alloc_context &ctx);
+    /* 在ctx对应的活跃segment上分配最多num个连续的lpa，返回[start, end) */
+    std::pair<uint32_t, uint32_t> alloc_lpa_inner(lpa_alloc_context &ctx, uint32_t num);
+
+    /* 按链表顺序返回以list_head_segid为头的segment链表 */
+    std::vector<uint32_t> get_segment_list(uint32_t list_head_segid);
+
+    /* 返回node/data segment链表中sit_entry对应segment的后继，它是链表尾时返回INVALID_SEGID */
+    uint32_t get_next_seg_in_list(const hscfs_sit_entry &sit_entry);
+
+    /* 将segid从目标链表中移除 */
+    void remove_seg_from_list(uint32_t segid, uint32_t &list_head_segid, uint32_t list_head_addr_off);
+
+    /* 将segid加入空闲segment链表 */
+    void add_seg_to_free_list(uint32_t segid);
+
+    void journal_prefree_seg(uint32_t segid);
 };
 
 }
\ No newline at end of file
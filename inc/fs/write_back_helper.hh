@@ -1,15 +1,28 @@
 #pragma once
 
 #include <cstdint>
+#include <unordered_set>
+#include <vector>
 #include "communication/comm_api.h"
+#include "fs/fs.h"
 #include "fs/SIT_utils.hh"
+#include "fs/super_manager.hh"
+#include "utils/declare_utils.hh"
+
+struct hscfs_node;
 
 namespace hscfs {
 
-class super_manager;
 class file_system_manager;
 class block_buffer;
 
+/* 文件数据回写的发起者，用于选择数据块写入的活跃segment */
+enum class write_back_source {
+    fsync,  // fsync
+    background,  // 后台回写，数据已超时未修改或脏页过多
+    other  // 文件系统退出等其它内部回写
+};
+
 /* 写回时使用的工具类。使用此类应先获取fs_meta_lock */
 class write_back_helper
 {
@@ -20,6 +33,15 @@ public:
 
 public:
     write_back_helper(file_system_manager *fs_manager);
+    ~write_back_helper();
+    no_copy_assignable(write_back_helper)
+
+    /* 
+     * 预计接下来将回写num个type类型、写入temp活跃segment的block
+     * 之后do_write_back_async从活跃segment一次预留一段连续的lpa，在本地逐个分配，每段只记录一次分配日志
+     * 析构时仍未使用的预留lpa将被无效化
+     */
+    void plan_write_back(block_type type, log_temp temp, uint32_t num);
 
     /* 
      * 将buffer对应的block回写。lpa引用缓存项的lpa字段
@@ -27,20 +49,77 @@ public:
      * 1. 为block分配一个新的物理LPA，将新LPA有效化
      * 2. 根据lpa的状态，将block的旧LPA无效化(如果有旧LPA)
      * 3. 将lpa更新为新LPA
-     * 4. 将buffer异步写入新LPA
+     * 4. 将buffer加入待提交的写，与LPA连续的其它block合并为一个写命令异步写入
      * 5. 返回新LPA
      * 注意：不更新任何反向映射
+     * 调用者应保证buffer在cb_func被调用前有效且不被修改，并在等待cb_func前调用submit_pending_writes
      */
-    uint32_t do_write_back_async(block_buffer &buffer, uint32_t &lpa, block_type type, 
+    uint32_t do_write_back_async(block_buffer &buffer, uint32_t &lpa, block_type type, log_temp temp,
         comm_async_cb_func cb_func, void *cb_arg);
 
+    /* 
+     * 下发所有待提交的写
+     * LPA连续的多个block的缓存区组成一个向量写命令下发，命令完成时依次调用每个block的回调
+     */
+    void submit_pending_writes();
+
+    /* 
+     * 活跃segment选择策略：
+     * 目录inode和目录数据块(目录项)更新频繁，写入hot；indirect node很少修改，写入cold
+     * 后台回写的文件数据已超时未修改，写入cold；fsync的文件数据和其它node写入warm
+     * segment清理迁移的block写入cold
+     */
+    static log_temp get_node_temp(const hscfs_node *node);
+    static log_temp get_file_data_temp(write_back_source src);
+
     /* 将文件系统中所有脏元数据回写，生成一个事务，提交当前日志到日志管理层，将事务淘汰保护信息交给系统管理 */
     void write_meta_back_sync();
 
+    /*
+     * 只回写inos中文件，以及依赖当前日志的文件(见journal_container::add_dependent_ino)的脏元数据，生成一个事务并提交当前日志
+     * 其它文件的脏元数据与当前日志无关，保持dirty状态，留待之后的事务提交，崩溃一致性与write_meta_back_sync相同
+     * 调用者应先回写inos中文件的数据
+     */
+    void write_files_meta_back_sync(const std::unordered_set<uint32_t> &inos);
+
 private:
+    /* 一种block类型和温度的预留lpa */
+    struct lpa_stream
+    {
+        uint32_t next_lpa = INVALID_LPA, end_lpa = INVALID_LPA;  // 已预留还未分配的lpa范围[next_lpa, end_lpa)
+        uint32_t planned = 0;  // 预计还要分配、但还未预留的block数
+    };
+
+    /* 等待合并的一个block */
+    struct pending_write
+    {
+        char *buf;
+        comm_async_cb_func cb_func;
+        void *cb_arg;
+    };
+
+    /* 一个写命令最多合并的block数 */
+    static constexpr uint32_t max_blocks_per_write = 32;
+
     file_system_manager *fs_manager;
     super_manager *super;
     SIT_operator sit_operator;
+    lpa_stream streams[2][LOG_TEMP_NUM];  // 以block_type和log_temp为下标
+
+    /* 待提交的写，LPA为[pending_start_lpa, pending_start_lpa + pending.size()) */
+    uint32_t pending_start_lpa;
+    std::vector<pending_write> pending;
+
+    lpa_stream& get_stream(block_type type, log_temp temp) noexcept
+    {
+        return streams[static_cast<uint32_t>(type)][static_cast<uint32_t>(temp)];
+    }
+
+    /* 优先从预留的lpa中分配，没有预留时从super_manager分配 */
+    uint32_t alloc_lpa(block_type type, log_temp temp);
+
+    /* inos为nullptr时回写所有脏元数据，否则只回写inos中文件的脏元数据 */
+    void do_write_meta_back_sync(const std::unordered_set<uint32_t> *inos);
 };
 
 }  // namespace hscfs
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <vector>
+#include <unordered_set>
 #include "journal/journal_type.h"
 
 namespace hscfs {
@@ -26,6 +27,20 @@ public:
         SIT_journal.emplace_back(entry);
     }
 
+    /* 
+     * 记录依赖当前日志的文件：这些文件的脏元数据与日志中的修改相关联(如分配/释放了它们的nid、修改了它们的目录项)，
+     * 必须与日志在同一个事务中提交，否则崩溃恢复后元数据不一致
+     */
+    void add_dependent_ino(uint32_t ino)
+    {
+        dependent_inos.insert(ino);
+    }
+
+    const std::unordered_set<uint32_t>& get_dependent_inos() const noexcept
+    {
+        return dependent_inos;
+    }
+
     uint64_t get_tx_id() const noexcept
     {
         return tx_id;
@@ -60,6 +75,7 @@ private:
     std::vector<super_block_journal_entry> super_block_journal;
     std::vector<NAT_journal_entry> NAT_journal;
     std::vector<SIT_journal_entry> SIT_journal;
+    std::unordered_set<uint32_t> dependent_inos;
 
     uint64_t tx_id;  // 事务号
 
@@ -35,6 +35,24 @@ public:
     // 提交日志，应在alloc_tx_id之后调用，调用者负责使用alloc_tx_id为journal分配事务号
     void commit_journal(journal_container *journal);
 
+    /*
+     * 返回已提交事务的事务号上界：事务号小于该值的事务都已提交
+     * 事务在fs_meta_lock保护下按事务号顺序提交，所以持有fs_meta_lock时获取的值包含了此前提交的所有事务
+     */
+    uint64_t get_committed_tx_end();
+
+    // 返回已写入SSD的事务号上界：事务号小于该值的事务日志都已写入SSD
+    uint64_t get_persisted_tx_end();
+
+    /* 
+     * 阻塞等待，直到事务号小于tx_end的事务日志都已写入SSD日志区域(不等待SSD应用日志)
+     * 日志写入SSD后即可保证持久化，故障恢复时会重放这些日志
+     */
+    void wait_tx_persisted(uint64_t tx_end);
+
+    // 由日志处理线程调用，通知事务号不大于tx_id的事务日志已写入SSD
+    void notify_tx_persisted(uint64_t tx_id);
+
     // 日志处理环境初始化
     void init(comm_dev *dev, uint64_t journal_start_lpa, uint64_t journal_end_lpa, 
         uint64_t journal_fifo_pos);
@@ -54,6 +72,11 @@ private:
     std::mutex mtx;
     std::condition_variable cond;
 
+    // 已提交、已写入SSD的事务号上界，受mtx保护，persist_cond用于通知等待日志落盘的线程
+    uint64_t committed_tx_end = 0;
+    uint64_t persisted_tx_end = 0;
+    std::condition_variable persist_cond;
+
     std::thread process_thread_handle;
 
     std::atomic<uint64_t> tx_id_to_alloc;
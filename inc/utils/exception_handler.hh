@@ -12,7 +12,7 @@ class file_system_manager;
 class exception_handler
 {
 public:
-    exception_handler(file_system_manager *fs_manager, const std::exception &except): e(except) {}
+    exception_handler(file_system_manager *fs_manager, const std::exception &except): fs_manager(fs_manager), e(except) {}
 
     /* 
      * 转换异常对象到errno
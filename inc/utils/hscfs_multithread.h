@@ -76,6 +76,18 @@ __attribute__((unused)) static int rwlock_wrlock(rwlock_t *self)
     return pthread_rwlock_wrlock(self);
 }
 
+/* 尝试加共享读锁，失败时返回EBUSY */
+__attribute__((unused)) static int rwlock_tryrdlock(rwlock_t *self)
+{
+    return pthread_rwlock_tryrdlock(self);
+}
+
+/* 尝试加独占写锁，失败时返回EBUSY */
+__attribute__((unused)) static int rwlock_trywrlock(rwlock_t *self)
+{
+    return pthread_rwlock_trywrlock(self);
+}
+
 __attribute__((unused)) static int rwlock_unlock(rwlock_t *self)
 {
     return pthread_rwlock_unlock(self);
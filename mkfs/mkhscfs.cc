@@ -211,6 +211,16 @@ static int format_super(uint64_t lpa_num)
     super_buffer->first_node_segment_id = INVALID_SEGID;
     super_buffer->first_data_segment_id = INVALID_SEGID;
 
+    /* hot/cold活跃segment在首次使用时打开 */
+    super_buffer->hot_data_segment_id = INVALID_SEGID;
+    super_buffer->hot_data_segment_blkoff = 0;
+    super_buffer->cold_data_segment_id = INVALID_SEGID;
+    super_buffer->cold_data_segment_blkoff = 0;
+    super_buffer->hot_node_segment_id = INVALID_SEGID;
+    super_buffer->hot_node_segment_blkoff = 0;
+    super_buffer->cold_node_segment_id = INVALID_SEGID;
+    super_buffer->cold_node_segment_blkoff = 0;
+
     /* 初始化根目录inode和空闲nid链表头。nid链表连接将在初始化NAT时进行 */
     super_buffer->root_ino = ROOT_INO;
     super_buffer->next_free_nid = ROOT_INO + 1;
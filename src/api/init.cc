@@ -12,12 +12,16 @@
 
 #include <string>
 #include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <cerrno>
 #include <sys/sysinfo.h>
 
 namespace hscfs {
 
 #define CHANNEL_NUM_DEFAULT 4
 #define TRID_CONFIG_PREFIX "--trid="
+#define PAGE_CACHE_SIZE_CONFIG_PREFIX "--page-cache-size="
 
 struct Device_Env
 {
@@ -68,6 +72,53 @@ std::string parse_trid_from_argv(int argc, char *argv[])
     return trid;
 }
 
+/* 
+ * 解析页缓存内存预算(字节数)，支持K、M、G后缀，如--page-cache-size=256M
+ * 未设置或格式错误时，使用默认预算
+ */
+size_t parse_page_cache_size_from_argv(int argc, char *argv[])
+{
+    const std::string prefix = PAGE_CACHE_SIZE_CONFIG_PREFIX;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strncmp(argv[i], prefix.c_str(), prefix.length()) != 0)
+            continue;
+        const char *val = argv[i] + prefix.length();
+        char *end = nullptr;
+        errno = 0;
+        unsigned long long size = std::strtoull(val, &end, 10);
+        unsigned shift = 0;
+        switch (*end)
+        {
+        case 'G': case 'g':
+            shift = 30;
+            ++end;
+            break;
+        case 'M': case 'm':
+            shift = 20;
+            ++end;
+            break;
+        case 'K': case 'k':
+            shift = 10;
+            ++end;
+            break;
+        default:
+            break;
+        }
+
+        /* 数值或移位后超出size_t范围的，与格式错误同样处理 */
+        if (end == val || *end != '\0' || size == 0 || errno == ERANGE || size > (SIZE_MAX >> shift))
+        {
+            HSCFS_LOG(HSCFS_LOG_WARNING, "invalid page cache size %s, use default.", val);
+            break;
+        }
+        size <<= shift;
+        HSCFS_LOG(HSCFS_LOG_INFO, "setting page cache size to %llu bytes.", size);
+        return size;
+    }
+    return file_system_manager::default_page_cache_budget;
+}
+
 bool probe_cb(void *cb_ctx, const struct spdk_nvme_transport_id *trid, struct spdk_nvme_ctrlr_opts *opts)
 {
 	HSCFS_LOG(HSCFS_LOG_INFO, "Attaching to %s\n", trid->traddr);
@@ -280,7 +331,7 @@ int init(int argc, char *argv[])
 
         /* 初始化文件系统层 */
         HSCFS_LOG(HSCFS_LOG_INFO, "Initializing file system layer...");
-        file_system_manager::init(&device_env.dev);
+        file_system_manager::init(&device_env.dev, parse_page_cache_size_from_argv(argc, argv));
 
         /* 初始化日志管理层 */
         HSCFS_LOG(HSCFS_LOG_INFO, "Initializing journal layer...");
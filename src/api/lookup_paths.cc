@@ -0,0 +1,60 @@
+#include "cache/dentry_cache.hh"
+#include "fs/fs_manager.hh"
+#include "fs/path_utils.hh"
+#include "utils/lock_guards.hh"
+#include "utils/exception_handler.hh"
+#include "utils/hscfs_log.h"
+
+#include <vector>
+
+namespace hscfs {
+
+/*
+ * 批量解析num个路径，将结果加入目录项缓存，之后open、unlink等对这些路径的解析可以直接命中缓存
+ * 不命中的路径同时交给SSD解析，用于打开或检查大量文件之前(如构建系统、文件同步)，避免逐个等待SSD
+ * 若exist不为nullptr，则exist[i]被置为pathnames[i]是否存在
+ * 目录项缓存容量有限，一次解析的路径数超过缓存容量时，先解析的结果可能被置换
+ *
+ * 成功返回0。若出错，返回-1，置errno为：
+ * EINVAL：某个pathname不合法
+ * ENOTRECOVERABLE：文件系统出现内部错误，无法恢复正常状态
+ */
+int lookup_paths(const char *const pathnames[], size_t num, bool exist[])
+{
+    file_system_manager *fs_manager = file_system_manager::get_instance();
+    try 
+    {
+        rwlock_guard fs_freeze_lg(fs_manager->get_fs_freeze_lock(), rwlock_guard::lock_type::rdlock);
+        std::lock_guard<std::mutex> fs_meta_lg(fs_manager->get_fs_meta_lock());
+        fs_manager->check_state();
+
+        try
+        {
+            std::vector<std::string> abs_paths;
+            abs_paths.reserve(num);
+            for (size_t i = 0; i < num; ++i)
+                abs_paths.emplace_back(path_helper::extract_abs_path(pathnames[i]));
+
+            std::vector<dentry_handle> dentrys = path_lookup_processor::do_batch_path_lookup(fs_manager, abs_paths);
+            HSCFS_LOG(HSCFS_LOG_INFO, "lookup paths: %zu paths resolved.", num);
+            if (exist != nullptr)
+            {
+                for (size_t i = 0; i < num; ++i)
+                    exist[i] = dentrys[i].is_exist();
+            }
+            return 0;
+        }
+        catch (const std::exception &e)
+        {
+            errno = exception_handler(fs_manager, e).convert_to_errno(true);
+            return -1;
+        }
+    } 
+    catch (const std::exception &e) 
+    {
+        errno = exception_handler(fs_manager, e).convert_to_errno();
+        return -1;
+    }
+}
+
+}  // namespace hscfs
@@ -1,6 +1,7 @@
 #include "fs/fd_array.hh"
 #include "fs/fs_manager.hh"
 #include "fs/opened_file.hh"
+#include "fs/segment_cleaner.hh"
 #include "utils/lock_guards.hh"
 #include "utils/exception_handler.hh"
 
@@ -11,6 +12,9 @@ ssize_t write(int fd, void *buffer, size_t count)
     file_system_manager *fs_manager = file_system_manager::get_instance();
     try
     {
+        /* 空闲segment不足时先同步清理，限制写入速度，防止之后回写时无法分配segment */
+        fs_manager->get_segment_cleaner()->balance();
+
         rwlock_guard fs_freeze_lg(fs_manager->get_fs_freeze_lock(), rwlock_guard::lock_type::rdlock);
         opened_file *file = fs_manager->get_fd_array()->get_opened_file_of_fd(fd);
         return file->write(static_cast<char*>(buffer), count);
@@ -99,7 +99,7 @@ std::pair<dir_data_block_handle, block_addr_info> dir_data_cache_helper::get_dir
         if (addr.lpa == INVALID_LPA)
             return std::make_pair(dir_data_block_handle(), addr);
 
-        block_buffer buffer;
+        block_buffer buffer(false);
         try
         {
             buffer.read_from_lpa(fs_manager->get_device(), addr.lpa);
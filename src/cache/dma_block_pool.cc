@@ -0,0 +1,198 @@
+#include "cache/dma_block_pool.hh"
+#include "communication/memory.h"
+#include "utils/hscfs_exceptions.hh"
+#include "utils/hscfs_log.h"
+
+#include <cstring>
+#include <algorithm>
+
+namespace hscfs {
+
+/* 本线程的线程缓存是否已经析构，平凡类型的thread_local不会析构，线程退出的全过程中都可以访问 */
+static thread_local bool thread_cache_destroyed = false;
+
+dma_block_pool::thread_cache::thread_cache(dma_block_pool *pool)
+{
+    this->pool = pool;
+    std::lock_guard<std::mutex> lg(pool->depot_mtx);
+    pool->thread_caches.push_back(this);
+}
+
+dma_block_pool::thread_cache::~thread_cache()
+{
+    thread_cache_destroyed = true;
+    pool->flush(*this, num.load(std::memory_order_relaxed));
+    std::lock_guard<std::mutex> lg(pool->depot_mtx);
+    pool->retired_stat.alloc_num += alloc_num.load(std::memory_order_relaxed);
+    pool->retired_stat.thread_cache_hit += hit_num.load(std::memory_order_relaxed);
+    pool->retired_stat.zeroed_num += zeroed_num.load(std::memory_order_relaxed);
+    auto &caches = pool->thread_caches;
+    caches.erase(std::find(caches.begin(), caches.end(), this));
+}
+
+dma_block_pool *dma_block_pool::get_instance()
+{
+    static dma_block_pool *instance = new dma_block_pool();
+    return instance;
+}
+
+dma_block_pool::thread_cache *dma_block_pool::get_thread_cache()
+{
+    if (thread_cache_destroyed)
+        return nullptr;
+    thread_local thread_cache tc(this);
+    return &tc;
+}
+
+/* 只由所属线程修改的计数，不需要原子读改写 */
+template <typename T>
+static inline void local_add(std::atomic<T> &cnt, T val) noexcept
+{
+    cnt.store(cnt.load(std::memory_order_relaxed) + val, std::memory_order_relaxed);
+}
+
+char *dma_block_pool::alloc(bool zero)
+{
+    thread_cache *p_tc = get_thread_cache();
+    if (p_tc == nullptr)
+        return alloc_from_depot(zero);
+
+    thread_cache &tc = *p_tc;
+    local_add<uint64_t>(tc.alloc_num, 1);
+    if (tc.head == nullptr)
+        refill(tc);
+    else
+        local_add<uint64_t>(tc.hit_num, 1);
+
+    free_block *blk = tc.head;
+    tc.head = blk->next;
+    local_add<size_t>(tc.num, -1);
+
+    if (zero)
+    {
+        std::memset(blk, 0, block_size);
+        local_add<uint64_t>(tc.zeroed_num, 1);
+    }
+    return reinterpret_cast<char*>(blk);
+}
+
+void dma_block_pool::free(char *blk) noexcept
+{
+    if (blk == nullptr)
+        return;
+    free_block *fb = reinterpret_cast<free_block*>(blk);
+    thread_cache *p_tc = get_thread_cache();
+    if (p_tc == nullptr)
+    {
+        free_to_depot(fb);
+        return;
+    }
+
+    thread_cache &tc = *p_tc;
+    fb->next = tc.head;
+    tc.head = fb;
+    local_add<size_t>(tc.num, 1);
+    if (tc.num.load(std::memory_order_relaxed) > thread_cache_limit)
+        flush(tc, batch_size);
+}
+
+dma_block_pool_stat dma_block_pool::get_stat()
+{
+    std::lock_guard<std::mutex> lg(depot_mtx);
+    dma_block_pool_stat stat = retired_stat;
+    stat.slab_num = slabs.size();
+    stat.total_blocks = slabs.size() * blocks_per_slab;
+    stat.free_blocks = depot_num;
+    for (thread_cache *tc : thread_caches)
+    {
+        stat.free_blocks += tc->num.load(std::memory_order_relaxed);
+        stat.alloc_num += tc->alloc_num.load(std::memory_order_relaxed);
+        stat.thread_cache_hit += tc->hit_num.load(std::memory_order_relaxed);
+        stat.zeroed_num += tc->zeroed_num.load(std::memory_order_relaxed);
+    }
+    return stat;
+}
+
+void dma_block_pool::refill(thread_cache &tc)
+{
+    std::lock_guard<std::mutex> lg(depot_mtx);
+    if (depot_head == nullptr)
+        add_slab();
+
+    /* 从全局链表头部摘下最多batch_size个块，整段接到线程缓存 */
+    free_block *first = depot_head, *last = depot_head;
+    size_t n = 1;
+    while (n < batch_size && last->next != nullptr)
+    {
+        last = last->next;
+        ++n;
+    }
+    depot_head = last->next;
+    depot_num -= n;
+    last->next = tc.head;
+    tc.head = first;
+    local_add<size_t>(tc.num, n);
+}
+
+void dma_block_pool::flush(thread_cache &tc, size_t num) noexcept
+{
+    if (num == 0)
+        return;
+    free_block *first = tc.head, *last = tc.head;
+    for (size_t i = 1; i < num; ++i)
+        last = last->next;
+    tc.head = last->next;
+    local_add<size_t>(tc.num, -num);
+
+    std::lock_guard<std::mutex> lg(depot_mtx);
+    last->next = depot_head;
+    depot_head = first;
+    depot_num += num;
+}
+
+char *dma_block_pool::alloc_from_depot(bool zero)
+{
+    free_block *blk;
+    {
+        std::lock_guard<std::mutex> lg(depot_mtx);
+        if (depot_head == nullptr)
+            add_slab();
+        blk = depot_head;
+        depot_head = blk->next;
+        --depot_num;
+        ++retired_stat.alloc_num;
+        if (zero)
+            ++retired_stat.zeroed_num;
+    }
+
+    if (zero)
+        std::memset(blk, 0, block_size);
+    return reinterpret_cast<char*>(blk);
+}
+
+void dma_block_pool::free_to_depot(free_block *blk) noexcept
+{
+    std::lock_guard<std::mutex> lg(depot_mtx);
+    blk->next = depot_head;
+    depot_head = blk;
+    ++depot_num;
+}
+
+void dma_block_pool::add_slab()
+{
+    slabs.reserve(slabs.size() + 1);
+    char *slab = static_cast<char*>(comm_alloc_dma_mem_aligned(blocks_per_slab * block_size, block_size));
+    if (slab == nullptr)
+        throw alloc_error("dma block pool: alloc slab failed.");
+    slabs.push_back(slab);
+    for (size_t i = blocks_per_slab; i > 0; --i)
+    {
+        free_block *blk = reinterpret_cast<free_block*>(slab + (i - 1) * block_size);
+        blk->next = depot_head;
+        depot_head = blk;
+    }
+    depot_num += blocks_per_slab;
+    HSCFS_LOG(HSCFS_LOG_INFO, "dma block pool: alloc slab %zu.", slabs.size());
+}
+
+}  // namespace hscfs
@@ -0,0 +1,91 @@
+#include "cache/extent_cache.hh"
+
+#include <iterator>
+
+namespace hscfs {
+
+bool extent_cache::lookup(uint32_t blkoff, uint32_t &lpa)
+{
+    /* 找到起始块偏移不大于blkoff的最后一个extent */
+    auto it = extents.upper_bound(blkoff);
+    if (it != extents.begin())
+    {
+        --it;
+        if (blkoff - it->first < it->second.len)
+        {
+            lpa = it->second.lpa + (blkoff - it->first);
+            ++stat.hit_num;
+            return true;
+        }
+    }
+    ++stat.miss_num;
+    return false;
+}
+
+void extent_cache::insert(uint32_t blkoff, uint32_t lpa, uint32_t len)
+{
+    if (len == 0)
+        return;
+    remove(blkoff, blkoff + len);
+    if (extents.size() >= max_extent_num)
+        extents.clear();
+
+    /* 与前一个extent块偏移和lpa都连续时，直接延长它 */
+    auto cur = extents.lower_bound(blkoff);
+    if (cur != extents.begin())
+    {
+        auto prev = std::prev(cur);
+        if (prev->first + prev->second.len == blkoff && prev->second.lpa + prev->second.len == lpa)
+        {
+            prev->second.len += len;
+            cur = prev;
+        }
+        else
+            cur = extents.emplace_hint(cur, blkoff, extent{len, lpa});
+    }
+    else
+        cur = extents.emplace_hint(cur, blkoff, extent{len, lpa});
+
+    /* 与后一个extent连续时，将其合并 */
+    auto next = std::next(cur);
+    if (next != extents.end() && cur->first + cur->second.len == next->first &&
+        cur->second.lpa + cur->second.len == next->second.lpa)
+    {
+        cur->second.len += next->second.len;
+        extents.erase(next);
+    }
+}
+
+void extent_cache::remove(uint32_t start_blkoff, uint32_t end_blkoff)
+{
+    if (start_blkoff >= end_blkoff)
+        return;
+
+    /* 起始于start_blkoff之前、与删除范围重叠的extent，保留前后不重叠的部分 */
+    auto it = extents.lower_bound(start_blkoff);
+    if (it != extents.begin())
+    {
+        auto prev = std::prev(it);
+        uint64_t prev_end = uint64_t(prev->first) + prev->second.len;
+        if (prev_end > start_blkoff)
+        {
+            if (prev_end > end_blkoff)
+                extents.emplace_hint(it, end_blkoff,
+                    extent{uint32_t(prev_end - end_blkoff), prev->second.lpa + (end_blkoff - prev->first)});
+            prev->second.len = start_blkoff - prev->first;
+        }
+    }
+
+    /* 起始于删除范围内的extent，只保留超出end_blkoff的部分 */
+    it = extents.lower_bound(start_blkoff);
+    while (it != extents.end() && it->first < end_blkoff)
+    {
+        uint64_t ext_end = uint64_t(it->first) + it->second.len;
+        if (ext_end > end_blkoff)
+            extents.emplace(end_blkoff, extent{uint32_t(ext_end - end_blkoff),
+                it->second.lpa + (end_blkoff - it->first)});
+        it = extents.erase(it);
+    }
+}
+
+}  // namespace hscfs
@@ -22,7 +22,7 @@ void node_block_cache::sub_refcount(node_block_cache_entry *entry)
     --entry->ref_count;
     if (entry->ref_count == 0)
     {
-        cache_manager.unpin(entry->nid);
+        cache_manager.unpin(entry->nid, entry);
 
         /* 如果该node block需要删除，则减少其父结点的引用计数，释放它的FS资源，把它移除缓存 */
         if (entry->state == node_block_cache_entry_state::deleted)
@@ -42,7 +42,7 @@ void node_block_cache::sub_refcount(node_block_cache_entry *entry)
             /* 将缓存项移除 */
             uint32_t nid = entry->nid;
             uint32_t parent_nid = entry->parent_nid;
-            cache_manager.remove(nid);
+            cache_manager.remove(nid, entry);
             --cur_size;
 
             /* 减少父结点的引用计数 */
@@ -158,7 +158,7 @@ node_block_cache_entry_handle node_cache_helper::get_node_entry(uint32_t nid, ui
         /* 从NAT表中得到nid block的lpa */
         uint32_t nid_lpa = nat_lpa_mapping(fs_manager).get_lpa_of_nid(nid);
 
-        block_buffer buf;
+        block_buffer buf(false);
         try {
             buf.read_from_lpa(dev, nid_lpa);
         }
@@ -3,95 +3,173 @@
 #include "utils/hscfs_log.h"
 #include "fs/fs.h"
 #include <system_error>
+#include <algorithm>
 
 namespace hscfs {
 
-page_cache::page_cache(size_t expect_size)
+page_pool::page_pool(size_t budget)
 {
-    int ret = spin_init(&cache_lock);
+    int ret = spin_init(&pool_lock);
     if (ret != 0)
         throw std::system_error(std::error_code(ret, std::generic_category()), 
-            "page cache: init cache spin failed.");
-    /* 任意对锁初始化失败的异常均为panic，上层应该捕获异常并终止程序，故此处不再释放成功初始化的锁 */
-    ret = spin_init(&dirty_pages_lock);
+            "page pool: init pool spin failed.");
+    budget_pages = std::max<size_t>(budget / 4096, 1);
+    cur_pages = 0;
+    next_generation = 0;
+}
+
+page_pool::~page_pool()
+{
+    /* 所有page_cache应先于page_pool析构，析构时会将它们的page从page_pool中移除 */
+    if (cur_pages != 0)
+        HSCFS_LOG(HSCFS_LOG_WARNING, "page pool still has %zu pages while destructed.", cur_pages);
+    int ret = spin_destroy(&pool_lock);
+    if (ret != 0)
+        HSCFS_ERRNO_LOG(HSCFS_LOG_WARNING, ret, "page pool: destroy pool spin failed.");
+}
+
+size_t page_pool::get_cur_pages()
+{
+    spin_lock_guard lg(pool_lock);
+    return cur_pages;
+}
+
+/* 调用者需要获取pool_lock */
+std::unique_ptr<page_entry> page_pool::alloc_entry()
+{
+    if (cur_pages >= budget_pages && replacer.get_num_can_replace() != 0)
+        return evict(replacer.pop_replaced());
+    
+    ++cur_pages;
+    return std::make_unique<page_entry>(0);
+}
+
+/* 调用者需要获取pool_lock */
+void page_pool::do_replace(std::vector<std::unique_ptr<page_entry>> &evicted)
+{
+    while (cur_pages > budget_pages && replacer.get_num_can_replace() != 0)
+    {
+        evicted.emplace_back(evict(replacer.pop_replaced()));
+        --cur_pages;
+    }
+}
+
+/* 调用者需要获取pool_lock，且victim已从replacer中移除 */
+std::unique_ptr<page_entry> page_pool::evict(const page_key &victim)
+{
+    page_cache *owner = victim.owner;
+    std::unique_ptr<page_entry> ret = owner->index.remove(victim.blkoff);
+    assert(ret->ref_count == 0 && ret->is_dirty.load() == false);
+    HSCFS_LOG(HSCFS_LOG_INFO, "replace page cache entry, blkoff = %u", victim.blkoff);
+    --owner->cur_size;
+    return ret;
+}
+
+page_cache::page_cache(page_pool *pool)
+{
+    int ret = spin_init(&dirty_pages_lock);
     if (ret != 0)
         throw std::system_error(std::error_code(ret, std::generic_category()), 
             "page cache: init dirty page set spin failed.");
 
-    this->expect_size = expect_size;
+    this->pool = pool;
     cur_size = 0;
+    inflight_read_num = 0;
+    {
+        spin_lock_guard lg(pool->pool_lock);
+        generation = pool->next_generation++;
+    }
 }
 
 page_cache::~page_cache()
 {
-    // page cache析构内不会并发访问，不加锁
+    /* 异步读的回调会访问page cache，必须等待它们完成 */
+    wait_all_async_read();
+
+    // page cache析构内不会并发访问本文件的page，只需在操作page_pool时加锁
     if (!dirty_pages.empty())
+    {
         HSCFS_LOG(HSCFS_LOG_WARNING, "Page cache still has dirty page while destructed. "
             "If delete a file which written but not synchronized, this will be OK.");
+        clear_dirty_pages();
+    }
+
+    /* 
+     * 将本文件的所有page从page_pool中移除，在解锁后再释放它们的资源
+     * 置换器的幽灵队列中可能残留本文件的key，它们只影响之后的置换选择，不影响正确性
+     */
+    cache_hash_index<uint32_t, page_entry> removed;
+    {
+        spin_lock_guard lg(pool->pool_lock);
+        for (auto itr = index.begin(); itr != index.end(); ++itr)
+            pool->replacer.remove(get_key(itr->first));
+        pool->cur_pages -= cur_size;
+        std::swap(removed, index);
+        cur_size = 0;
+    }
 }
 
 page_entry_handle page_cache::get(uint32_t blkoff)
 {
-    spin_lock_guard lg(cache_lock);
-    page_entry *p_entry = cache_manager.get(blkoff);
+    /* 被置换的page在pool_lock释放后析构，因此须先于lg定义 */
+    std::vector<std::unique_ptr<page_entry>> evicted;
+    spin_lock_guard lg(pool->pool_lock);
+    page_entry *p_entry = index.get(blkoff);
     
-    /* 缓存项不存在，则需要新建一个 */
+    /* 缓存项不存在，则从page_pool获取一个(可能置换了其它文件的page) */
     if (p_entry == nullptr)
     {
-        /*
-         * 如果当前缓存数量已达到阈值，则尝试置换一个，直接把置换出的page_entry资源移动给新缓存项
-         * 如果无法置换，再新建
-         * 防止多次分配和释放4KB block
-         */
-        if (cur_size >= expect_size)
-        {
-            auto victim = cache_manager.replace_one();
-            if (victim != nullptr)
-            {
-                assert(victim->ref_count == 0 && victim->is_dirty.load() == false);
-                HSCFS_LOG(HSCFS_LOG_INFO, "replace page cache entry, blkoff = %u", victim->blkoff);
-                victim->blkoff = blkoff;
-                victim->content_state = page_state::invalid;
-
-                p_entry = victim.get();
-                cache_manager.add(blkoff, victim);
-                add_refcount(p_entry);
+        std::unique_ptr<page_entry> new_entry = pool->alloc_entry();
+        new_entry->blkoff = blkoff;
+        new_entry->lpa = INVALID_LPA;
+        new_entry->lpa_unresolved = false;
+        new_entry->content_state = page_state::invalid;
+        new_entry->zero = false;
 
-                do_replace();  // 尝试将先前无法淘汰的缓存项淘汰掉，否则page_cache中缓存项数量单调不减
-            }
-        }
+        p_entry = new_entry.get();
+        index.add(blkoff, new_entry);
+        pool->replacer.add(get_key(blkoff));
+        add_refcount(p_entry);
+        ++cur_size;
 
-        /* 到此处，说明要么缓存容量充足，要么找不到能置换的缓存项，则直接增加一项 */
-        if (p_entry == nullptr)
-        {
-            auto new_entry = std::make_unique<page_entry>(blkoff);
-            p_entry = new_entry.get();
-            cache_manager.add(blkoff, new_entry);
-            add_refcount(p_entry);
-            ++cur_size;
-        }
+        pool->do_replace(evicted);  // 尝试将先前无法淘汰的缓存项淘汰掉，否则总页数单调不减
     }
 
     /* 缓存项存在，增加引用计数即可 */
     else
+    {
+        pool->replacer.access(get_key(blkoff));
         add_refcount(p_entry);
+    }
 
     return page_entry_handle(p_entry, this);
 }
 
-void page_cache::truncate(uint32_t max_blkoff)
+void page_cache::truncate(uint32_t blk_num)
 {
-    /* 由于调用者已经加了file_op_lock，内部不用加任何锁了 */
-    auto start_itr = dirty_pages.upper_bound(max_blkoff);
+    /* 等待所有预读完成，防止截断后预读的I/O将已释放的块读入page cache */
+    wait_all_async_read();
+
+    /* 
+     * 范围外的干净page也要置为invalid，否则文件再次扩展后会读到截断前的旧内容
+     * 本文件的page只有调用者能访问(file_op_lock独占)，加pool_lock只是为了遍历索引时与其它文件的置换互斥
+     */
+    {
+        spin_lock_guard lg(pool->pool_lock);
+        for (auto itr = index.begin(); itr != index.end(); ++itr)
+        {
+            if (itr->first >= blk_num)
+                itr->second->content_state = page_state::invalid;
+        }
+    }
+
+    /* 由于调用者已经加了file_op_lock，内部不用加dirty_pages_lock了 */
+    auto start_itr = dirty_pages.lower_bound(blk_num);
     for (auto itr = start_itr; itr != dirty_pages.end(); ++itr)
     {
-        /* 将范围外的所有page的dirty标记清除，标记为invalid */
+        /* 将范围外的所有page的dirty标记清除 */
         auto &handle = itr->second;
         handle->is_dirty = false;
-        handle->content_state = page_state::invalid;
-
-        /* 范围外的page将被移除，所以递减cur_size */
-        --cur_size;
     }
 
     /* 从dirty pages集合中移除范围外的所有page */
@@ -106,7 +184,86 @@ void page_cache::clear_dirty_pages()
     dirty_pages.clear();
 }
 
-/* 调用者需要加cache_lock，除非能够保证调用时ref_count不会为0 */
+void page_cache::read_page_async(page_entry_handle &page, comm_dev *dev, uint32_t lpa)
+{
+    assert(page->get_state() == page_state::invalid);
+    std::unique_ptr<async_read_ctx> ctx(new async_read_ctx{this, page});
+    page->set_lpa(lpa);
+    page->set_state(page_state::reading);
+    {
+        std::lock_guard<std::mutex> lg(async_read_mtx);
+        ++inflight_read_num;
+    }
+
+    try
+    {
+        page->get_page_buffer().read_from_lpa_async(dev, lpa, async_read_callback, ctx.get());
+    }
+    catch (const std::exception &e)
+    {
+        /* 提交失败，回调不会被调用，在此处恢复状态 */
+        std::lock_guard<std::mutex> lg(async_read_mtx);
+        page->set_state(page_state::invalid);
+        --inflight_read_num;
+        throw;
+    }
+
+    /* 提交成功后，ctx由回调释放(回调可能已经在提交时被调用，此处不能再访问ctx) */
+    ctx.release();
+}
+
+void page_cache::wait_page_read_cplt(page_entry_handle &page)
+{
+    std::unique_lock<std::mutex> lg(async_read_mtx);
+    async_read_cond.wait(lg, [&page]() { return page->get_state() != page_state::reading; });
+}
+
+void page_cache::async_read_callback(comm_cmd_result res, void *arg)
+{
+    async_read_ctx *ctx = static_cast<async_read_ctx*>(arg);
+    page_cache *cache = ctx->cache;
+    if (res != COMM_CMD_SUCCESS)
+        HSCFS_LOG(HSCFS_LOG_WARNING, "async read of page(blkoff = %u) failed.", ctx->page->get_blkoff());
+
+    {
+        std::lock_guard<std::mutex> lg(cache->async_read_mtx);
+        ctx->page->set_state(res == COMM_CMD_SUCCESS ? page_state::ready : page_state::invalid);
+        ctx->page = page_entry_handle();  // 释放对page的引用
+        --cache->inflight_read_num;
+        cache->async_read_cond.notify_all();
+    }
+
+    /* 解锁后不能再访问cache，等待的线程可能已经析构了page cache */
+    delete ctx;
+}
+
+void page_cache::wait_all_async_read()
+{
+    std::unique_lock<std::mutex> lg(async_read_mtx);
+    async_read_cond.wait(lg, [this]() { return inflight_read_num == 0; });
+}
+
+void page_cache::update_lpa(uint32_t blkoff, uint32_t old_lpa, uint32_t new_lpa)
+{
+    spin_lock_guard lg(pool->pool_lock);
+    page_entry *p_entry = index.get(blkoff);
+    if (p_entry != nullptr && p_entry->lpa == old_lpa)
+        p_entry->lpa = new_lpa;
+}
+
+size_t page_cache::get_page_num()
+{
+    spin_lock_guard lg(pool->pool_lock);
+    return cur_size;
+}
+
+size_t page_cache::get_dirty_page_num()
+{
+    spin_lock_guard lg(dirty_pages_lock);
+    return dirty_pages.size();
+}
+
+/* 调用者需要加pool_lock，除非能够保证调用时ref_count不会为0 */
 void page_cache::add_refcount(page_entry *entry)
 {
     auto origin = entry->ref_count.fetch_add(1);
@@ -114,15 +271,15 @@ void page_cache::add_refcount(page_entry *entry)
     {   
         /* 
          * 先前引用计数为0，不可能是dirty状态 
-         * 此时ref_count由0增至1，且加了cache_lock，assert访问entry是安全的(此时只可能在此处访问)
+         * 此时ref_count由0增至1，且加了pool_lock，assert访问entry是安全的(此时只可能在此处访问)
          */
         assert(entry->is_dirty.load() == false);
 
         /*
          * 可能出现ref_count减到0，但减少ref_count的线程还没来得及unpin的情况(见sub_refcount)
-         * 由于generic_cache_manager使用的lru_replacer允许重复调用pin，所以不会造成影响
+         * 由于置换器允许重复调用pin，所以不会造成影响
          */
-        cache_manager.pin(entry->blkoff);
+        pool->replacer.pin(get_key(entry->blkoff));
     }
 }
 
@@ -135,43 +292,37 @@ void page_cache::sub_refcount(page_entry *entry)
     if (origin == 1)
     {
         /*
-         * 加cache_lock，再次检查引用计数
+         * 加pool_lock，再次检查引用计数
          * 成功获取锁后，如果ref_count仍为0，则不可能有其它线程能够修改ref_count，
-         * 因为ref_count从0增加到1，一定是通过调用page_cache.get方法，而该方法在加ref_count前需要加cache_lock
+         * 因为ref_count从0增加到1，一定是通过调用page_cache.get方法，而该方法在加ref_count前需要加pool_lock
          * 此时将其unpin，然后解锁
          */
-        spin_lock_guard lg(cache_lock);
+        std::unique_ptr<page_entry> removed;  // 在解锁后析构
+        spin_lock_guard lg(pool->pool_lock);
         if (entry->ref_count.load() == 0)
         {
             /* 
              * 若引用计数减为0，不可能是dirty状态
-             * 此时ref_count由1减至0，且加了cache_lock，访问entry是安全的
+             * 此时ref_count由1减至0，且加了pool_lock，访问entry是安全的
              */
             assert(entry->is_dirty.load() == false);
-            cache_manager.unpin(entry->blkoff);
-        }
 
-        /* 如果ref_count此时不为0，说明加锁前有其它线程再次通过get获取引用计数，所以放弃unpin */
-    }
-}
-
-/* 调用者需要获取cache_lock */
-void page_cache::do_replace()
-{
-    if (cur_size > expect_size)
-    {
-        while (true)
-        {
-            auto p = cache_manager.replace_one();
-            if (p != nullptr)
+            /* 
+             * 零页不持有内存，再次访问时重新查询映射即可，直接移除，不占用缓存项
+             * 这样扫描稀疏文件时，空洞page让出的缓存项会被下一个空洞page复用，不会持续置换其它有效page
+             */
+            if (entry->zero)
             {
-                assert(p->ref_count == 0 && p->is_dirty.load() == false);
+                pool->replacer.remove(get_key(entry->blkoff));
+                removed = index.remove(entry->blkoff);
+                --pool->cur_pages;
                 --cur_size;
-                HSCFS_LOG(HSCFS_LOG_INFO, "replace page cache entry, blkoff = %u", p->blkoff);
             }
-            if (p == nullptr || cur_size <= expect_size)
-                break;
+            else
+                pool->replacer.unpin(get_key(entry->blkoff));
         }
+
+        /* 如果ref_count此时不为0，说明加锁前有其它线程再次通过get获取引用计数，所以放弃unpin */
     }
 }
 
@@ -248,10 +399,16 @@ void page_entry_handle::do_subref()
         cache->sub_refcount(entry);
 }
 
+const char page_entry::zero_block[4096] = {};
+
+/* 块缓存区在读入或写入page时才分配 */
 page_entry::page_entry(uint32_t blkoff)
+    : page(nullptr)
 {
+    zero = false;
     this->blkoff = blkoff;
     lpa = INVALID_LPA;
+    lpa_unresolved = false;
     content_state = page_state::invalid;
     ref_count.store(0);
     is_dirty.store(false);    
@@ -1,5 +1,7 @@
 #include <stdlib.h>
+#include <string.h>
 #include <error.h>
+#include <sys/uio.h>
 
 #include "communication/channel.h"
 #include "communication/dev.h"
@@ -263,6 +265,138 @@ int comm_channel_send_write_cmd(comm_channel_handle handle, void *buffer, uint64
     return ret;
 }
 
+// 信道层使用的SPDK向量命令的回调参数
+// 除上层回调外，保存iov数组的拷贝和SGL遍历位置，供SPDK构造PRP/SGL时调用reset_sgl和next_sge
+typedef struct channel_sgl_cmd_cb_ctx
+{
+    channel_cmd_cb_ctx cb_ctx;  // 必须为第一个成员，命令完成时由channel_inner_spdk_cmd_callback整体释放
+    int iovcnt;
+    int cur_iov;  // 下一个SGE所在的iov下标
+    uint32_t cur_off;  // 下一个SGE在iov[cur_iov]中的偏移
+    struct iovec iov[];
+} channel_sgl_cmd_cb_ctx;
+
+static channel_sgl_cmd_cb_ctx *new_channel_sgl_cmd_cb_ctx(const struct iovec *iov, int iovcnt,
+    channel_cmd_cb_func cb_func, void *cb_arg)
+{
+    channel_sgl_cmd_cb_ctx *sgl_ctx = (channel_sgl_cmd_cb_ctx *)malloc(sizeof(channel_sgl_cmd_cb_ctx) + 
+        sizeof(struct iovec) * iovcnt);
+    if (sgl_ctx == NULL)
+    {
+        HSCFS_LOG(HSCFS_LOG_ERROR, "alloc channel sgl cmd callback ctx failed.");
+        return NULL;
+    }
+    sgl_ctx->cb_ctx.caller_cb_func = cb_func;
+    sgl_ctx->cb_ctx.caller_cb_arg = cb_arg;
+    sgl_ctx->iovcnt = iovcnt;
+    sgl_ctx->cur_iov = 0;
+    sgl_ctx->cur_off = 0;
+    memcpy(sgl_ctx->iov, iov, sizeof(struct iovec) * iovcnt);
+    return sgl_ctx;
+}
+
+// SPDK回调：将SGL遍历位置设置到整个payload的offset字节处
+static void channel_sgl_reset_cb(void *cb_arg, uint32_t offset)
+{
+    channel_sgl_cmd_cb_ctx *sgl_ctx = (channel_sgl_cmd_cb_ctx *)cb_arg;
+    int i = 0;
+    while (i < sgl_ctx->iovcnt && offset >= sgl_ctx->iov[i].iov_len)
+    {
+        offset -= sgl_ctx->iov[i].iov_len;
+        ++i;
+    }
+    sgl_ctx->cur_iov = i;
+    sgl_ctx->cur_off = offset;
+}
+
+// SPDK回调：返回下一个SGE的地址和长度
+static int channel_sgl_next_sge_cb(void *cb_arg, void **address, uint32_t *length)
+{
+    channel_sgl_cmd_cb_ctx *sgl_ctx = (channel_sgl_cmd_cb_ctx *)cb_arg;
+    if (sgl_ctx->cur_iov >= sgl_ctx->iovcnt)
+    {
+        *address = NULL;
+        *length = 0;
+        return -EINVAL;
+    }
+    struct iovec *cur = &sgl_ctx->iov[sgl_ctx->cur_iov];
+    *address = (char *)cur->iov_base + sgl_ctx->cur_off;
+    *length = (uint32_t)(cur->iov_len - sgl_ctx->cur_off);
+    ++sgl_ctx->cur_iov;
+    sgl_ctx->cur_off = 0;
+    return 0;
+}
+
+int comm_channel_send_readv_cmd_no_lock(comm_channel_handle handle, const struct iovec *iov, int iovcnt, 
+    uint64_t lba, uint32_t lba_count, channel_cmd_cb_func cb_func, void *cb_arg)
+{
+    channel_sgl_cmd_cb_ctx *sgl_ctx = new_channel_sgl_cmd_cb_ctx(iov, iovcnt, cb_func, cb_arg);
+    if (sgl_ctx == NULL)
+        return ENOMEM;
+
+    int ret = 0;
+    ret = spdk_nvme_ns_cmd_readv(handle->dev->ns, handle->qpair, lba, lba_count, 
+        channel_inner_spdk_cmd_callback, sgl_ctx, 0, channel_sgl_reset_cb, channel_sgl_next_sge_cb);
+    if (ret != 0)
+    {
+        ret = -ret;
+        HSCFS_ERRNO_LOG(HSCFS_LOG_ERROR, ret, "spdk send readv cmd failed.");
+        free(sgl_ctx);
+    }
+
+    return ret;
+}
+
+int comm_channel_send_readv_cmd(comm_channel_handle handle, const struct iovec *iov, int iovcnt, 
+    uint64_t lba, uint32_t lba_count, channel_cmd_cb_func cb_func, void *cb_arg)
+{
+    int ret = 0;
+    ret = comm_channel_lock(handle);
+    if (ret != 0)
+    {
+        HSCFS_LOG(HSCFS_LOG_ERROR, "send readv cmd: lock channel failed.");
+        return ret;
+    }
+    ret = comm_channel_send_readv_cmd_no_lock(handle, iov, iovcnt, lba, lba_count, cb_func, cb_arg);
+    comm_channel_unlock(handle);
+    return ret;
+}
+
+int comm_channel_send_writev_cmd_no_lock(comm_channel_handle handle, const struct iovec *iov, int iovcnt, 
+    uint64_t lba, uint32_t lba_count, channel_cmd_cb_func cb_func, void *cb_arg)
+{
+    channel_sgl_cmd_cb_ctx *sgl_ctx = new_channel_sgl_cmd_cb_ctx(iov, iovcnt, cb_func, cb_arg);
+    if (sgl_ctx == NULL)
+        return ENOMEM;
+
+    int ret = 0;
+    ret = spdk_nvme_ns_cmd_writev(handle->dev->ns, handle->qpair, lba, lba_count, 
+        channel_inner_spdk_cmd_callback, sgl_ctx, 0, channel_sgl_reset_cb, channel_sgl_next_sge_cb);
+    if (ret != 0)
+    {
+        ret = -ret;
+        HSCFS_ERRNO_LOG(HSCFS_LOG_ERROR, ret, "spdk send writev cmd failed.");
+        free(sgl_ctx);
+    }
+
+    return ret;
+}
+
+int comm_channel_send_writev_cmd(comm_channel_handle handle, const struct iovec *iov, int iovcnt, 
+    uint64_t lba, uint32_t lba_count, channel_cmd_cb_func cb_func, void *cb_arg)
+{
+    int ret = 0;
+    ret = comm_channel_lock(handle);
+    if (ret != 0)
+    {
+        HSCFS_LOG(HSCFS_LOG_ERROR, "send writev cmd: lock channel failed.");
+        return ret;
+    }
+    ret = comm_channel_send_writev_cmd_no_lock(handle, iov, iovcnt, lba, lba_count, cb_func, cb_arg);
+    comm_channel_unlock(handle);
+    return ret;
+}
+
 static void build_nvme_cmd(struct spdk_nvme_cmd *nvme_cmd, comm_raw_cmd *raw_cmd, comm_dev *dev)
 {
     nvme_cmd->opc = raw_cmd->opcode;
@@ -124,6 +124,122 @@ int comm_submit_sync_rw_request(comm_dev *dev, void *buffer, uint64_t lba, uint3
     return ret;
 }
 
+int comm_submit_async_rwv_request(comm_dev *dev, const struct iovec *iov, int iovcnt, uint64_t lba, uint32_t lba_count,
+    comm_async_cb_func cb_func, void *cb_arg, comm_io_direction dir)
+{
+    int ret = 0;
+    comm_channel_handle channel = comm_channel_controller_get_channel(&dev->channel_ctrlr);
+    comm_session_cmd_ctx *session_ctx = (comm_session_cmd_ctx *)malloc(sizeof(comm_session_cmd_ctx));
+    if (session_ctx == NULL)
+    {
+        HSCFS_LOG(HSCFS_LOG_ERROR, "async rwv: alloc session ctx failed.");
+        ret = ENOMEM;
+        goto err1;
+    }
+    comm_session_async_cmd_ctx_constructor(session_ctx, channel, SESSION_IO_CMD, 
+        cb_func, cb_arg, 1);
+
+    if (dir == COMM_IO_READ)
+    {
+        ret = comm_channel_send_readv_cmd(channel, iov, iovcnt, lba, lba_count, 
+            comm_session_polling_thread_callback, session_ctx);
+    }
+    else
+    {
+        ret = comm_channel_send_writev_cmd(channel, iov, iovcnt, lba, lba_count, 
+            comm_session_polling_thread_callback, session_ctx); 
+    }
+
+    if (ret != 0)
+    {
+        HSCFS_ERRNO_LOG(HSCFS_LOG_ERROR, ret, "async rwv: send cmd failed.");
+        goto err2;
+    }
+
+    ret = comm_session_submit_cmd_ctx(session_ctx);
+    if (ret != 0)
+    {
+        HSCFS_ERRNO_LOG(HSCFS_LOG_ERROR, ret, "async rwv: submit ctx to session failed.");
+        goto err2;
+    }
+
+    return 0;
+
+    err2:
+    comm_session_cmd_ctx_destructor(session_ctx);
+    free(session_ctx);
+    err1:
+    comm_channel_release(channel);
+    return ret;
+}
+
+int comm_submit_sync_rwv_request(comm_dev *dev, const struct iovec *iov, int iovcnt, uint64_t lba, uint32_t lba_count, 
+    comm_io_direction dir)
+{
+    int ret = 0;
+    comm_channel_handle channel = comm_channel_controller_get_channel(&dev->channel_ctrlr);
+    comm_session_cmd_ctx session_ctx;
+    ret = comm_session_sync_cmd_ctx_constructor(&session_ctx, channel, SESSION_IO_CMD);
+    if (ret != 0)
+    {
+        HSCFS_ERRNO_LOG(HSCFS_LOG_ERROR, ret, "sync rwv: construct session ctx failed.");
+        goto err0;
+    }
+
+    if (dir == COMM_IO_READ)
+    {
+        ret = comm_channel_send_readv_cmd(channel, iov, iovcnt, lba, lba_count, 
+            comm_session_polling_thread_callback, &session_ctx);
+    }
+    else
+    {
+        ret = comm_channel_send_writev_cmd(channel, iov, iovcnt, lba, lba_count, 
+            comm_session_polling_thread_callback, &session_ctx);
+    }
+    if (ret != 0)
+    {
+        HSCFS_ERRNO_LOG(HSCFS_LOG_ERROR, ret, "sync rwv: send cmd failed.");
+        goto err1;
+    }
+
+    ret = comm_session_submit_cmd_ctx(&session_ctx);
+    if (ret != 0)
+    {
+        HSCFS_ERRNO_LOG(HSCFS_LOG_ERROR, ret, "sync rwv: submit ctx to session failed.");
+        goto err1;
+    }
+
+    ret = mutex_lock(&session_ctx.wait_mtx);
+    if (ret != 0)
+    {
+        HSCFS_ERRNO_LOG(HSCFS_LOG_ERROR, ret, "sync rwv: lock session ctx failed.");
+        goto err1;
+    }
+    while (!session_ctx.cmd_is_cplt)
+    {
+        ret = cond_wait(&session_ctx.wait_cond, &session_ctx.wait_mtx);
+        if (ret != 0)
+        {
+            HSCFS_ERRNO_LOG(HSCFS_LOG_ERROR, ret, "sync rwv: wait session failed.");
+            goto err2;
+        }
+    }
+
+    if (session_ctx.cmd_result != COMM_CMD_SUCCESS)
+    {
+        HSCFS_LOG(HSCFS_LOG_ERROR, "sync rwv: cmd execute failed.");
+        ret = -1;
+    }
+
+    err2:
+    mutex_unlock(&session_ctx.wait_mtx);
+    err1:
+    comm_session_cmd_ctx_destructor(&session_ctx);
+    err0:
+    comm_channel_release(channel);
+    return ret;
+}
+
 int comm_raw_sync_cmd_sender(comm_dev *dev, void *buf, uint32_t buf_len, comm_raw_cmd *raw_cmd,
     uint8_t is_long_cmd, void *tid_res_buf, uint32_t tid_res_len)
 {
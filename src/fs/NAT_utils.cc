@@ -45,7 +45,7 @@ void nat_lpa_mapping::set_lpa_of_nid(uint32_t nid, uint32_t new_lpa)
     uint32_t nat_lpa, idx;
     std::tie(nat_lpa, idx) = get_nid_pos_in_nat(nid);
     SIT_NAT_cache_entry_handle nat_handle = fs_manager->get_nat_cache()->get(nat_lpa);
-    hscfs_nat_entry nat_entry = nat_handle.get_nat_block_ptr()->entries[idx];
+    hscfs_nat_entry &nat_entry = nat_handle.get_nat_block_ptr()->entries[idx];
     nat_entry.block_addr = new_lpa;
     HSCFS_LOG(HSCFS_LOG_DEBUG, "set nid(%u)'s lpa to %u.", nid, new_lpa);
 
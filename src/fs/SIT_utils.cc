@@ -1,11 +1,15 @@
 #include "fs/fs.h"
 #include "fs/SIT_utils.hh"
 #include "fs/fs_manager.hh"
+#include "fs/super_manager.hh"
 #include "cache/super_cache.hh"
 #include "cache/SIT_NAT_cache.hh"
 #include "journal/journal_container.hh"
 #include "utils/hscfs_log.h"
 
+#include <tuple>
+#include <algorithm>
+
 namespace hscfs {
 
 SIT_operator::SIT_operator(file_system_manager *fs_manager)
@@ -37,6 +41,49 @@ uint32_t SIT_operator::get_first_lpa_of_segid(uint32_t segid)
     return seg0_start_lpa + segid * BLOCK_PER_SEGMENT;
 }
 
+hscfs_sit_entry SIT_operator::get_sit_entry(uint32_t segid)
+{
+    uint32_t sit_lpa, sit_off;
+    std::tie(sit_lpa, sit_off) = get_segid_pos_in_sit(segid);
+    SIT_NAT_cache_entry_handle sit_handle = fs_manager->get_sit_cache()->get(sit_lpa);
+    return sit_handle.get_sit_block_ptr()->entries[sit_off];
+}
+
+uint32_t SIT_operator::count_valid_blocks(const hscfs_sit_entry &entry)
+{
+    uint32_t cnt = 0;
+    for (uint32_t i = 0; i < SIT_VBLOCK_MAP_SIZE; ++i)
+        cnt += __builtin_popcount(entry.valid_map[i]);
+    return cnt;
+}
+
+void SIT_operator::validate_lpa_range(uint32_t start_lpa, uint32_t num)
+{
+    assert(num > 0);
+    uint32_t segid, segoff;
+    std::tie(segid, segoff) = get_seg_pos_of_lpa(start_lpa);
+    assert(segoff + num <= BLOCK_PER_SEGMENT);
+    uint32_t sit_lpa = sit_start_lpa + segid / SIT_ENTRY_PER_BLOCK;
+
+    SIT_NAT_cache_entry_handle sit_block_handle = fs_manager->get_sit_cache()->get(sit_lpa);
+    hscfs_sit_entry &sit_entry = sit_block_handle.get_sit_block_ptr()->entries[segid % SIT_ENTRY_PER_BLOCK];
+    for (uint32_t off = segoff; off < segoff + num; ++off)
+    {
+        assert(!(sit_entry.valid_map[off / 8] & (1U << (off % 8))));
+        sit_entry.valid_map[off / 8] |= 1U << (off % 8);
+    }
+
+    /* 有效块计数最多为511，见change_lpa_state */
+    uint32_t vblocks = std::min<uint32_t>(GET_SIT_VBLOCKS(&sit_entry) + num, SIT_VBLOCKS_MASK);
+    sit_entry.vblocks = (sit_entry.vblocks & ~SIT_VBLOCKS_MASK) | vblocks;
+    HSCFS_LOG(HSCFS_LOG_INFO, "validate lpa [%u, %u) in SIT.", start_lpa, start_lpa + num);
+
+    journal_container *cur_journal = fs_manager->get_cur_journal();
+    SIT_journal_entry journal_entry = {.segID = segid, .newValue = sit_entry};
+    cur_journal->append_SIT_journal_entry(journal_entry);
+    sit_block_handle.add_host_version();
+}
+
 void SIT_operator::change_lpa_state(uint32_t lpa, bool valid)
 {
     if (lpa == INVALID_LPA)
@@ -79,6 +126,10 @@ void SIT_operator::change_lpa_state(uint32_t lpa, bool valid)
             sit_entry.vblocks--;
 
         HSCFS_LOG(HSCFS_LOG_INFO, "invalidate lpa [%u] in SIT.", lpa);
+
+        /* 计数字段可能比实际少1，计数不大于1时由位图确认segment是否已无有效块，交给回收 */
+        if (GET_SIT_VBLOCKS(&sit_entry) <= 1 && count_valid_blocks(sit_entry) == 0)
+            fs_manager->get_super_manager()->note_empty_segment(segid);
     }
 
     /* 写下SIT日志条目，增加sit缓存块主机侧版本 */
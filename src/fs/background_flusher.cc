@@ -0,0 +1,165 @@
+#include "fs/background_flusher.hh"
+#include "fs/fs_manager.hh"
+#include "fs/file.hh"
+#include "fs/server_thread.hh"
+#include "fs/write_back_helper.hh"
+#include "cache/node_block_cache.hh"
+#include "journal/journal_container.hh"
+#include "utils/exception_handler.hh"
+#include "utils/hscfs_log.h"
+
+#include <vector>
+#include <unordered_set>
+
+namespace hscfs {
+
+background_flusher::background_flusher(file_system_manager *fs_manager, server_thread *server,
+    const flush_policy &policy)
+{
+    this->fs_manager = fs_manager;
+    this->server = server;
+    this->policy = policy;
+    meta_dirty = false;
+    task_id = server->add_periodic_task([this]() { run(); }, policy.period);
+}
+
+void background_flusher::set_policy(const flush_policy &policy)
+{
+    {
+        std::lock_guard<std::mutex> lg(mtx);
+        this->policy = policy;
+    }
+    server->set_periodic_task_period(task_id, policy.period);
+}
+
+flush_policy background_flusher::get_policy()
+{
+    std::lock_guard<std::mutex> lg(mtx);
+    return policy;
+}
+
+flush_stat background_flusher::get_stat()
+{
+    std::lock_guard<std::mutex> lg(mtx);
+    return stat;
+}
+
+void background_flusher::run()
+{
+    flush_policy p = get_policy();
+
+    /* fini等操作持有fs_freeze_lock独占时跳过本轮，fini会停止服务线程，此处不能阻塞 */
+    rwlock_t &fs_freeze_lock = fs_manager->get_fs_freeze_lock();
+    if (rwlock_tryrdlock(&fs_freeze_lock) != 0)
+        return;
+
+    /*
+     * 选择文件、回写每个文件的数据、回写元数据时分别持有fs_meta_lock，其间前台操作可以获得锁
+     * 不在释放fs_meta_lock期间持有file_handle，否则close、unlink无法删除文件，只记录inode号，回写前重新获取
+     */
+    try
+    {
+        auto now = std::chrono::steady_clock::now();
+        std::vector<uint32_t> candidates;
+        {
+            std::lock_guard<std::mutex> fs_meta_lg(fs_manager->get_fs_meta_lock());
+            fs_manager->check_state();
+            candidates = select_files(p, now);
+        }
+
+        std::unordered_set<uint32_t> inos;
+        for (uint32_t ino : candidates)
+        {
+            std::lock_guard<std::mutex> fs_meta_lg(fs_manager->get_fs_meta_lock());
+            fs_manager->check_state();
+            if (flush_file(ino))
+                inos.insert(ino);
+        }
+
+        std::lock_guard<std::mutex> fs_meta_lg(fs_manager->get_fs_meta_lock());
+        fs_manager->check_state();
+        flush_meta(p, now, inos);
+    }
+    catch (const std::exception &e)
+    {
+        HSCFS_LOG(HSCFS_LOG_WARNING, "background flush failed.");
+        exception_handler(fs_manager, e).convert_to_errno(true);
+    }
+    rwlock_unlock(&fs_freeze_lock);
+}
+
+std::vector<uint32_t> background_flusher::select_files(const flush_policy &p, 
+    std::chrono::steady_clock::time_point now)
+{
+    std::vector<file_handle> files = fs_manager->get_file_obj_cache()->get_dirty_files_to_flush(
+        now - p.dirty_expire, p.dirty_pages_limit);
+    std::vector<uint32_t> ret;
+    ret.reserve(files.size());
+    for (auto &handle : files)
+        ret.push_back(handle->get_inode());
+    return ret;
+}
+
+bool background_flusher::flush_file(uint32_t ino)
+{
+    /* 选出后，文件可能已被fsync回写，或已被删除 */
+    file_handle handle = fs_manager->get_file_obj_cache()->get(ino);
+    if (handle.is_empty() || !handle->need_write_back())
+        return false;
+
+    /* 跳过前台正在操作的文件 */
+    rwlock_t &file_op_lock = handle->get_file_op_lock();
+    if (rwlock_trywrlock(&file_op_lock) != 0)
+        return false;
+    try
+    {
+        handle.write_back(write_back_source::background);
+    }
+    catch (...)
+    {
+        rwlock_unlock(&file_op_lock);
+        throw;
+    }
+    rwlock_unlock(&file_op_lock);
+    return true;
+}
+
+void background_flusher::flush_meta(const flush_policy &p, std::chrono::steady_clock::time_point now,
+    const std::unordered_set<uint32_t> &inos)
+{
+    /* 脏元数据超时，或dirty node过多时，回写所有脏元数据；否则只回写刚刚回写了数据的文件的元数据 */
+    node_block_cache *node_cache = fs_manager->get_node_cache();
+    journal_container *journal = fs_manager->get_cur_journal();
+    bool is_meta_dirty = node_cache->get_dirty_num() != 0 || !journal->is_empty() ||
+        !journal->get_dependent_inos().empty();
+    if (!is_meta_dirty)
+        meta_dirty = false;
+    else if (!meta_dirty)
+    {
+        meta_dirty = true;
+        meta_dirty_since = now;
+    }
+
+    bool flush_all = meta_dirty && (now - meta_dirty_since >= p.dirty_expire ||
+        node_cache->get_dirty_num() > p.dirty_nodes_limit);
+    write_back_helper wb_helper(fs_manager);
+    if (flush_all)
+    {
+        HSCFS_LOG(HSCFS_LOG_INFO, "background flush: write back %zu file(s) and all dirty metadata.", inos.size());
+        wb_helper.write_meta_back_sync();
+        meta_dirty = false;
+    }
+    else if (!inos.empty())
+    {
+        HSCFS_LOG(HSCFS_LOG_INFO, "background flush: write back %zu file(s).", inos.size());
+        wb_helper.write_files_meta_back_sync(inos);
+    }
+
+    std::lock_guard<std::mutex> lg(mtx);
+    ++stat.run_num;
+    stat.file_num += inos.size();
+    if (flush_all || !inos.empty())
+        ++stat.tx_num;
+}
+
+}  // namespace hscfs
@@ -5,6 +5,7 @@
 #include "fs/fs_manager.hh"
 #include "fs/fs.h"
 #include "fs/file_utils.hh"
+#include "journal/journal_container.hh"
 #include "utils/hscfs_log.h"
 #include "utils/hscfs_exceptions.hh"
 
@@ -103,9 +104,39 @@ dentry_info directory::lookup(const std::string &name)
     return target_info;
 }
 
+uint32_t directory::estimate_lookup_reads(const std::string &name)
+{
+    /* inode不在缓存中时，不知道哈希表的级数，估计为inode和一个目录块 */
+    node_block_cache_entry_handle inode_handle = fs_manager->get_node_cache()->get(ino);
+    if (inode_handle.is_empty())
+        return 2;
+    hscfs_inode *inode = &inode_handle->get_node_block_ptr()->i;
+    dir_data_block_cache *dir_data_cache = fs_manager->get_dir_data_cache();
+    u32 name_hash = hscfs_dentry_hash(name.c_str(), name.length());
+
+    uint32_t reads = 0;
+    for (uint32_t level = 0; level <= inode->i_current_depth; ++level)
+    {
+        uint32_t bucket_idx_of_name = name_hash % bucket_num(level, inode->i_dir_level);
+        uint32_t start_blkno = bucket_start_block_index(level, inode->i_dir_level, bucket_idx_of_name);
+        uint32_t end_blkno = start_blkno + bucket_block_num(level);
+        for (uint32_t blkno = start_blkno; blkno < end_blkno; ++blkno)
+        {
+            if (dir_data_cache->contains(ino, blkno))
+                continue;
+
+            /* 由inode直接索引的空洞不需要读取，其它块不查找索引，都计为需要读取 */
+            if (blkno < DEF_ADDRS_PER_INODE && inode->i_addr[blkno] == INVALID_LPA)
+                continue;
+            ++reads;
+        }
+    }
+    return reads;
+}
+
 block_buffer directory::create_formatted_data_block_buffer()
 {
-    /* block buffer使用spdk_zmalloc分配内存，该内存已经被初始化为0，不需要再格式化 */
+    /* block buffer默认构造时已清零，全0即为格式化后的目录块，不需要再格式化 */
     return block_buffer();
 }
 
@@ -219,6 +250,11 @@ void directory::remove(dentry_handle &dentry)
     inode_time_util::set_atime(inode);
     inode_time_util::set_mtime(inode);
     inode_handle.mark_dirty();
+
+    /* 目录和被删除的文件的元数据必须在同一事务中提交 */
+    journal_container *cur_journal = fs_manager->get_cur_journal();
+    cur_journal->add_dependent_ino(ino);
+    cur_journal->add_dependent_ino(dentry->get_ino());
 }
 
 uint32_t directory::bucket_num(u32 level, int dir_level)
@@ -512,6 +548,11 @@ dentry_handle directory::create_dentry(const std::string &name, uint8_t type, ui
     inode_time_util::set_mtime(inode);
     inode_handle.mark_dirty();
 
+    /* 目录和新目录项指向的文件的元数据必须在同一事务中提交 */
+    journal_container *cur_journal = fs_manager->get_cur_journal();
+    cur_journal->add_dependent_ino(ino);
+    cur_journal->add_dependent_ino(new_inode);
+
     return d_handle;
 }
 
@@ -1,5 +1,7 @@
 #include <system_error>
 #include <cstring>
+#include <vector>
+#include <algorithm>
 
 #include "cache/page_cache.hh"
 #include "cache/node_block_cache.hh"
@@ -8,6 +10,7 @@
 #include "fs/file_utils.hh"
 #include "fs/write_back_helper.hh"
 #include "fs/srmap_utils.hh"
+#include "journal/journal_container.hh"
 #include "utils/hscfs_exceptions.hh"
 #include "utils/exception_handler.hh"
 #include "utils/hscfs_log.h"
@@ -16,6 +19,14 @@
 
 namespace hscfs {
 
+/* 成员顺序保证析构时先解锁，再释放page引用 */
+struct file::page_to_read
+{
+    page_entry_handle page;
+    std::unique_lock<std::mutex> page_lock;
+    uint32_t lpa;
+};
+
 file::file(uint32_t ino, file_system_manager *fs_manager)
 {
     this->ino = ino;
@@ -31,7 +42,7 @@ file::file(uint32_t ino, file_system_manager *fs_manager)
         throw std::system_error(std::error_code(ret, std::generic_category()), 
             "file object: init file op lock failed.");
     }
-    page_cache_.reset(new page_cache(fs_manager->get_page_cache_size()));
+    page_cache_.reset(new page_cache(fs_manager->get_page_pool()));
     ref_count = 0;
     fd_ref_count = 0;
     is_dirty = false;
@@ -60,7 +71,10 @@ bool file::truncate(size_t tar_size)
     if (i_size < tar_size)
         resizer.expand(ino, tar_size);
     else if (i_size > tar_size)
+    {
         resizer.reduce(ino, tar_size);
+        extents.remove(SIZE_TO_BLOCK(tar_size), UINT32_MAX);
+    }
     else
         return false;
 
@@ -69,17 +83,29 @@ bool file::truncate(size_t tar_size)
     mark_modified();
 
     /* 将page cache内多余的page置为INVALID状态 */
-    page_cache_->truncate(SIZE_TO_BLOCK(tar_size) - 1);
+    page_cache_->truncate(SIZE_TO_BLOCK(tar_size));
 
     return true;
 }
 
-ssize_t file::read(char *buffer, ssize_t count, uint64_t pos)
+ssize_t file::read(char *buffer, ssize_t count, uint64_t pos, uint32_t *miss_num)
 {
     const uint64_t cur_size = get_cur_size();  // 获取一致的page cache中文件大小
     const uint64_t read_end_pos = std::min(cur_size, pos + count);
     ssize_t read_count = 0;  // 当前已经读取的字节数
 
+    /* 
+     * 读范围跨越多个page时，先对其中所有内容无效的page批量并发地从SSD读取
+     * batch_pages保持这些page的引用直到拷贝完成，防止它们在拷贝前被置换
+     */
+    std::vector<page_entry_handle> batch_pages;
+    if (pos < read_end_pos && idx_of_blk(pos) < idx_of_blk(read_end_pos - 1))
+    {
+        uint32_t batch_num = batch_read_pages(idx_of_blk(pos), idx_of_blk(read_end_pos - 1) + 1, batch_pages);
+        if (miss_num != nullptr)
+            *miss_num += batch_num;
+    }
+
     {
         page_entry_handle pre_page;  // 必须保持上一个page的引用，确保解锁上一个page时pre_page_lock不是悬垂引用
         std::unique_lock<std::mutex> pre_page_lock;  // 前一个page的锁。获取到当前page的锁后再释放(必须定义在pre_page后)
@@ -96,13 +122,14 @@ ssize_t file::read(char *buffer, ssize_t count, uint64_t pos)
             page_entry_handle cur_page = page_cache_->get(cur_blkno);
             std::unique_lock<std::mutex> cur_page_lock(cur_page->get_page_lock());
             pre_page_lock = std::move(cur_page_lock);  // 解锁pre_page_lock，并接管cur_page_lock
-            prepare_page_content(cur_page);
+            if (prepare_page_content(cur_page) && miss_num != nullptr)
+                ++*miss_num;
 
             /* 从page中拷贝内容到用户缓冲区 */
             const size_t cp_start_off = off_in_blk(pos);
             const size_t cp_cnt = end_pos - pos;
-            char *page_buffer = cur_page->get_page_buffer().get_ptr();
-            std::memcpy(buffer + read_count, page_buffer + cp_start_off, cp_cnt);
+            const char *page_content = cur_page->get_content_ptr();
+            std::memcpy(buffer + read_count, page_content + cp_start_off, cp_cnt);
 
             read_count += cp_cnt;
             pos += cp_cnt;
@@ -135,17 +162,29 @@ ssize_t file::write(char *buffer, ssize_t count, uint64_t pos)
             assert(end_pos > pos && end_pos - pos <= 4096);
             HSCFS_LOG(HSCFS_LOG_DEBUG, "write in file(inode = %u), blkno %u, range [%u, %u).", ino, cur_blkno, pos, end_pos);
 
-            /* 从缓存中获取当前page，加锁，解除上一个page的锁，准备好当前page的内容(如从SSD读) */
+            /* 从缓存中获取当前page，加锁，解除上一个page的锁 */
             page_entry_handle cur_page = page_cache_->get(cur_blkno);
             std::unique_lock<std::mutex> cur_page_lock(cur_page->get_page_lock());
             pre_page_lock = std::move(cur_page_lock);  // 解锁pre_page_lock，并接管cur_page_lock
-            prepare_page_content(cur_page);
 
-            /* 从用户缓冲区拷贝内容到page中 */
+            /* 
+             * 准备好当前page的内容(如从SSD读)
+             * 覆盖整个page时，旧内容不会被用到，不需要从SSD读，也不需要查询file mapping，旧lpa留到回写时再确定
+             */
             const size_t cp_start_off = off_in_blk(pos);
             const size_t cp_cnt = end_pos - pos;
+            const bool full_overwrite = cp_cnt == 4096 && cur_page->get_state() == page_state::invalid;
+            if (!full_overwrite)
+                prepare_page_content(cur_page);
+
+            /* 从用户缓冲区拷贝内容到page中 */
             char *page_buffer = cur_page->get_page_buffer().get_ptr();
             std::memcpy(page_buffer + cp_start_off, buffer + write_count, cp_cnt);
+            if (full_overwrite)
+            {
+                cur_page->set_lpa_unresolved();
+                cur_page->set_state(page_state::ready);
+            }
             cur_page.mark_dirty();
 
             write_count += cp_cnt;
@@ -161,7 +200,103 @@ ssize_t file::write(char *buffer, ssize_t count, uint64_t pos)
     return write_count;
 }
 
-void file::write_back()
+void file::readahead(uint32_t start_blkno, uint32_t num)
+{
+    const uint64_t end_blkno = std::min(uint64_t(start_blkno) + num, SIZE_TO_BLOCK(get_cur_size()));
+    if (start_blkno >= end_blkno)
+        return;
+
+    std::vector<page_to_read> pages;
+    collect_pages_to_read(start_blkno, end_blkno, pages);
+    for (auto &p : pages)
+    {
+        /* 文件空洞和超出inode范围的page不需要I/O，留给prepare_page_content处理 */
+        if (p.lpa == INVALID_LPA)
+            continue;
+        HSCFS_LOG(HSCFS_LOG_DEBUG, "readahead page offset %u of file(ino = %u), lpa = %u.", 
+            p.page->get_blkoff(), ino, p.lpa);
+        page_cache_->read_page_async(p.page, fs_manager->get_device(), p.lpa);
+    }
+}
+
+uint32_t file::batch_read_pages(uint32_t start_blkno, uint32_t end_blkno, std::vector<page_entry_handle> &pinned_pages)
+{
+    std::vector<page_to_read> pages;
+    collect_pages_to_read(start_blkno, end_blkno, pages);
+    if (pages.empty())
+        return 0;
+
+    uint32_t io_num = 0;
+    for (auto &p : pages)
+    {
+        if (p.lpa != INVALID_LPA)
+            ++io_num;
+    }
+
+    /* 并发提交所有page的异步读，然后等待全部完成 */
+    async_vecio_synchronizer syn(io_num);
+    uint32_t submitted = 0;
+    try
+    {
+        for (auto &p : pages)
+        {
+            if (p.lpa == INVALID_LPA)
+                continue;
+            p.page->get_page_buffer().read_from_lpa_async(fs_manager->get_device(), p.lpa, 
+                async_vecio_synchronizer::generic_callback, &syn);
+            ++submitted;
+        }
+    }
+    catch (const std::exception &e)
+    {
+        /* 必须等待已经提交的I/O完成后才能释放syn，未提交的I/O视为失败 */
+        for (; submitted < io_num; ++submitted)
+            syn.cplt_once(COMM_CMD_CQE_ERROR);
+        syn.wait_cplt();
+        throw;
+    }
+
+    /* 若I/O失败，所有page保持invalid状态 */
+    if (syn.wait_cplt() != COMM_CMD_SUCCESS)
+        throw io_error("batch read pages failed.");
+
+    /* 全部I/O成功，page内容有效(空洞和超出inode范围的page置为零页) */
+    for (auto &p : pages)
+    {
+        p.page->set_lpa(p.lpa);
+        if (p.lpa == INVALID_LPA)
+            p.page->set_zero_page();
+        else
+            p.page->set_state(page_state::ready);
+        pinned_pages.emplace_back(p.page);
+    }
+    HSCFS_LOG(HSCFS_LOG_DEBUG, "batch read %u pages of file(ino = %u) in blkno range [%u, %u).",
+        io_num, ino, start_blkno, end_blkno);
+    return io_num;
+}
+
+void file::collect_pages_to_read(uint32_t start_blkno, uint32_t end_blkno, std::vector<page_to_read> &pages)
+{
+    for (uint32_t blkno = start_blkno; blkno < end_blkno; ++blkno)
+    {
+        /* 只尝试获取page_lock，page正被其它线程使用时跳过，避免阻塞，也避免与按序加锁的读写者死锁 */
+        page_entry_handle page = page_cache_->get(blkno);
+        std::unique_lock<std::mutex> page_lg(page->get_page_lock(), std::try_to_lock);
+        if (!page_lg.owns_lock() || page->get_state() != page_state::invalid)
+            continue;
+        pages.emplace_back(page_to_read{std::move(page), std::move(page_lg), INVALID_LPA});
+    }
+
+    if (pages.empty())
+        return;
+
+    /* 在一次fs_meta_lock中完成所有page的映射查询 */
+    std::lock_guard<std::mutex> fs_meta_lg(fs_manager->get_fs_meta_lock());
+    for (auto &p : pages)
+        p.lpa = get_lpa_of_page_no_lock(p.page->get_blkoff());
+}
+
+void file::write_back(write_back_source src)
 {
     update_meta_to_inode();
 
@@ -170,32 +305,55 @@ void file::write_back()
     write_back_helper wb_helper(fs_manager);
     file_mapping_util fm_util(fs_manager);
     srmap_utils *srmap_util = fs_manager->get_srmap_util();
+    log_temp temp = write_back_helper::get_file_data_temp(src);
+    wb_helper.plan_write_back(write_back_helper::block_type::data, temp, dirty_pages.size());
     async_vecio_synchronizer syn(dirty_pages.size());
 
     for (auto &entry: dirty_pages)
     {
         page_entry_handle &page_handle = entry.second;
+
+        /* 整页覆盖写的page没有查询旧lpa，此时从extent缓存或file mapping得到，以便将其无效化 */
+        if (page_handle->is_lpa_unresolved())
+        {
+            uint32_t old_lpa;
+            if (!extents.lookup(page_handle->get_blkoff(), old_lpa))
+                old_lpa = fm_util.get_addr_of_block(ino, page_handle->get_blkoff()).lpa;
+            page_handle->set_lpa(old_lpa);
+        }
         
         /* 将page写回SSD */
         uint32_t new_lpa = wb_helper.do_write_back_async(page_handle->get_page_buffer(), page_handle->get_lpa_ref(), 
-            write_back_helper::block_type::data, async_vecio_synchronizer::generic_callback, &syn);
+            write_back_helper::block_type::data, temp, async_vecio_synchronizer::generic_callback, &syn);
         assert(new_lpa == page_handle->get_lpa_ref());
 
         /* 更新file mapping */
         block_addr_info addr = fm_util.update_block_mapping(ino, page_handle->get_blkoff(), new_lpa);
+        extents.insert(page_handle->get_blkoff(), new_lpa);
 
         /* 写入SRMAP表 */
         srmap_util->write_srmap_of_data(new_lpa, ino, page_handle->get_blkoff());
     }
 
     /* 等待所有异步I/O完成 */
+    wb_helper.submit_pending_writes();
     comm_cmd_result res = syn.wait_cplt();
     if (res != comm_cmd_result::COMM_CMD_SUCCESS)
         throw io_error("write back page cache failed.");
     
+    /* 旧LPA的无效化记录在当前日志中，文件的node必须与之在同一事务中提交 */
+    if (!dirty_pages.empty())
+        fs_manager->get_cur_journal()->add_dependent_ino(ino);
+    fs_manager->get_super_manager()->add_user_written_blocks(dirty_pages.size());
     page_cache_->clear_dirty_pages();  // 清除页面的脏标记
 }
 
+void file::update_page_lpa(uint32_t blkoff, uint32_t old_lpa, uint32_t new_lpa)
+{
+    extents.insert(blkoff, new_lpa);
+    page_cache_->update_lpa(blkoff, old_lpa, new_lpa);
+}
+
 bool file::mark_dirty()
 {
     bool expect = false;
@@ -265,48 +423,98 @@ void file::set_cur_size_if_larger(uint64_t size_after_write)
         size = size_after_write;
 }
 
-void file::prepare_page_content(page_entry_handle &page)
+bool file::prepare_page_content(page_entry_handle &page)
 {
+    /* page正在被预读，等待预读完成 */
+    if (page->get_state() == page_state::reading)
+        page_cache_->wait_page_read_cplt(page);
+
     /* page内容有效，直接返回 */
     if (page->get_state() == page_state::ready)
-        return;
+        return false;
     
-    /* page内容无效，判断是应该从SSD读，还是应该直接初始化 */
+    /* page内容无效，在fs_meta_lock保护下确定page的lpa，判断是应该从SSD读，还是应该直接初始化 */
+    uint32_t blkoff = page->get_blkoff();
+    uint32_t lpa = get_lpa_of_page(blkoff);
+
+    /* 
+     * page超出了文件块偏移范围或在文件空洞中，lpa为INVALID_LPA，内容为0
+     * 置为零页，释放page_entry复用时可能残留的块缓存区，写入时再分配
+     */
+    if (lpa == INVALID_LPA)
+    {
+        page->set_lpa(INVALID_LPA);
+        page->set_zero_page();
+        return false;
+    }
+
+    /*
+     * 否则，在不持有fs_meta_lock的情况下从SSD读出内容，避免一次同步I/O阻塞整个文件系统
+     * 读期间lpa不会失效：调用者持有file_op_lock共享锁和page_lock，该page不会被写回或截断，
+     * 而fs_freeze_lock共享锁保证文件系统不会在此期间被卸载
+     * I/O成功完成后才将page置为ready，若I/O失败，page仍为invalid，不会被其它线程当作有效内容使用
+     */
+    HSCFS_LOG(HSCFS_LOG_DEBUG, "the LPA of page offset %u in file(ino = %u) is %u.", blkoff, ino, lpa);
+    page->get_page_buffer().read_from_lpa(fs_manager->get_device(), lpa);
+    page->set_lpa(lpa);
     page->set_state(page_state::ready);
+    return true;
+}
+
+uint32_t file::get_lpa_of_page(uint32_t blkoff)
+{
     std::lock_guard<std::mutex> fs_meta_lg(fs_manager->get_fs_meta_lock());
-    uint32_t blkoff = page->get_blkoff();
+    return get_lpa_of_page_no_lock(blkoff);
+}
+
+uint32_t file::get_lpa_of_page_no_lock(uint32_t blkoff)
+{
+    /* extent缓存只记录有效映射，命中时不需要再访问inode和索引node */
+    uint32_t lpa;
+    if (extents.lookup(blkoff, lpa))
+        return lpa;
 
-    /* 获取该文件的inode block，得到当前inode中文件的最大块偏移 */
+    /* 获取该文件的inode block，得到当前inode中文件的块数 */
     node_cache_helper node_helper(fs_manager);
     auto inode_handle = node_helper.get_node_entry(ino, INVALID_NID);
     hscfs_inode *inode = &inode_handle->get_node_block_ptr()->i;
     uint64_t size_in_inode = inode->i_size;
-    uint64_t max_blkoff_in_inode = SIZE_TO_BLOCK(size_in_inode) - 1;
 
-    /* page超出了文件块偏移范围，lpa为INVALID_LPA，内容初始化为0即可(block_buffer构造时自动完成) */
-    if (blkoff > max_blkoff_in_inode)
+    /* page超出了文件块偏移范围 */
+    if (blkoff >= SIZE_TO_BLOCK(size_in_inode))
     {
         HSCFS_LOG(HSCFS_LOG_DEBUG, "page offset %u of file(ino = %u) is beyond file size(%u bytes).", 
             blkoff, ino, size_in_inode);
-        page->set_lpa(INVALID_LPA);
-        return;
+        return INVALID_LPA;
     }
 
     /* page在文件块偏移范围内，通过文件索引查询找到它的LPA */
     block_addr_info page_addr = file_mapping_util(fs_manager).get_addr_of_block(ino, blkoff);
 
-    /* 如果page在文件空洞范围内，lpa为INVALID_LPA，内容初始化为0 */
+    /* 如果page在文件空洞范围内，lpa为INVALID_LPA */
     if (page_addr.lpa == INVALID_LPA)
-    {
         HSCFS_LOG(HSCFS_LOG_DEBUG, "page offset %u of file(ino = %u) is in file holes.", blkoff, ino);
-        page->set_lpa(INVALID_LPA);
-        return;        
-    }
+    else
+        cache_extent_of_block(blkoff, page_addr);
 
-    /* 否则，初始化其lpa，从SSD读出内容 */
-    HSCFS_LOG(HSCFS_LOG_DEBUG, "the LPA of page offset %u in file(ino = %u) is %u.", blkoff, ino, page_addr.lpa);
-    page->set_lpa(page_addr.lpa);
-    page->get_page_buffer().read_from_lpa(fs_manager->get_device(), page_addr.lpa);
+    return page_addr.lpa;
+}
+
+void file::cache_extent_of_block(uint32_t blkoff, block_addr_info &addr)
+{
+    /* addr所在的node中，下标i的direct pointer对应块偏移blkoff - addr.nid_off + i */
+    const int level = addr.nid == ino ? 0 : 1;
+    const uint32_t addr_num = level == 0 ? DEF_ADDRS_PER_INODE : DEF_ADDRS_PER_BLOCK;
+    hscfs_node *node = addr.nid_handle->get_node_block_ptr();
+
+    uint32_t start = addr.nid_off, end = addr.nid_off + 1;
+    while (start > 0 && addr.lpa - (addr.nid_off - start + 1) != INVALID_LPA &&
+        file_mapping_util::get_lpa(node, start - 1, level) == addr.lpa - (addr.nid_off - start + 1))
+        --start;
+    while (end < addr_num && file_mapping_util::get_lpa(node, end, level) == addr.lpa + (end - addr.nid_off))
+        ++end;
+
+    extents.insert(blkoff - (addr.nid_off - start), addr.lpa - (addr.nid_off - start), end - start);
 }
 
 void file::update_meta_to_inode()
@@ -383,16 +591,57 @@ std::unordered_map<uint32_t, file_handle> file_obj_cache::get_and_clear_dirty_fi
     return ret;
 }
 
+std::vector<file_handle> file_obj_cache::get_dirty_files_to_flush(
+    std::chrono::steady_clock::time_point expire_time, size_t dirty_pages_limit)
+{
+    std::vector<std::pair<std::chrono::steady_clock::time_point, file_handle>> candidates;
+    {
+        spin_lock_guard dirty_files_lg(dirty_files_lock);
+        candidates.reserve(dirty_files.size());
+        for (auto &entry : dirty_files)
+            candidates.emplace_back(entry.second.entry->dirty_time, entry.second);
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const auto &lhs, const auto &rhs) {
+        return lhs.first < rhs.first;
+    });
+
+    /* 不在dirty_files_lock内获取dirty_pages_lock，避免嵌套自旋锁 */
+    size_t dirty_page_num = 0;
+    std::vector<size_t> page_nums;
+    page_nums.reserve(candidates.size());
+    for (auto &candidate : candidates)
+    {
+        page_nums.push_back(candidate.second->page_cache_->get_dirty_page_num());
+        dirty_page_num += page_nums.back();
+    }
+
+    std::vector<file_handle> ret;
+    for (size_t i = 0; i < candidates.size(); ++i)
+    {
+        if (candidates[i].first > expire_time && dirty_page_num <= dirty_pages_limit)
+            break;
+        dirty_page_num -= page_nums[i];
+        ret.emplace_back(std::move(candidates[i].second));
+    }
+    return ret;
+}
+
+size_t file_obj_cache::get_dirty_file_num()
+{
+    spin_lock_guard dirty_files_lg(dirty_files_lock);
+    return dirty_files.size();
+}
+
 void file_obj_cache::add_refcount(file *entry)
 {
     if (++entry->ref_count == 1)
-        cache_manager.pin(entry->ino);
+        cache_manager.pin(entry->ino, entry);
 }
 
 void file_obj_cache::sub_refcount(file *entry)
 {
     if (--entry->ref_count == 0)
-        cache_manager.unpin(entry->ino);
+        cache_manager.unpin(entry->ino, entry);
 }
 
 void file_obj_cache::do_relpace()
@@ -420,6 +669,7 @@ void file_obj_cache::add_to_dirty_files(const file_handle &file)
     spin_lock_guard lg(dirty_files_lock);
     uint32_t ino = file.entry->ino;
     assert(dirty_files.count(ino) == 0);
+    file.entry->dirty_time = std::chrono::steady_clock::now();
     dirty_files.emplace(ino, file);
 }
 
@@ -447,9 +697,9 @@ void file_obj_cache::remove_file(file *entry)
     /* 在缓存中移除file对象 */
     assert(entry->ref_count == 1);  // 此方法必然由最后一个引用file的handle调用，因此ref_count只可能为1
     entry->ref_count = 0;
-    cache_manager.unpin(entry->ino);
+    cache_manager.unpin(entry->ino, entry);
     uint32_t ino = entry->ino;
-    cache_manager.remove(ino);  // 此时file对象析构, entry参数变为悬挂指针
+    cache_manager.remove(ino, entry);  // 此时file对象析构, entry参数变为悬挂指针
     --cur_size;
 }
 
@@ -484,10 +734,10 @@ void file_handle::clear_dirty()
     }
 }
 
-void file_handle::write_back()
+void file_handle::write_back(write_back_source src)
 {
     clear_dirty();
-    entry->write_back();
+    entry->write_back(src);
 }
 
 void file_handle::delete_file()
@@ -6,6 +6,8 @@
 #include "fs/SIT_utils.hh"
 #include "fs/directory.hh"
 #include "fs/replace_protect.hh"
+#include "fs/lookup_policy.hh"
+#include "journal/journal_container.hh"
 #include "cache/node_block_cache.hh"
 #include "communication/memory.h"
 #include "communication/comm_api.h"
@@ -15,6 +17,7 @@
 
 #include <memory>
 #include <tuple>
+#include <chrono>
 
 struct comm_dev;
 
@@ -82,15 +85,20 @@ void ssd_file_mapping_search_controller::construct_task(uint32_t ino, uint32_t n
 
 void ssd_file_mapping_search_controller::do_filemapping_search()
 {
-	/* 需要等待SSD侧日志应用完成 */
+	/* 
+	 * SSD只访问该文件索引树上的node和它们的NAT表项，只需等待修改过该文件索引树的事务被SSD应用
+	 * 其它事务与此次查询无关，不必等待
+	 */
 	replace_protect_manager *rp_manager = fs_manager->get_replace_protect_manager();
-	rp_manager->wait_all_journal_applied_in_SSD();
+	rp_manager->wait_ino_journal_applied_in_SSD(p_task_buf->ino);
 
 	assert(p_task_buf != nullptr && p_task_res_buf != nullptr);
+	auto start = std::chrono::steady_clock::now();
 	int ret = comm_submit_sync_filemapping_search_request(dev, p_task_buf.get(), p_task_res_buf.get(), 
 		level_num * sizeof(hscfs_node));
 	if (ret != 0)
 		throw io_error("ssd_file_mapping_search_controller: send file mapping search task failed.");
+	fs_manager->get_lookup_policy()->record_ssd_filemapping_search(start);
 
 	#ifdef CONFIG_PRINT_DEBUG_INFO
 	print_filemapping_search_result(p_task_res_buf.get(), level_num);
@@ -172,6 +180,16 @@ got:
 	return level;
 }
 
+bool file_mapping_util::is_indirect_node_offset(uint32_t noffset)
+{
+	const uint32_t dptrs_per_blk = NIDS_PER_BLOCK;
+	if (noffset == 3 || noffset == 4 + dptrs_per_blk || noffset == 5 + dptrs_per_blk * 2)
+		return true;
+	if (noffset >= 6 + dptrs_per_blk * 2)
+		return (noffset - 6 - dptrs_per_blk * 2) % (dptrs_per_blk + 1) == 0;
+	return false;
+}
+
 uint32_t file_mapping_util::get_next_nid(hscfs_node *node, uint32_t offset, int cur_level)
 {
     if (cur_level == 0)  // 如果是inode
@@ -239,13 +257,27 @@ block_addr_info file_mapping_util::get_addr_of_block(uint32_t ino, uint32_t blkn
     {
         cur_handle = node_cache->get(cur_nid);
 
+		/* 
+		 * 当前node block缓存不命中时，它在索引路径上的子node也一定不在缓存中
+		 * 由lookup_policy选择在主机侧经NAT表读取当前node，或将剩余的索引路径交给SSD查询
+		 */
+		int ssd_level = level - cur_level + 1;
+		lookup_policy *policy = fs_manager->get_lookup_policy();
+		if (cur_handle.is_empty() && policy->search_filemapping_on_host(ssd_level))
+		{
+			HSCFS_LOG(HSCFS_LOG_INFO, "file_mapping_util:"
+				"node block[file(inode: %u), level %d, nid %u] miss. Read it on host", ino, cur_level, cur_nid);
+			auto start = std::chrono::steady_clock::now();
+			cur_handle = node_cache_helper(fs_manager).get_node_entry(cur_nid, parent_nid);
+			policy->record_host_lookup(1, start);
+		}
+
         /* 当前node block缓存不命中，交给SSD进行查询 */
         if (cur_handle.is_empty())
         {
 			HSCFS_LOG(HSCFS_LOG_INFO, "file_mapping_util:"
 				"node block[file(inode: %u), level %d, nid %u] miss. Prepare fetching from SSD", 
 				ino, cur_level, cur_nid);
-			int ssd_level = level - cur_level + 1;
 			ssd_file_mapping_search_controller ctrlr(fs_manager);
 			ctrlr.construct_task(ino, cur_nid, blkno, ssd_level);
 			ctrlr.do_filemapping_search();
@@ -259,7 +291,7 @@ block_addr_info file_mapping_util::get_addr_of_block(uint32_t ino, uint32_t blkn
 				uint32_t nid = p_node->footer.nid;
 				uint32_t lpa = nat_lpa_mapping(fs_manager).get_lpa_of_nid(nid);
 				
-				block_buffer buffer;
+				block_buffer buffer(false);
 				buffer.copy_content_from_buf(reinterpret_cast<char*>(p_node));
 				
 				/* 此时parent一定在缓存中，直接插入不会出错 */
@@ -360,6 +392,7 @@ void file_resizer::reduce(uint32_t ino, uint64_t tar_size)
 	
 	HSCFS_LOG(HSCFS_LOG_INFO, "reduce file [%u] size from %u bytes to %u bytes, will free blocks ranging [%u, %u].",
 		ino, cur_size, tar_size, start_blk, end_blk);
+	fs_manager->get_cur_journal()->add_dependent_ino(ino);
 	free_blocks_in_range(node, start_blk, end_blk);
 }
 
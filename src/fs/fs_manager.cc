@@ -3,6 +3,8 @@
 #include "cache/dir_data_block_cache.hh"
 #include "cache/node_block_cache.hh"
 #include "cache/SIT_NAT_cache.hh"
+#include "cache/page_cache.hh"
+#include "cache/dma_block_pool.hh"
 #include "fs/fd_array.hh"
 #include "fs/file.hh"
 #include "fs/srmap_utils.hh"
@@ -11,11 +13,15 @@
 #include "fs/replace_protect.hh"
 #include "fs/server_thread.hh"
 #include "fs/write_back_helper.hh"
-#include "fs/replace_protect.hh"
+#include "fs/group_commit.hh"
+#include "fs/background_flusher.hh"
+#include "fs/segment_cleaner.hh"
+#include "fs/lookup_policy.hh"
 #include "journal/journal_container.hh"
 #include "utils/hscfs_exceptions.hh"
 #include "utils/lock_guards.hh"
 #include <system_error>
+#include <algorithm>
 
 namespace hscfs {
 
@@ -37,7 +43,7 @@ file_system_manager::~file_system_manager()
         HSCFS_LOG(HSCFS_LOG_WARNING, "file system manager: destruct fs freeze lock failed.");
 }
 
-void file_system_manager::init(comm_dev *device)
+void file_system_manager::init(comm_dev *device, size_t page_cache_budget)
 {
     g_fs_manager = std::make_unique<file_system_manager>();
     int ret = rwlock_init(&g_fs_manager->fs_freeze_lock);
@@ -53,6 +59,8 @@ void file_system_manager::init(comm_dev *device)
     g_fs_manager->dir_data_cache = std::make_unique<dir_data_block_cache>(dir_data_cache_size);
     g_fs_manager->sit_cache = std::make_unique<SIT_NAT_cache>(device, sit_cache_size);
     g_fs_manager->nat_cache = std::make_unique<SIT_NAT_cache>(device, nat_cache_size);
+    g_fs_manager->pg_pool = std::make_unique<page_pool>(page_cache_budget);
+    HSCFS_LOG(HSCFS_LOG_INFO, "page cache budget: %zu pages.", g_fs_manager->pg_pool->get_budget_pages());
     g_fs_manager->file_cache = std::make_unique<file_obj_cache>(file_cache_size, g_fs_manager.get());
     g_fs_manager->srmap_util = std::make_unique<srmap_utils>(g_fs_manager.get());
 
@@ -64,7 +72,24 @@ void file_system_manager::init(comm_dev *device)
     g_fs_manager->fd_arr = std::make_unique<fd_array>(fd_array_size);
     g_fs_manager->cur_journal = std::make_unique<journal_container>();
     g_fs_manager->rp_manager = std::make_unique<replace_protect_manager>(g_fs_manager.get());
+    g_fs_manager->committer = std::make_unique<group_committer>(g_fs_manager.get());
     g_fs_manager->server_th = std::make_unique<server_thread>();
+
+    /* 默认在脏页超过page cache预算的1/4，或dirty node超过node cache容量的一半时开始后台回写 */
+    flush_policy policy;
+    policy.dirty_pages_limit = g_fs_manager->pg_pool->get_budget_pages() / 4;
+    policy.dirty_nodes_limit = node_cache_size / 2;
+    g_fs_manager->flusher = std::make_unique<background_flusher>(g_fs_manager.get(), g_fs_manager->server_th.get(), policy);
+
+    /* 默认在空闲segment少于主区域的1/10(至少4个)时开始后台清理 */
+    gc_policy gc_p;
+    gc_p.background_free_segs = std::max<uint32_t>(gc_p.background_free_segs, 
+        (*g_fs_manager->super)->segment_count_main / 10);
+    g_fs_manager->cleaner = std::make_unique<segment_cleaner>(g_fs_manager.get(), g_fs_manager->server_th.get(), gc_p);
+
+    /* 空闲segment降到后台清理阈值后，不再打开新的hot/cold活跃segment，清理迁移只使用warm活跃segment */
+    g_fs_manager->sp_manager->set_temp_log_reserved_segs(gc_p.background_free_segs);
+    g_fs_manager->lk_policy = std::make_unique<lookup_policy>();
     g_fs_manager->server_th->start();
 
     g_fs_manager->is_unrecoverable = false;
@@ -82,11 +107,41 @@ void file_system_manager::fini()
 
         /* 停止服务线程 */
         g_fs_manager->server_th->stop();
+
+        group_commit_stat stat = g_fs_manager->committer->get_stat();
+        HSCFS_LOG(HSCFS_LOG_INFO, "fsync group commit: %lu fsyncs in %lu transactions (%.2f per transaction), "
+            "p50 latency < %lu us, p99 latency < %lu us.", stat.fsync_num, stat.tx_num, stat.get_commits_per_tx(),
+            stat.get_latency_percentile_us(0.5), stat.get_latency_percentile_us(0.99));
+
+        flush_stat f_stat = g_fs_manager->flusher->get_stat();
+        HSCFS_LOG(HSCFS_LOG_INFO, "background flush: %lu files written back in %lu transactions.",
+            f_stat.file_num, f_stat.tx_num);
+
+        gc_stat g_stat = g_fs_manager->cleaner->get_stat();
+        HSCFS_LOG(HSCFS_LOG_INFO, "segment cleaner: %lu segments cleaned in %lu runs (%lu foreground), "
+            "%lu blocks migrated, %lu empty segments reclaimed.", g_stat.victim_num, g_stat.run_num, 
+            g_stat.foreground_run_num, g_stat.migrated_blocks, g_stat.reclaimed_num);
+
+        const write_amp_stat &wa_stat = g_fs_manager->sp_manager->get_write_amp_stat();
+        HSCFS_LOG(HSCFS_LOG_INFO, "write amplification: %.2f (%lu user data blocks, %lu blocks written).",
+            wa_stat.get_write_amplification(), wa_stat.user_blks, wa_stat.get_total_blks());
+
+        const lookup_policy_stat &l_stat = g_fs_manager->lk_policy->get_stat();
+        HSCFS_LOG(HSCFS_LOG_INFO, "lookup policy: path lookup %lu components on host, %lu offloaded; "
+            "file mapping %lu nodes on host, %lu offloaded; %lu probes. host read %.1fus, SSD path lookup %.1fus, "
+            "SSD file mapping search %.1fus.", l_stat.host_path_num, l_stat.ssd_path_num, l_stat.host_filemapping_num,
+            l_stat.ssd_filemapping_num, l_stat.probe_num, l_stat.host_read_us, l_stat.ssd_path_us,
+            l_stat.ssd_filemapping_us);
     }
     
     /* 析构fs_manager */
     g_fs_manager = nullptr;
     HSCFS_LOG(HSCFS_LOG_INFO, "destructed all file system cache.");
+
+    dma_block_pool_stat p_stat = dma_block_pool::get_instance()->get_stat();
+    HSCFS_LOG(HSCFS_LOG_INFO, "dma block pool: %lu/%lu blocks free in %lu slabs, %lu allocations "
+        "(%lu from thread cache, %lu zeroed).", p_stat.free_blocks, p_stat.total_blocks, p_stat.slab_num,
+        p_stat.alloc_num, p_stat.thread_cache_hit, p_stat.zeroed_num);
 }
 
 void do_close(int fd);
@@ -105,7 +160,7 @@ void file_system_manager::write_back_all_dirty_sync()
     for (auto &entry: dirty_files)
     {
         file_handle &handle = entry.second;
-        handle->write_back();
+        handle->write_back(write_back_source::other);
     }
 
     /* 然后回写所有的脏元数据 */
@@ -0,0 +1,154 @@
+#include "fs/group_commit.hh"
+#include "fs/fs_manager.hh"
+#include "fs/file.hh"
+#include "fs/write_back_helper.hh"
+#include "journal/journal_process_env.hh"
+#include "utils/hscfs_log.h"
+
+#include <unordered_set>
+
+namespace hscfs {
+
+uint64_t group_commit_stat::get_latency_percentile_us(double p) const noexcept
+{
+    uint64_t target = static_cast<uint64_t>(p * fsync_num);
+    if (target == 0)
+        target = 1;
+    uint64_t cnt = 0;
+    for (size_t i = 0; i < latency_bucket_num; ++i)
+    {
+        cnt += latency_hist[i];
+        if (cnt >= target)
+            return 1UL << i;
+    }
+    return 1UL << (latency_bucket_num - 1);
+}
+
+group_committer::group_committer(file_system_manager *fs_manager, std::chrono::microseconds window)
+{
+    this->fs_manager = fs_manager;
+    this->window = window;
+    active_num = 0;
+    has_leader = false;
+    flushing = false;
+}
+
+void group_committer::fsync(file_handle &handle)
+{
+    auto start = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lg(mtx);
+        ++active_num;
+    }
+
+    /* 回写文件数据 */
+    try
+    {
+        std::lock_guard<std::mutex> fs_meta_lg(fs_manager->get_fs_meta_lock());
+        handle.write_back(write_back_source::fsync);
+    }
+    catch (...)
+    {
+        {
+            std::lock_guard<std::mutex> lg(mtx);
+            --active_num;
+        }
+        cond.notify_all();
+        throw;
+    }
+
+    /* 加入当前组 */
+    waiter w(handle->get_inode());
+    std::unique_lock<std::mutex> lk(mtx);
+    --active_num;
+    pending.push_back(&w);
+
+    if (has_leader)
+    {
+        cond.notify_all();  // leader可能在等待组员加入
+        cond.wait(lk, [&w] { return w.done; });
+    }
+    else
+    {
+        has_leader = true;
+
+        /* 等待其它正在回写数据的fsync加入，最多等待window；再等待上一组回写元数据完成 */
+        cond.wait_for(lk, window, [this] { return active_num == 0; });
+        cond.wait(lk, [this] { return !flushing; });
+
+        std::vector<waiter*> group;
+        group.swap(pending);
+        has_leader = false;
+        flushing = true;
+        lk.unlock();
+
+        std::exception_ptr err;
+        uint64_t tx_end = 0;
+        try
+        {
+            tx_end = flush_group(group);
+        }
+        catch (...)
+        {
+            err = std::current_exception();
+        }
+
+        /* 元数据回写完成后，下一组即可开始回写，与本组等待日志落盘并行 */
+        lk.lock();
+        flushing = false;
+        ++stat.tx_num;
+        if (group.size() > stat.max_group_size)
+            stat.max_group_size = group.size();
+        cond.notify_all();
+        lk.unlock();
+
+        if (!err)
+            journal_process_env::get_instance()->wait_tx_persisted(tx_end);
+
+        lk.lock();
+        for (waiter *p : group)
+        {
+            p->err = err;
+            p->done = true;
+        }
+        cond.notify_all();
+    }
+
+    record_latency(start);
+    lk.unlock();
+    if (w.err)
+        std::rethrow_exception(w.err);
+}
+
+group_commit_stat group_committer::get_stat()
+{
+    std::lock_guard<std::mutex> lg(mtx);
+    return stat;
+}
+
+uint64_t group_committer::flush_group(const std::vector<waiter*> &group)
+{
+    std::unordered_set<uint32_t> inos;
+    for (waiter *p : group)
+        inos.insert(p->ino);
+    HSCFS_LOG(HSCFS_LOG_INFO, "group commit %zu fsync(s) of %zu file(s).", group.size(), inos.size());
+
+    /* 组中文件的元数据可能在之前的事务中已经提交，所以要等待此前提交的所有事务落盘，而不只是本次生成的事务 */
+    std::lock_guard<std::mutex> fs_meta_lg(fs_manager->get_fs_meta_lock());
+    write_back_helper(fs_manager).write_files_meta_back_sync(inos);
+    return journal_process_env::get_instance()->get_committed_tx_end();
+}
+
+void group_committer::record_latency(std::chrono::steady_clock::time_point start)
+{
+    uint64_t us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    size_t bucket = 0;
+    while (bucket + 1 < group_commit_stat::latency_bucket_num && (1UL << bucket) <= us)
+        ++bucket;
+    ++stat.latency_hist[bucket];
+    ++stat.fsync_num;
+    stat.total_latency_us += us;
+}
+
+}  // namespace hscfs
@@ -0,0 +1,117 @@
+#include "fs/lookup_policy.hh"
+#include "utils/hscfs_log.h"
+
+#include <cassert>
+
+namespace hscfs {
+
+static double elapsed_us(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+lookup_policy::lookup_policy()
+    : mode(lookup_mode::adaptive)
+{
+    stat.host_read_us = default_latency_us;
+    stat.ssd_path_us = default_latency_us;
+    stat.ssd_filemapping_us = default_latency_us;
+    host_skipped = ssd_skipped = 0;
+}
+
+bool lookup_policy::lookup_path_on_host(uint32_t host_reads, uint32_t remain_num)
+{
+    assert(remain_num >= 1);
+    bool on_host;
+    switch (get_mode())
+    {
+    case lookup_mode::host:
+        on_host = true;
+        break;
+    case lookup_mode::ssd:
+        on_host = false;
+        break;
+    default:
+    {
+        /* 主机侧每次只查找一个目录项，而SSD一条命令完成剩余的全部目录项 */
+        uint32_t total_reads = host_reads + (remain_num - 1) * unknown_component_reads;
+        on_host = choose_host(total_reads * stat.host_read_us, stat.ssd_path_us);
+        HSCFS_LOG(HSCFS_LOG_INFO, "lookup policy: path lookup with %u component(s) remaining, estimated host reads: "
+            "%u, host cost: %.1fus, SSD cost: %.1fus, lookup on %s.", remain_num, total_reads,
+            total_reads * stat.host_read_us, stat.ssd_path_us, on_host ? "host" : "SSD");
+        break;
+    }
+    }
+
+    if (on_host)
+        ++stat.host_path_num;
+    else
+        ++stat.ssd_path_num;
+    return on_host;
+}
+
+bool lookup_policy::search_filemapping_on_host(uint32_t miss_level_num)
+{
+    assert(miss_level_num >= 1);
+    bool on_host;
+    switch (get_mode())
+    {
+    case lookup_mode::host:
+        on_host = true;
+        break;
+    case lookup_mode::ssd:
+        on_host = false;
+        break;
+    default:
+        on_host = choose_host(miss_level_num * stat.host_read_us, stat.ssd_filemapping_us);
+        break;
+    }
+
+    if (on_host)
+        ++stat.host_filemapping_num;
+    else
+        ++stat.ssd_filemapping_num;
+    return on_host;
+}
+
+void lookup_policy::record_host_lookup(uint32_t host_reads, std::chrono::steady_clock::time_point start)
+{
+    /* 估计不需要读取的查找，耗时不反映读时延 */
+    if (host_reads != 0)
+        update_estimate(stat.host_read_us, elapsed_us(start) / host_reads);
+}
+
+void lookup_policy::record_ssd_path_lookup(std::chrono::steady_clock::time_point start)
+{
+    update_estimate(stat.ssd_path_us, elapsed_us(start));
+}
+
+void lookup_policy::record_ssd_filemapping_search(std::chrono::steady_clock::time_point start)
+{
+    update_estimate(stat.ssd_filemapping_us, elapsed_us(start));
+}
+
+bool lookup_policy::choose_host(double host_cost, double ssd_cost)
+{
+    /* 全部命中缓存时，主机侧查找不需要访问SSD，不必比较 */
+    if (host_cost == 0)
+        return true;
+
+    bool on_host = host_cost <= ssd_cost;
+    uint32_t &skipped = on_host ? ssd_skipped : host_skipped;
+    if (++skipped >= probe_interval)
+    {
+        ++stat.probe_num;
+        on_host = !on_host;
+    }
+    (on_host ? host_skipped : ssd_skipped) = 0;
+    return on_host;
+}
+
+void lookup_policy::update_estimate(double &estimate, double sample) noexcept
+{
+    /* 新测量值权重为1/8 */
+    estimate += (sample - estimate) / 8;
+}
+
+}  // namespace hscfs
@@ -1,12 +1,22 @@
 #include "fs/opened_file.hh"
 #include "fs/open_flags.hh"
+#include "fs/fs_manager.hh"
+#include "cache/page_cache.hh"
 #include "utils/hscfs_exceptions.hh"
 #include "utils/lock_guards.hh"
+#include <algorithm>
 
 namespace hscfs {
 
+/* 预读窗口的上限，且不超过页缓存预算的1/4，防止一个文件的预读挤占其它文件的缓存 */
+static uint32_t get_max_readahead_window()
+{
+    size_t budget_pages = file_system_manager::get_instance()->get_page_pool()->get_budget_pages();
+    return static_cast<uint32_t>(std::min<size_t>(budget_pages / 4, 64));
+}
+
 opened_file::opened_file(uint32_t flags, const file_handle &file_)
-    : file(file_)
+    : file(file_), ra_window(get_max_readahead_window())
 {
     this->flags = flags;
     pos = 0;
@@ -23,7 +33,16 @@ ssize_t opened_file::read(char *buffer, ssize_t count)
     {
         /* 获得文件操作共享锁，获取后，文件长度保证不会减小(truncate需要获取此独占锁) */
         rwlock_guard file_op_lg(file->get_file_op_lock(), rwlock_guard::lock_type::rdlock);
-        num_read = file->read(buffer, count, pos);
+        uint32_t miss_num = 0;
+        num_read = file->read(buffer, count, pos, &miss_num);
+
+        /* 更新预读窗口，若检测到顺序读，则异步预读之后的page */
+        if (num_read > 0)
+        {
+            uint32_t ra_start, ra_num;
+            if (ra_window.update(pos / 4096, (pos + num_read - 1) / 4096 + 1, miss_num, ra_start, ra_num))
+                file->readahead(ra_start, ra_num);
+        }
     }
     file.mark_dirty();
     pos += num_read;
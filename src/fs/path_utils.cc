@@ -2,15 +2,22 @@
 #include "fs/fs_manager.hh"
 #include "fs/fs.h"
 #include "fs/replace_protect.hh"
-#include "fs/write_back_helper.hh"
+#include "fs/directory.hh"
+#include "fs/file_utils.hh"
+#include "fs/NAT_utils.hh"
+#include "fs/lookup_policy.hh"
+#include "cache/node_block_cache.hh"
+#include "cache/dir_data_block_cache.hh"
 #include "communication/comm_api.h"
 #include "communication/memory.h"
 #include "utils/dma_buffer_deletor.hh"
+#include "utils/io_utils.hh"
 #include "utils/hscfs_exceptions.hh"
 #include "utils/hscfs_log.h"
 
 #include <cassert>
 #include <memory>
+#include <chrono>
 
 /* SSD path lookup控制器 */
 /*************************************************************************/
@@ -33,6 +40,12 @@ public:
     /* 进行路径解析，将结果保存到内部buf中。同步，等待命令执行完成后返回 */
     void do_pathlookup();
 
+    /* 
+     * 异步发送路径解析命令，命令完成时调用cb_func，结果保存到内部buf中
+     * 调用者应先等待SSD应用已提交的日志(见replace_protect_manager)，并在cb_func被调用前保持此对象有效
+     */
+    void do_pathlookup_async(comm_async_cb_func cb_func, void *cb_arg);
+
     /* 返回结果中ino表的首元素地址 */
     uint32_t* get_first_addr_of_result_inos() const noexcept;
     
@@ -47,6 +60,15 @@ public:
      */
     dentry_store_pos get_result_pos() const noexcept;
 
+    /*
+     * 目标文件存在，或目标不存在但返回了有效的插入位置时，
+     * SSD同时返回了目标目录项所在(或将要插入)的目录数据块(dir_ino的块偏移dentry_blkidx)，及索引它的node
+     * 将二者加入node缓存和目录数据块缓存，使之后对该目录项的操作不需要再从SSD读取
+     * 缓存中已有的块可能比SSD返回的更新(主机侧的修改还未应用到SSD)，保留缓存中的块，不覆盖
+     * 调用者需持有fs_meta_lock
+     */
+    void cache_parent_dir_pages(uint32_t dir_ino);
+
 private:
     file_system_manager *fs_manager;
     comm_dev *dev;
@@ -54,6 +76,8 @@ private:
     std::unique_ptr<path_lookup_result, dma_buf_deletor> p_task_res_buf;
     uint32_t depth_;
     size_t task_length;
+
+    void alloc_result_buf();
 };
 
 #ifdef CONFIG_PRINT_DEBUG_INFO
@@ -114,9 +138,8 @@ void ssd_path_lookup_controller::construct_task(const path_parser &path_parser,
     #endif
 }
 
-void ssd_path_lookup_controller::do_pathlookup()
+void ssd_path_lookup_controller::alloc_result_buf()
 {
-    assert(p_task_buf != nullptr);
     if (p_task_res_buf == nullptr)
     {
         void *buf = comm_alloc_dma_mem(sizeof(path_lookup_result));
@@ -124,14 +147,32 @@ void ssd_path_lookup_controller::do_pathlookup()
             throw alloc_error("SSD path lookup controller: alloc task result memory failed.");
         p_task_res_buf.reset(static_cast<path_lookup_result*>(buf));
     }
+}
+
+void ssd_path_lookup_controller::do_pathlookup()
+{
+    assert(p_task_buf != nullptr);
+    alloc_result_buf();
 
     /* 需要等待SSD侧日志执行完成 */
     replace_protect_manager *rp_manager = fs_manager->get_replace_protect_manager();
     rp_manager->wait_all_journal_applied_in_SSD();
 
+    auto start = std::chrono::steady_clock::now();
     int ret = comm_submit_sync_path_lookup_request(dev, p_task_buf.get(), task_length, p_task_res_buf.get());
     if (ret != 0)
         throw io_error("ssd path lookup controller: send path lookup task failed.");
+    fs_manager->get_lookup_policy()->record_ssd_path_lookup(start);
+}
+
+void ssd_path_lookup_controller::do_pathlookup_async(comm_async_cb_func cb_func, void *cb_arg)
+{
+    assert(p_task_buf != nullptr);
+    alloc_result_buf();
+    int ret = comm_submit_async_path_lookup_request(dev, p_task_buf.get(), task_length, p_task_res_buf.get(), 
+        cb_func, cb_arg);
+    if (ret != 0)
+        throw io_error("ssd path lookup controller: send async path lookup task failed.");
 }
 
 uint32_t *ssd_path_lookup_controller::get_first_addr_of_result_inos() const noexcept
@@ -171,6 +212,71 @@ dentry_store_pos ssd_path_lookup_controller::get_result_pos() const noexcept
     return pos;
 }
 
+void ssd_path_lookup_controller::cache_parent_dir_pages(uint32_t dir_ino)
+{
+    path_lookup_result *result = p_task_res_buf.get();
+    hscfs_node *ssd_node = reinterpret_cast<hscfs_node*>(result->parent_dir_node_page);
+    uint32_t blkno = result->dentry_blkidx;
+    uint32_t offset[4], noffset[4];
+    int level = file_mapping_util::get_node_path(blkno, offset, noffset);
+    uint32_t nid = ssd_node->footer.nid;
+    if (level == -1 || ssd_node->footer.ino != dir_ino || ssd_node->footer.offset != noffset[level] ||
+        (level == 0 && nid != dir_ino))
+    {
+        HSCFS_LOG(HSCFS_LOG_WARNING, "ssd path lookup controller: node page returned by SSD (nid = %u) "
+            "does not index block %u of dir %u, ignored.", nid, blkno, dir_ino);
+        return;
+    }
+
+    /* 
+     * 加入node缓存要求父node已在缓存中，沿索引路径在缓存中找到父node
+     * 路径上有node不在缓存中时，不加入该node，只使用它得到数据块的地址
+     */
+    node_block_cache *node_cache = fs_manager->get_node_cache();
+    node_block_cache_entry_handle node_handle = node_cache->get(nid);
+    if (node_handle.is_empty())
+    {
+        uint32_t parent_nid = INVALID_NID, cur_nid = dir_ino;
+        bool parent_cached = true;
+        for (int cur_level = 0; cur_level < level; ++cur_level)
+        {
+            node_block_cache_entry_handle cur_handle = node_cache->get(cur_nid);
+            if (cur_handle.is_empty())
+            {
+                parent_cached = false;
+                break;
+            }
+            parent_nid = cur_nid;
+            cur_nid = file_mapping_util::get_next_nid(cur_handle->get_node_block_ptr(), offset[cur_level], cur_level);
+        }
+
+        if (parent_cached && cur_nid == nid)
+        {
+            block_buffer buffer(false);
+            buffer.copy_content_from_buf(result->parent_dir_node_page);
+            uint32_t lpa = nat_lpa_mapping(fs_manager).get_lpa_of_nid(nid);
+            node_handle = node_cache->add(std::move(buffer), nid, parent_nid, lpa);
+            HSCFS_LOG(HSCFS_LOG_INFO, "ssd path lookup controller: add node %u (lpa = %u) of dir %u returned by SSD "
+                "to node cache.", nid, lpa, dir_ino);
+        }
+    }
+
+    /* 主机侧缓存的node更新，以它记录的地址为准。地址与SSD返回的node不一致时，SSD返回的数据块不是最新的 */
+    uint32_t lpa = file_mapping_util::get_lpa(ssd_node, offset[level], level);
+    if (!node_handle.is_empty() && file_mapping_util::get_lpa(node_handle->get_node_block_ptr(), offset[level], 
+        level) != lpa)
+        return;
+    
+    dir_data_block_cache *dir_data_cache = fs_manager->get_dir_data_cache();
+    if (lpa == INVALID_LPA || !dir_data_cache->get(dir_ino, blkno).is_empty())
+        return;
+    block_buffer buffer(false);
+    buffer.copy_content_from_buf(result->parent_dir_data_page);
+    dir_data_cache->add(dir_ino, blkno, lpa, std::move(buffer));
+    HSCFS_LOG(HSCFS_LOG_INFO, "ssd path lookup controller: add block %u (lpa = %u) of dir %u returned by SSD "
+        "to dir data cache.", blkno, lpa, dir_ino);
+}
+
 /* SSD path lookup控制器 */
 /******************************************************************************/
 
@@ -253,6 +359,15 @@ bool path_helper::is_prefix_valid(const std::string &user_path, const std::strin
     return user_path.find(prefix) == 0;
 }
 
+uint32_t path_lookup_processor::get_remain_component_num(path_dentry_iterator itr, 
+    const path_dentry_iterator &end_itr)
+{
+    uint32_t num = 0;
+    for (; itr != end_itr; itr.next())
+        ++num;
+    return num;
+}
+
 void path_lookup_processor::set_abs_path(const std::string &abs_path)
 {
     start_dentry = fs_manager->get_root_dentry();
@@ -264,7 +379,6 @@ dentry_handle path_lookup_processor::do_path_lookup(dentry_store_pos *pos_info)
     if (pos_info)
         pos_info->is_valid = false;
     path_parser p_parser(path);
-    dentry_cache *d_cache = fs_manager->get_dentry_cache();
     dentry_handle cur_dentry = start_dentry;  // cur_dentry为当前搜索到的目录项
 
     HSCFS_LOG(HSCFS_LOG_INFO, 
@@ -273,8 +387,92 @@ dentry_handle path_lookup_processor::do_path_lookup(dentry_store_pos *pos_info)
         start_dentry->get_ino(), path.c_str()
     );
 
+    path_dentry_iterator itr = p_parser.begin();
+    if (lookup_on_host(p_parser, itr, cur_dentry, pos_info))
+        return cur_dentry;
+
+    /* 到此处，itr指向的目录项需要交给SSD查找 */
+    ssd_path_lookup_controller ctrlr(fs_manager);
+    ctrlr.construct_task(p_parser, cur_dentry->get_ino(), itr);
+    ctrlr.do_pathlookup();
+    return merge_ssd_result(ctrlr, p_parser, itr, cur_dentry, pos_info);
+}
+
+std::vector<dentry_handle> path_lookup_processor::do_batch_path_lookup(file_system_manager *fs_manager, 
+    const std::vector<std::string> &abs_paths)
+{
+    /* 一个需要交给SSD查找的路径。path_dentry_iterator引用parser中的路径字符串，所以entry分配在堆上，地址不变 */
+    struct ssd_entry
+    {
+        size_t idx;  // 在abs_paths中的下标
+        path_parser parser;
+        path_dentry_iterator itr;  // 第一个需要交给SSD查找的目录项
+        dentry_handle dir_dentry;  // itr所在的目录
+        ssd_path_lookup_controller ctrlr;
+
+        ssd_entry(size_t idx, const std::string &path, file_system_manager *fs_manager)
+            : idx(idx), parser(path), itr(parser.begin()), ctrlr(fs_manager) { }
+    };
+
+    std::vector<dentry_handle> results(abs_paths.size());
+    std::vector<std::unique_ptr<ssd_entry>> ssd_entries;
+    path_lookup_processor proc(fs_manager);
+
+    /* 首先在主机侧解析每个路径，直到需要交给SSD查找的目录项 */
+    for (size_t i = 0; i < abs_paths.size(); ++i)
+    {
+        auto entry = std::make_unique<ssd_entry>(i, abs_paths[i], fs_manager);
+        entry->dir_dentry = fs_manager->get_root_dentry();
+        if (proc.lookup_on_host(entry->parser, entry->itr, entry->dir_dentry, nullptr))
+        {
+            results[i] = entry->dir_dentry;
+            continue;
+        }
+        entry->ctrlr.construct_task(entry->parser, entry->dir_dentry->get_ino(), entry->itr);
+        ssd_entries.emplace_back(std::move(entry));
+    }
+    if (ssd_entries.empty())
+        return results;
+
+    /* 所有路径只需等待一次SSD侧日志应用，然后同时下发全部命令 */
+    HSCFS_LOG(HSCFS_LOG_INFO, "path lookup processor: batch lookup of %zu paths, %zu of them sent to SSD.",
+        abs_paths.size(), ssd_entries.size());
+    fs_manager->get_replace_protect_manager()->wait_all_journal_applied_in_SSD();
+    auto start = std::chrono::steady_clock::now();
+    async_vecio_synchronizer syn(ssd_entries.size());
+    for (size_t i = 0; i < ssd_entries.size(); ++i)
+    {
+        try
+        {
+            ssd_entries[i]->ctrlr.do_pathlookup_async(async_vecio_synchronizer::generic_callback, &syn);
+        }
+        catch (const io_error &e)
+        {
+            /* 已下发的命令仍会回调syn，等待它们完成后再抛出 */
+            for (size_t j = i; j < ssd_entries.size(); ++j)
+                syn.cplt_once(COMM_CMD_CQE_ERROR);
+            syn.wait_cplt();
+            throw;
+        }
+    }
+    if (syn.wait_cplt() != COMM_CMD_SUCCESS)
+        throw io_error("path lookup processor: batch path lookup in SSD failed.");
+    fs_manager->get_lookup_policy()->record_ssd_path_lookup(start);
+
+    /* 依次将SSD的结果合并到dentry cache */
+    for (auto &entry : ssd_entries)
+        results[entry->idx] = proc.merge_ssd_result(entry->ctrlr, entry->parser, entry->itr, entry->dir_dentry, 
+            nullptr);
+    return results;
+}
+
+bool path_lookup_processor::lookup_on_host(const path_parser &p_parser, path_dentry_iterator &itr, 
+    dentry_handle &cur_dentry, dentry_store_pos *pos_info)
+{
+    dentry_cache *d_cache = fs_manager->get_dentry_cache();
+
     /* itr指向下一个目录项 */
-    for (auto itr = p_parser.begin(), end_itr = p_parser.end(); itr != end_itr; itr.next())
+    for (auto end_itr = p_parser.end(); itr != end_itr; itr.next())
     {
         /* 如果当前目录项不是目录，则不再查找，返回不存在 */
         if (cur_dentry->get_type() != HSCFS_FT_DIR)
@@ -283,7 +481,8 @@ dentry_handle path_lookup_processor::do_path_lookup(dentry_store_pos *pos_info)
                 "path lookup processor: half-way dentry [%u:%s] is not directory, path lookup terminated.",
                 cur_dentry->get_key().dir_ino, cur_dentry->get_key().name.c_str()
             );
-            return dentry_handle();
+            cur_dentry = dentry_handle();
+            return true;
         }
 
         /* 如果当前目录项已经被删除，则不再查找 */
@@ -293,7 +492,8 @@ dentry_handle path_lookup_processor::do_path_lookup(dentry_store_pos *pos_info)
                 "path lookup processor: half-way dentry [%u:%s] is deleted, path lookup terminated.",
                 cur_dentry->get_key().dir_ino, cur_dentry->get_key().name.c_str()
             );
-            return dentry_handle();
+            cur_dentry = dentry_handle();
+            return true;
         }
 
         /* component_name为下一项的名称 */
@@ -310,6 +510,50 @@ dentry_handle path_lookup_processor::do_path_lookup(dentry_store_pos *pos_info)
 
         dentry_handle component_dentry = d_cache->get(cur_dentry->get_ino(), component_name);
 
+        /* 
+         * 下一个目录项不命中时，在主机侧查找该目录项，或将剩余路径交给SSD查找
+         * 如果cur_dentry是新建的目录，它在SSD上还不存在，SSD将访问错误的NAT表和文件数据
+         * 而新建目录的全部内容都在主机侧，直接在主机侧查找，不需要回写元数据并等待SSD应用日志
+         * 其它目录由lookup_policy根据缓存情况和SSD命令时延选择
+         */
+        bool lookup_on_host = false;
+        uint32_t host_reads = 0;
+        if (component_dentry.is_empty())
+        {
+            if (cur_dentry->is_newly_created())
+                lookup_on_host = true;
+            else
+            {
+                host_reads = directory(cur_dentry, fs_manager).estimate_lookup_reads(component_name);
+                lookup_on_host = fs_manager->get_lookup_policy()->lookup_path_on_host(host_reads, 
+                    get_remain_component_num(itr, end_itr));
+            }
+        }
+
+        if (lookup_on_host)
+        {
+            auto start = std::chrono::steady_clock::now();
+            dentry_info info = directory(cur_dentry, fs_manager).lookup(component_name);
+            fs_manager->get_lookup_policy()->record_host_lookup(host_reads, start);
+            if (info.ino == INVALID_NID)
+            {
+                HSCFS_LOG(HSCFS_LOG_INFO, "path lookup processor: dentry [%u:%s] does not exist (searched on host).",
+                    cur_dentry->get_ino(), component_name.c_str());
+                if (pos_info && itr.is_last_component(end_itr))
+                    *pos_info = info.store_pos;
+                cur_dentry = dentry_handle();
+                return true;
+            }
+
+            HSCFS_LOG(HSCFS_LOG_INFO, "path lookup processor: dentry [%u:%s] found on host, its inode is %u.", 
+                cur_dentry->get_ino(), component_name.c_str(), info.ino);
+            component_dentry = d_cache->add(cur_dentry->get_ino(), cur_dentry, info.ino, component_name);
+            component_dentry->set_type(info.type);
+            component_dentry->set_pos_info(info.store_pos);
+            if (pos_info && itr.is_last_component(end_itr))
+                *pos_info = info.store_pos;
+        }
+
         /* 
          * 如果下一个目录项在缓存中不命中，交给SSD查找
          * 
@@ -319,105 +563,113 @@ dentry_handle path_lookup_processor::do_path_lookup(dentry_store_pos *pos_info)
          */
         if (component_dentry.is_empty())
         {
-            /* 
-             * 如果cur_dentry是新建的，则要把全部元数据写回SSD后再下发path lookup命令
-             * 否则，cur_dentry在SSD上还不存在，SSD将访问错误的NAT表和文件数据
-             */
-            if (cur_dentry->is_newly_created())
-            {
-                write_back_helper wb_helper(fs_manager);
-                wb_helper.write_meta_back_sync();
-                replace_protect_manager *rp_manager = fs_manager->get_replace_protect_manager();
-                rp_manager->wait_all_journal_applied_in_SSD();
-                assert(cur_dentry->is_newly_created() == false);
-            }
-
             HSCFS_LOG(HSCFS_LOG_INFO, "path lookup processor: dentry [%u:%s] miss, prepare searching in SSD.", 
                 cur_dentry->get_ino(), component_name.c_str());
-            ssd_path_lookup_controller ctrlr(fs_manager);
-            ctrlr.construct_task(p_parser, cur_dentry->get_ino(), itr);
-            ctrlr.do_pathlookup();
+            return false;
+        }
 
-            /* ssd_depth和cur_depth用作正确性检查 */
-            uint32_t ssd_depth = ctrlr.get_result_depth();
-            uint32_t cur_depth = 0;
-            uint32_t *p_res_ino = ctrlr.get_first_addr_of_result_inos();
+        /* 下一个目录项在缓存中找到了，置当前目录项为下一个目录项，继续 */
+        HSCFS_LOG(HSCFS_LOG_INFO, "path lookup processor: dentry [%u:%s] is in dentry cache, its inode is %u.",
+            cur_dentry->get_ino(), component_name.c_str(), component_dentry->get_ino());
+        cur_dentry = component_dentry;
+    }
 
-            /* 将ssd查找的结果插入dentry cache，并直接在结果上继续path lookup */
-            for (; itr != end_itr; itr.next(), ++p_res_ino, ++cur_depth)
-            {
-                component_name = itr.get();
+    /* 成功查找到了最后一级目录项 */
+    return true;
+}
 
-                if (component_name == ".")
-                {
-                    assert(*p_res_ino == cur_dentry->get_ino());
-                    continue;
-                }
-                if (component_name == "..")
-                {
-                    assert(*p_res_ino == cur_dentry->get_key().dir_ino);
-                    auto &parent_key = cur_dentry->get_parent_key();
-                    cur_dentry = d_cache->get(parent_key.dir_ino, parent_key.name);
-                    assert(cur_dentry.is_empty() == false);
-                    continue;
-                }
+dentry_handle path_lookup_processor::merge_ssd_result(ssd_path_lookup_controller &ctrlr, 
+    const path_parser &p_parser, path_dentry_iterator itr, dentry_handle cur_dentry, dentry_store_pos *pos_info)
+{
+    dentry_cache *d_cache = fs_manager->get_dentry_cache();
+    const path_dentry_iterator end_itr = p_parser.end();
+    std::string component_name;
+
+    /* ssd_depth和cur_depth用作正确性检查 */
+    uint32_t ssd_depth = ctrlr.get_result_depth();
+    uint32_t cur_depth = 0;
+    uint32_t *p_res_ino = ctrlr.get_first_addr_of_result_inos();
 
-                /* 路径还没有搜索完，遇到了invalid_nid，则代表目标不存在，返回空handle */
-                if (*p_res_ino == INVALID_NID)
+    /* 将ssd查找的结果插入dentry cache，并直接在结果上继续path lookup */
+    for (; itr != end_itr; itr.next(), ++p_res_ino, ++cur_depth)
+    {
+        component_name = itr.get();
+
+        if (component_name == ".")
+        {
+            assert(*p_res_ino == cur_dentry->get_ino());
+            continue;
+        }
+        if (component_name == "..")
+        {
+            assert(*p_res_ino == cur_dentry->get_key().dir_ino);
+            auto &parent_key = cur_dentry->get_parent_key();
+            cur_dentry = d_cache->get(parent_key.dir_ino, parent_key.name);
+            assert(cur_dentry.is_empty() == false);
+            continue;
+        }
+
+        /* 路径还没有搜索完，遇到了invalid_nid，则代表目标不存在，返回空handle */
+        if (*p_res_ino == INVALID_NID)
+        {
+            HSCFS_LOG(HSCFS_LOG_INFO, "path lookup processor: dentry [%u:%s] does not exist.", 
+                cur_dentry->get_ino(), component_name.c_str());
+            
+            /* 如果已经找到了目标的目录，则SSD有可能返回创建目标的位置信息，把它保存到pos_info中 */
+            if (itr.is_last_component(end_itr))
+            {
+                dentry_store_pos ssd_pos_info = ctrlr.get_result_pos();
+                if (ssd_pos_info.is_valid)
                 {
-                    HSCFS_LOG(HSCFS_LOG_INFO, "path lookup processor: dentry [%u:%s] does not exist.", 
-                        cur_dentry->get_ino(), component_name.c_str());
-                    
-                    /* 如果已经找到了目标的目录，则SSD有可能返回创建目标的位置信息，把它保存到pos_info中 */
-                    if (itr.is_last_component(end_itr))
-                    {
-                        dentry_store_pos ssd_pos_info = ctrlr.get_result_pos();
-                        if (ssd_pos_info.is_valid)
-                        {
-                            HSCFS_LOG(HSCFS_LOG_INFO, "path_lookup_processor: target dentry [%s] does not exist, "
-                                "but its parent dentry [%s] exist, the location for creating target returned by SSD:\n"
-                                "block offset: %u, slot offset: %u.",
-                                component_name.c_str(), cur_dentry->get_key().name.c_str(), 
-                                ssd_pos_info.blkno, ssd_pos_info.slotno
-                            );
-                        }
-
-                        if (pos_info)
-                            *pos_info = ssd_pos_info;
-                    }
-
-                    return dentry_handle();
+                    HSCFS_LOG(HSCFS_LOG_INFO, "path_lookup_processor: target dentry [%s] does not exist, "
+                        "but its parent dentry [%s] exist, the location for creating target returned by SSD:\n"
+                        "block offset: %u, slot offset: %u.",
+                        component_name.c_str(), cur_dentry->get_key().name.c_str(), 
+                        ssd_pos_info.blkno, ssd_pos_info.slotno
+                    );
+
+                    /* 查找不命中后通常紧接着创建目标，SSD同时返回了插入位置所在的目录数据块和node，加入缓存 */
+                    ctrlr.cache_parent_dir_pages(cur_dentry->get_ino());
                 }
 
-                HSCFS_LOG(HSCFS_LOG_INFO, "path lookup processor: result of SSD: dentry [%u:%s]'s inode is %u.",
-                    cur_dentry->get_ino(), component_name.c_str(), *p_res_ino);
-                
-                /* 将component加入dentry cache，并置当前缓存项为component */
-                cur_dentry = d_cache->add(cur_dentry->get_ino(), cur_dentry, *p_res_ino, component_name);
+                if (pos_info)
+                    *pos_info = ssd_pos_info;
             }
 
-            assert(cur_depth == ssd_depth);
-
-            /* 在SSD返回的结果上成功完成了path lookup，把位置信息附加到最终的目录项上 */
-            dentry_store_pos ssd_pos_info = ctrlr.get_result_pos();
-            HSCFS_LOG(HSCFS_LOG_INFO, "path lookup processor: target dentry [%s]'s pos info returned by SSD:\n"
-                "block offset: %u, slot offset: %u.",
-                cur_dentry->get_key().name.c_str(), ssd_pos_info.blkno, ssd_pos_info.slotno
-            );
-            if (pos_info)
-                *pos_info = ssd_pos_info;
-            cur_dentry->set_pos_info(ssd_pos_info);
-            
-            return cur_dentry;
+            return dentry_handle();
         }
 
-        /* 下一个目录项在缓存中找到了，置当前目录项为下一个目录项，继续 */
-        HSCFS_LOG(HSCFS_LOG_INFO, "path lookup processor: dentry [%u:%s] is in dentry cache, its inode is %u.",
-            cur_dentry->get_ino(), component_name.c_str(), component_dentry->get_ino());
+        HSCFS_LOG(HSCFS_LOG_INFO, "path lookup processor: result of SSD: dentry [%u:%s]'s inode is %u.",
+            cur_dentry->get_ino(), component_name.c_str(), *p_res_ino);
+        
+        /* 
+         * 将component加入dentry cache，并置当前缓存项为component
+         * 批量查找时，前面的路径合并结果时可能已经加入了该目录项，直接使用它
+         */
+        dentry_handle component_dentry = d_cache->get(cur_dentry->get_ino(), component_name);
+        if (component_dentry.is_empty())
+            component_dentry = d_cache->add(cur_dentry->get_ino(), cur_dentry, *p_res_ino, component_name);
+        else
+            assert(component_dentry->get_ino() == *p_res_ino);
         cur_dentry = component_dentry;
     }
 
-    /* 成功查找到了最后一级目录项，返回 */
+    assert(cur_depth == ssd_depth);
+
+    /* 在SSD返回的结果上成功完成了path lookup，把位置信息附加到最终的目录项上 */
+    dentry_store_pos ssd_pos_info = ctrlr.get_result_pos();
+    HSCFS_LOG(HSCFS_LOG_INFO, "path lookup processor: target dentry [%s]'s pos info returned by SSD:\n"
+        "block offset: %u, slot offset: %u.",
+        cur_dentry->get_key().name.c_str(), ssd_pos_info.blkno, ssd_pos_info.slotno
+    );
+    if (pos_info)
+        *pos_info = ssd_pos_info;
+    cur_dentry->set_pos_info(ssd_pos_info);
+
+    /* 目标目录项的增删通常紧随查找，将SSD返回的目录数据块和node直接加入缓存 */
+    if (component_name != "." && component_name != "..")
+        ctrlr.cache_parent_dir_pages(cur_dentry->get_key().dir_ino);
+    
     return cur_dentry;
 }
 
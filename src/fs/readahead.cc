@@ -0,0 +1,53 @@
+#include "fs/readahead.hh"
+#include <algorithm>
+
+namespace hscfs {
+
+readahead_window::readahead_window(uint32_t max_window)
+{
+    this->max_window = std::max(max_window, 1U);
+    window = 0;
+    pre_end_blkno = 0;
+    ra_end_blkno = 0;
+    miss_since_ra = 0;
+}
+
+bool readahead_window::update(uint32_t start_blkno, uint32_t end_blkno, uint32_t miss_num, 
+    uint32_t &ra_start, uint32_t &ra_num)
+{
+    bool is_seq = start_blkno == pre_end_blkno || (pre_end_blkno != 0 && start_blkno + 1 == pre_end_blkno);
+    pre_end_blkno = end_blkno;
+
+    /* 非顺序读，停止预读 */
+    if (!is_seq)
+    {
+        window = 0;
+        miss_since_ra = 0;
+        ra_end_blkno = end_blkno;
+        return false;
+    }
+
+    miss_since_ra += miss_num;
+
+    /* 已预读且尚未读到的page还不少于窗口的一半，暂不发起预读 */
+    if (window != 0 && ra_end_blkno > end_blkno && ra_end_blkno - end_blkno >= window / 2)
+        return false;
+
+    /* 根据上一轮预读的命中情况调整窗口 */
+    if (window == 0)
+        window = std::min(init_window, max_window);
+    else if (miss_since_ra != 0)
+        window = std::max(window / 2, 1U);
+    else
+        window = std::min(window * 2, max_window);
+    miss_since_ra = 0;
+
+    ra_start = std::max(ra_end_blkno, end_blkno);
+    ra_end_blkno = std::max(ra_end_blkno, end_blkno + window);
+    if (ra_start >= ra_end_blkno)
+        return false;
+    ra_num = ra_end_blkno - ra_start;
+    return true;
+}
+
+}  // namespace hscfs
@@ -16,11 +16,24 @@ transaction_replace_protect_record::transaction_replace_protect_record(
     std::vector<dentry_handle> &&dirty_dentrys_, 
     std::unique_ptr<journal_container> &&tx_journal_, 
     std::vector<uint32_t> &&uncommit_node_segs_, 
-    std::vector<uint32_t> &&uncommit_data_segs_)
+    std::vector<uint32_t> &&uncommit_data_segs_,
+    std::vector<uint32_t> &&prefree_node_segs_, 
+    std::vector<uint32_t> &&prefree_data_segs_)
     : dirty_nodes(std::move(dirty_nodes_)), dirty_dentrys(std::move(dirty_dentrys_)), tx_journal(std::move(tx_journal_)), 
-    uncommit_node_segs(std::move(uncommit_node_segs_)), uncommit_data_segs(std::move(uncommit_data_segs_))
+    uncommit_node_segs(std::move(uncommit_node_segs_)), uncommit_data_segs(std::move(uncommit_data_segs_)),
+    prefree_node_segs(std::move(prefree_node_segs_)), prefree_data_segs(std::move(prefree_data_segs_))
 {
     this->tx_id = tx_id;
+
+    for (auto &nat_entry : tx_journal->get_NAT_journal())
+    {
+        if (nat_entry.newValue.ino != 0)
+            affected_inos.insert(nat_entry.newValue.ino);
+    }
+    for (uint32_t ino : tx_journal->get_dependent_inos())
+        affected_inos.insert(ino);
+    for (auto &handle : dirty_nodes)
+        affected_inos.insert(handle->get_node_block_ptr()->footer.ino);
 }
 
 replace_protect_manager::replace_protect_manager(file_system_manager *fs_manager)
@@ -43,8 +56,17 @@ void replace_protect_manager::notify_cplt_tx(uint64_t cplt_tx_id)
         assert(protect_processing_tx.count(tx_id) == 0);
         protect_processing_tx.insert(tx_id);
 
+        for (uint32_t ino : first_record.affected_inos)
+        {
+            auto it = pending_inos.find(ino);
+            assert(it != pending_inos.end());
+            if (--it->second == 0)
+                pending_inos.erase(it);
+        }
+
         is_trp_list_empty = trp_list.empty();
     }
+    tx_applied_cond.notify_all();
     
     /* 目前，日志管理层一定是按照提交顺序进行通知 */
     assert(first_record.tx_id == cplt_tx_id);
@@ -61,6 +83,8 @@ void replace_protect_manager::notify_cplt_tx(uint64_t cplt_tx_id)
 void replace_protect_manager::add_tx(transaction_replace_protect_record &&trp)
 {
     std::lock_guard<std::mutex> lg(lock);
+    for (uint32_t ino : trp.affected_inos)
+        ++pending_inos[ino];
     trp_list.emplace_back(std::move(trp));
 }
 
@@ -87,6 +111,20 @@ void replace_protect_manager::wait_all_journal_applied_in_SSD()
     });
 }
 
+void replace_protect_manager::wait_ino_journal_applied_in_SSD(uint32_t ino)
+{
+    std::unique_lock<std::mutex> lg(lock);
+    tx_applied_cond.wait(lg, [&]() {
+        return pending_inos.count(ino) == 0;
+    });
+}
+
+bool replace_protect_manager::is_ino_journal_pending(uint32_t ino)
+{
+    std::lock_guard<std::mutex> lg(lock);
+    return pending_inos.count(ino) != 0;
+}
+
 void replace_protect_manager::mark_protect_process_cplt(uint64_t tx_id)
 {
     bool is_protect_processing_tx_empty;
@@ -141,14 +179,20 @@ void replace_protect_task::operator()()
     for (auto segid : cplt_tx->uncommit_node_segs)
     {
         sp_manager->add_to_node_segment_list(segid);
-        HSCFS_LOG(HSCFS_LOG_DEBUG, "add segid %u to node segment list.");
+        HSCFS_LOG(HSCFS_LOG_DEBUG, "add segid %u to node segment list.", segid);
     }
     for (auto segid : cplt_tx->uncommit_data_segs)
     {
         sp_manager->add_to_data_segment_list(segid);
-        HSCFS_LOG(HSCFS_LOG_DEBUG, "add segid %u to data segment list.");
+        HSCFS_LOG(HSCFS_LOG_DEBUG, "add segid %u to data segment list.", segid);
     }
 
+    /* 此时SSD侧已不再使用已清理segment中的数据，将它们释放 */
+    for (auto segid : cplt_tx->prefree_node_segs)
+        sp_manager->free_node_segment(segid);
+    for (auto segid : cplt_tx->prefree_data_segs)
+        sp_manager->free_data_segment(segid);
+
     /* 
      * 必须在持有fs_meta_lock时释放cplt_tx，以析构node_block_cache_entry_handle和dentry_handle，
      * 进而增加它们的SSD版本号（析构时将减少引用计数、访问对应缓存管理器，该过程需要加fs_meta_lock锁）
@@ -0,0 +1,450 @@
+#include "fs/segment_cleaner.hh"
+#include "fs/fs_manager.hh"
+#include "fs/fs.h"
+#include "fs/file.hh"
+#include "fs/file_utils.hh"
+#include "fs/server_thread.hh"
+#include "fs/super_manager.hh"
+#include "fs/SIT_utils.hh"
+#include "fs/NAT_utils.hh"
+#include "fs/srmap_utils.hh"
+#include "fs/write_back_helper.hh"
+#include "fs/replace_protect.hh"
+#include "cache/node_block_cache.hh"
+#include "cache/dir_data_block_cache.hh"
+#include "cache/SIT_NAT_cache.hh"
+#include "cache/super_cache.hh"
+#include "communication/memory.h"
+#include "communication/comm_api.h"
+#include "communication/vendor_cmds.h"
+#include "utils/exception_handler.hh"
+#include "utils/hscfs_exceptions.hh"
+#include "utils/dma_buffer_deletor.hh"
+#include "utils/lock_guards.hh"
+#include "utils/hscfs_log.h"
+
+#include <algorithm>
+#include <memory>
+#include <cstring>
+#include <tuple>
+
+namespace hscfs {
+
+segment_cleaner::segment_cleaner(file_system_manager *fs_manager, server_thread *server, const gc_policy &policy)
+{
+    this->fs_manager = fs_manager;
+    this->server = server;
+    this->policy = policy;
+    task_id = server->add_periodic_task([this]() { run_background(); }, policy.period);
+}
+
+void segment_cleaner::set_policy(const gc_policy &policy)
+{
+    {
+        std::lock_guard<std::mutex> lg(mtx);
+        this->policy = policy;
+    }
+    server->set_periodic_task_period(task_id, policy.period);
+}
+
+gc_policy segment_cleaner::get_policy()
+{
+    std::lock_guard<std::mutex> lg(mtx);
+    return policy;
+}
+
+gc_stat segment_cleaner::get_stat()
+{
+    std::lock_guard<std::mutex> lg(mtx);
+    return stat;
+}
+
+void segment_cleaner::balance()
+{
+    gc_policy p = get_policy();
+    super_manager *sp_manager = fs_manager->get_super_manager();
+    if (sp_manager->get_free_segment_count_hint() >= p.foreground_free_segs)
+        return;
+
+    {
+        rwlock_guard fs_freeze_lg(fs_manager->get_fs_freeze_lock(), rwlock_guard::lock_type::wrlock);
+        fs_manager->check_state();
+        std::lock_guard<std::mutex> fs_meta_lg(fs_manager->get_fs_meta_lock());
+        try
+        {
+            /* 先回收无有效块的segment，仍然不足时再迁移有效块进行清理 */
+            reclaim_empty_segments();
+            if (sp_manager->get_free_segment_count() + sp_manager->get_prefree_segment_count() <
+                p.foreground_free_segs)
+            {
+                do_clean(p.max_victims_per_run);
+                std::lock_guard<std::mutex> lg(mtx);
+                ++stat.foreground_run_num;
+            }
+            commit_prefree();
+        }
+        catch (const std::exception &e)
+        {
+            exception_handler(fs_manager, e).convert_to_errno(true);
+            throw;
+        }
+    }
+
+    /* 待释放的segment在事务日志被SSD应用后才会释放，不持有锁等待释放完成 */
+    fs_manager->get_replace_protect_manager()->wait_all_protect_task_cplt();
+}
+
+void segment_cleaner::run_background()
+{
+    gc_policy p = get_policy();
+    super_manager *sp_manager = fs_manager->get_super_manager();
+
+    /* 
+     * 前台正在操作文件系统时跳过本轮，不阻塞服务线程
+     * 回收无有效块的segment不涉及文件数据，只需要fs_freeze_lock共享锁
+     */
+    rwlock_t &fs_freeze_lock = fs_manager->get_fs_freeze_lock();
+    if (rwlock_tryrdlock(&fs_freeze_lock) != 0)
+        return;
+    bool need_clean = false;
+    {
+        std::lock_guard<std::mutex> fs_meta_lg(fs_manager->get_fs_meta_lock());
+        try
+        {
+            fs_manager->check_state();
+            reclaim_empty_segments();
+
+            /* 空闲空间不足时立即提交，否则待释放的segment随之后的事务提交 */
+            uint32_t free_segs = sp_manager->get_free_segment_count() + sp_manager->get_prefree_segment_count();
+            if (free_segs < p.background_free_segs)
+            {
+                commit_prefree();
+                need_clean = sp_manager->get_free_segment_count() + sp_manager->get_prefree_segment_count() <
+                    p.background_free_segs;
+            }
+        }
+        catch (const std::exception &e)
+        {
+            HSCFS_LOG(HSCFS_LOG_WARNING, "background segment reclaiming failed.");
+            exception_handler(fs_manager, e).convert_to_errno(true);
+        }
+    }
+    rwlock_unlock(&fs_freeze_lock);
+    if (!need_clean || rwlock_trywrlock(&fs_freeze_lock) != 0)
+        return;
+
+    {
+        std::lock_guard<std::mutex> fs_meta_lg(fs_manager->get_fs_meta_lock());
+        try
+        {
+            fs_manager->check_state();
+            do_clean(p.max_victims_per_run);
+            commit_prefree();
+        }
+        catch (const std::exception &e)
+        {
+            HSCFS_LOG(HSCFS_LOG_WARNING, "background segment cleaning failed.");
+            exception_handler(fs_manager, e).convert_to_errno(true);
+        }
+    }
+    rwlock_unlock(&fs_freeze_lock);
+}
+
+uint32_t segment_cleaner::clean(uint32_t max_victims)
+{
+    std::lock_guard<std::mutex> fs_meta_lg(fs_manager->get_fs_meta_lock());
+    uint32_t cleaned = do_clean(max_victims);
+    commit_prefree();
+    return cleaned;
+}
+
+uint32_t segment_cleaner::reclaim_empty_segments()
+{
+    super_manager *sp_manager = fs_manager->get_super_manager();
+    std::vector<uint32_t> segs = sp_manager->get_and_clear_empty_segs();
+    if (segs.empty())
+        return 0;
+
+    /* 
+     * 只回收已在node/data segment链表中的segment
+     * 活跃segment和还未加入链表的segment，在加入链表时若仍无有效块，会被重新记录
+     */
+    std::vector<uint32_t> node_list = sp_manager->get_node_segments();
+    std::vector<uint32_t> data_list = sp_manager->get_data_segments();
+    std::unordered_set<uint32_t> node_segs(node_list.begin(), node_list.end());
+    std::unordered_set<uint32_t> data_segs(data_list.begin(), data_list.end());
+    SIT_operator sit_operator(fs_manager);
+    uint32_t reclaimed = 0;
+    for (uint32_t segid : segs)
+    {
+        if (sp_manager->is_prefree(segid) || SIT_operator::count_valid_blocks(sit_operator.get_sit_entry(segid)) != 0)
+            continue;
+        if (node_segs.count(segid) != 0)
+            sp_manager->add_prefree_node_seg(segid);
+        else if (data_segs.count(segid) != 0)
+            sp_manager->add_prefree_data_seg(segid);
+        else
+            continue;
+        ++reclaimed;
+    }
+
+    if (reclaimed != 0)
+        HSCFS_LOG(HSCFS_LOG_INFO, "segment cleaner: reclaim %u empty segment(s).", reclaimed);
+    std::lock_guard<std::mutex> lg(mtx);
+    stat.reclaimed_num += reclaimed;
+    return reclaimed;
+}
+
+void segment_cleaner::commit_prefree()
+{
+    /* 待释放的segment随一个事务提交，事务日志被SSD应用后释放 */
+    if (fs_manager->get_super_manager()->has_uncommit_prefree())
+        write_back_helper(fs_manager).write_meta_back_sync();
+}
+
+uint32_t segment_cleaner::do_clean(uint32_t max_victims)
+{
+    super_manager *sp_manager = fs_manager->get_super_manager();
+    std::vector<victim_info> victims = select_victims(max_victims);
+    uint32_t cleaned = 0;
+    uint64_t migrated = 0;
+    for (auto &victim : victims)
+    {
+        if (!migrate_segment(victim))
+        {
+            HSCFS_LOG(HSCFS_LOG_WARNING, "segment cleaner: segment [%u] has blocks of unknown owner, skip it.",
+                victim.segid);
+            bad_segs.insert(victim.segid);
+            continue;
+        }
+        if (victim.is_node)
+            sp_manager->add_prefree_node_seg(victim.segid);
+        else
+            sp_manager->add_prefree_data_seg(victim.segid);
+        ++cleaned;
+        migrated += victim.valid_num;
+    }
+
+    HSCFS_LOG(HSCFS_LOG_INFO, "segment cleaner: cleaned %u segment(s), migrated %lu block(s), "
+        "free segment count: %u.", cleaned, migrated, sp_manager->get_free_segment_count());
+    std::lock_guard<std::mutex> lg(mtx);
+    ++stat.run_num;
+    stat.victim_num += cleaned;
+    stat.migrated_blocks += migrated;
+    return cleaned;
+}
+
+/* 写入blk_num个block需要新分配的segment数，free_in_cur为当前活跃segment的剩余block数 */
+static uint32_t segs_needed(uint64_t blk_num, uint32_t free_in_cur)
+{
+    if (blk_num <= free_in_cur)
+        return 0;
+    return (blk_num - free_in_cur + BLOCK_PER_SEGMENT - 1) / BLOCK_PER_SEGMENT;
+}
+
+std::vector<segment_cleaner::victim_info> segment_cleaner::select_victims(uint32_t max_victims)
+{
+    super_manager *sp_manager = fs_manager->get_super_manager();
+    SIT_operator sit_operator(fs_manager);
+
+    /*
+     * cost-benefit: 收益为回收的空闲空间(1 - u)与数据年龄的乘积，代价为读出并写入有效块(1 + u)
+     * 链表头部是最近加入的segment，以segment在链表中的位置作为年龄
+     */
+    std::vector<victim_info> candidates;
+    auto add_candidates = [&](const std::vector<uint32_t> &segs, bool is_node)
+    {
+        for (size_t i = 0; i < segs.size(); ++i)
+        {
+            uint32_t segid = segs[i];
+            if (sp_manager->is_prefree(segid) || bad_segs.count(segid) != 0)
+                continue;
+            uint32_t valid_num = SIT_operator::count_valid_blocks(sit_operator.get_sit_entry(segid));
+            if (valid_num == BLOCK_PER_SEGMENT)
+                continue;
+            double u = static_cast<double>(valid_num) / BLOCK_PER_SEGMENT;
+            double age = i + 1;
+            candidates.push_back({segid, is_node, valid_num, (1 - u) * age / (1 + u)});
+        }
+    };
+    add_candidates(sp_manager->get_node_segments(), true);
+    add_candidates(sp_manager->get_data_segments(), false);
+    std::stable_sort(candidates.begin(), candidates.end(), [](const victim_info &a, const victim_info &b) {
+        return a.score > b.score;
+    });
+
+    /*
+     * 迁移的有效块与清理后回写的脏元数据都从活跃segment分配，所需的新segment不能超过空闲segment数
+     * 空闲segment不足时不会打开新的hot/cold活跃segment，按全部在warm活跃segment上分配估计
+     * 修正data block的映射最多使一个node变脏
+     */
+    uint64_t node_blks = fs_manager->get_node_cache()->get_dirty_num();
+    uint64_t data_blks = fs_manager->get_dir_data_cache()->get_dirty_num();
+    uint32_t free_segs = sp_manager->get_free_segment_count();
+    uint32_t node_free_in_cur = sp_manager->get_cur_node_segment_free_blocks();
+    uint32_t data_free_in_cur = sp_manager->get_cur_data_segment_free_blocks();
+
+    std::vector<victim_info> victims;
+    for (auto &cand : candidates)
+    {
+        if (victims.size() >= max_victims)
+            break;
+        uint64_t new_node_blks = node_blks + cand.valid_num;
+        uint64_t new_data_blks = data_blks + (cand.is_node ? 0 : cand.valid_num);
+        if (segs_needed(new_node_blks, node_free_in_cur) + segs_needed(new_data_blks, data_free_in_cur) > free_segs)
+            continue;
+        node_blks = new_node_blks;
+        data_blks = new_data_blks;
+        victims.push_back(cand);
+        HSCFS_LOG(HSCFS_LOG_INFO, "segment cleaner: select %s segment [%u] as victim, valid blocks: %u.",
+            cand.is_node ? "node" : "data", cand.segid, cand.valid_num);
+    }
+    return victims;
+}
+
+bool segment_cleaner::migrate_segment(const victim_info &victim)
+{
+    SIT_operator sit_operator(fs_manager);
+    srmap_utils *srmap_util = fs_manager->get_srmap_util();
+    super_manager *sp_manager = fs_manager->get_super_manager();
+
+    /* 先检查所有有效块的归属，确定可以迁移后再做修改 */
+    hscfs_sit_entry sit_entry = sit_operator.get_sit_entry(victim.segid);
+    uint32_t seg_start_lpa = sit_operator.get_first_lpa_of_segid(victim.segid);
+    std::vector<uint32_t> src_offs;
+    std::vector<std::pair<uint32_t, uint32_t>> owners;
+    for (uint32_t off = 0; off < BLOCK_PER_SEGMENT; ++off)
+    {
+        if (!(sit_entry.valid_map[off / 8] & (1U << (off % 8))))
+            continue;
+        uint32_t lpa = seg_start_lpa + off;
+        std::pair<uint32_t, uint32_t> owner = srmap_util->read_srmap_of_lpa(lpa);
+        bool ok = victim.is_node ? check_node_owner(lpa, owner.first) :
+            check_data_owner(lpa, owner.first, owner.second);
+        if (!ok)
+            return false;
+        src_offs.emplace_back(off);
+        owners.emplace_back(owner);
+    }
+    assert(src_offs.size() == victim.valid_num);
+
+    /* 分配新地址，对每段连续的新地址下发一个migrate命令 */
+    std::vector<uint32_t> dst_lpas;
+    dst_lpas.reserve(src_offs.size());
+    while (dst_lpas.size() < src_offs.size())
+    {
+        uint32_t num = src_offs.size() - dst_lpas.size();
+        std::pair<uint32_t, uint32_t> range = victim.is_node ? sp_manager->reserve_node_lpas(num, log_temp::cold) : 
+            sp_manager->reserve_data_lpas(num, log_temp::cold);
+        for (uint32_t lpa = range.first; lpa < range.second; ++lpa)
+            dst_lpas.emplace_back(lpa);
+    }
+    for (size_t i = 0; i < dst_lpas.size(); )
+    {
+        size_t j = i + 1;
+        while (j < dst_lpas.size() && dst_lpas[j] == dst_lpas[j - 1] + 1)
+            ++j;
+        std::vector<uint32_t> run(src_offs.begin() + i, src_offs.begin() + j);
+        submit_migrate(seg_start_lpa, run, dst_lpas[i]);
+        i = j;
+    }
+
+    /* 修正映射，无效化旧地址 */
+    for (size_t i = 0; i < src_offs.size(); ++i)
+    {
+        uint32_t src = seg_start_lpa + src_offs[i];
+        if (victim.is_node)
+            fix_node_mapping(owners[i].first, src, dst_lpas[i]);
+        else
+            fix_data_mapping(owners[i].first, owners[i].second, src, dst_lpas[i]);
+        sit_operator.invalidate_lpa(src);
+    }
+    return true;
+}
+
+/* 读取nid的NAT表项，nid超出NAT表范围时返回false */
+static bool read_nat_entry(file_system_manager *fs_manager, uint32_t nid, hscfs_nat_entry &entry)
+{
+    uint32_t nat_entry_num = (*fs_manager->get_super_cache())->segment_count_nat * BLOCK_PER_SEGMENT *
+        NAT_ENTRY_PER_BLOCK;
+    if (nid == INVALID_NID || nid >= nat_entry_num)
+        return false;
+    uint32_t nat_lpa, nat_idx;
+    std::tie(nat_lpa, nat_idx) = nat_lpa_mapping(fs_manager).get_nid_pos_in_nat(nid);
+    SIT_NAT_cache_entry_handle nat_handle = fs_manager->get_nat_cache()->get(nat_lpa);
+    entry = nat_handle.get_nat_block_ptr()->entries[nat_idx];
+    return true;
+}
+
+bool segment_cleaner::check_node_owner(uint32_t lpa, uint32_t nid)
+{
+    hscfs_nat_entry entry;
+    if (!read_nat_entry(fs_manager, nid, entry))
+        return false;
+    return entry.ino != 0 && entry.block_addr == lpa;
+}
+
+bool segment_cleaner::check_data_owner(uint32_t lpa, uint32_t ino, uint32_t blkoff)
+{
+    /* ino必须是有效的inode，且blkoff在文件范围内，才能查询file mapping */
+    hscfs_nat_entry entry;
+    if (!read_nat_entry(fs_manager, ino, entry) || entry.ino != ino || entry.block_addr == INVALID_LPA)
+        return false;
+    node_block_cache_entry_handle inode_handle = node_cache_helper(fs_manager).get_node_entry(ino, INVALID_NID);
+    hscfs_node *node = inode_handle->get_node_block_ptr();
+    if (node->footer.ino != ino || node->footer.nid != ino)
+        return false;
+    if (blkoff >= (node->i.i_size + 4095) / 4096)
+        return false;
+    return file_mapping_util(fs_manager).get_addr_of_block(ino, blkoff).lpa == lpa;
+}
+
+void segment_cleaner::fix_node_mapping(uint32_t nid, uint32_t src_lpa, uint32_t dst_lpa)
+{
+    nat_lpa_mapping(fs_manager).set_lpa_of_nid(nid, dst_lpa);
+    fs_manager->get_srmap_util()->write_srmap_of_node(dst_lpa, nid);
+
+    /* 缓存中的node回写时会无效化其记录的lpa，需要改为新地址 */
+    node_block_cache_entry_handle node_handle = fs_manager->get_node_cache()->get(nid);
+    if (!node_handle.is_empty() && node_handle->get_lpa_ref() == src_lpa)
+        node_handle->set_new_lpa(dst_lpa);
+}
+
+void segment_cleaner::fix_data_mapping(uint32_t ino, uint32_t blkoff, uint32_t src_lpa, uint32_t dst_lpa)
+{
+    file_mapping_util(fs_manager).update_block_mapping(ino, blkoff, dst_lpa);
+    fs_manager->get_srmap_util()->write_srmap_of_data(dst_lpa, ino, blkoff);
+
+    /* 修正目录数据块缓存和文件页缓存中记录的地址 */
+    dir_data_block_handle dir_blk = fs_manager->get_dir_data_cache()->get(ino, blkoff);
+    if (!dir_blk.is_empty() && dir_blk->get_lpa_ref() == src_lpa)
+        dir_blk->get_lpa_ref() = dst_lpa;
+    file_handle file = fs_manager->get_file_obj_cache()->get(ino);
+    if (!file.is_empty())
+        file->update_page_lpa(blkoff, src_lpa, dst_lpa);
+}
+
+void segment_cleaner::submit_migrate(uint32_t seg_start_lpa, const std::vector<uint32_t> &src_offs, uint32_t dst_lpa)
+{
+    void *buf = comm_alloc_dma_mem(sizeof(migrate_task));
+    if (buf == nullptr)
+        throw alloc_error("segment cleaner: alloc migrate task memory failed.");
+    std::unique_ptr<migrate_task, dma_buf_deletor> task(static_cast<migrate_task*>(buf));
+
+    /* victim_seg_info的位图中只包含本次迁移的块 */
+    memset(&task->victim_seg_info, 0, sizeof(hscfs_sit_entry));
+    for (uint32_t off : src_offs)
+        task->victim_seg_info.valid_map[off / 8] |= 1U << (off % 8);
+    task->victim_seg_info.vblocks = std::min<uint32_t>(src_offs.size(), SIT_VBLOCKS_MASK);
+    task->migrate_lpa_cnt = src_offs.size();
+    task->migrate_src_lpa = seg_start_lpa;
+    task->migrate_dst_lpa = dst_lpa;
+    HSCFS_LOG(HSCFS_LOG_INFO, "segment cleaner: migrate %zu block(s) of segment at lpa %u to lpa %u.",
+        src_offs.size(), seg_start_lpa, dst_lpa);
+
+    int ret = comm_submit_sync_migrate_request(fs_manager->get_device(), task.get());
+    if (ret != 0)
+        throw io_error("segment cleaner: send migrate task failed.");
+}
+
+}  // namespace hscfs
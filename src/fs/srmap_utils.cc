@@ -44,6 +44,17 @@ void srmap_utils::write_srmap_of_node(uint32_t node_lpa, uint32_t nid)
     dirty_blks.insert(srmap_lpa);
 }
 
+std::pair<uint32_t, uint32_t> srmap_utils::read_srmap_of_lpa(uint32_t lpa)
+{
+    uint32_t srmap_lpa, srmap_idx;
+    std::tie(srmap_lpa, srmap_idx) = get_srmap_pos_of_lpa(lpa);
+    block_buffer &buffer = get_srmap_blk(srmap_lpa);
+    hscfs_summary_block *srmap_blk = reinterpret_cast<hscfs_summary_block*>(buffer.get_ptr());
+    uint32_t nid = srmap_blk->entries[srmap_idx].nid;
+    uint32_t ofs_in_node = srmap_blk->entries[srmap_idx].ofs_in_node;
+    return std::make_pair(nid, ofs_in_node);
+}
+
 void srmap_utils::write_dirty_srmap_sync()
 {
     async_vecio_synchronizer syn(dirty_blks.size());
@@ -73,10 +84,14 @@ std::pair<uint32_t, uint32_t> srmap_utils::get_srmap_pos_of_lpa(uint32_t lpa)
 
 block_buffer &srmap_utils::get_srmap_blk(uint32_t lpa)
 {
-    if (srmap_cache.count(lpa))
-        return srmap_cache[lpa];
-    srmap_cache[lpa].read_from_lpa(fs_manager->get_device(), lpa);
-    return srmap_cache[lpa];
+    auto it = srmap_cache.find(lpa);
+    if (it != srmap_cache.end())
+        return it->second;
+
+    /* 缓存区随后被读入的SRMAP块完整覆盖，不需要清零 */
+    block_buffer buffer(false);
+    buffer.read_from_lpa(fs_manager->get_device(), lpa);
+    return srmap_cache.emplace(lpa, std::move(buffer)).first->second;
 }
 
 } // namespace hscfs
\ No newline at end of file
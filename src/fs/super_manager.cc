@@ -11,6 +11,8 @@
 
 #include <tuple>
 #include <cstddef>
+#include <algorithm>
+#include <stdexcept>
 
 namespace hscfs {
 
@@ -18,6 +20,8 @@ super_manager::super_manager(file_system_manager *fs_manager)
     : super(*fs_manager->get_super_cache())
 {
     this->fs_manager = fs_manager;
+    free_segment_count_hint = super->free_segment_count;
+    temp_log_reserved_segs = 0;
 }
 
 uint32_t super_manager::alloc_nid(uint32_t ino, bool is_inode)
@@ -49,6 +53,7 @@ uint32_t super_manager::alloc_nid(uint32_t ino, bool is_inode)
     super_block_journal_entry super_journal = {.Off = offsetof(hscfs_super_block, next_free_nid), .newVal = nxt_nid};
     cur_journal->append_NAT_journal_entry(nat_journal);
     cur_journal->append_super_block_journal_entry(super_journal);
+    cur_journal->add_dependent_ino(nat_entry.ino);
     nat_handle.add_host_version();
 
     return nid;
@@ -65,6 +70,7 @@ void super_manager::free_nid(uint32_t nid)
     
     /* 将nid插入空闲nid链表 */
     HSCFS_LOG(HSCFS_LOG_INFO, "free nid [%u]. The original free nid head is [%u].", nid, super->next_free_nid);
+    uint32_t ino = nat_entry.ino;
     nat_entry.ino = 0;
     nat_entry.block_addr = super->next_free_nid;
     super->next_free_nid = nid;
@@ -75,19 +81,45 @@ void super_manager::free_nid(uint32_t nid)
     super_block_journal_entry super_journal = {.Off = offsetof(hscfs_super_block, next_free_nid), .newVal = nid};
     cur_journal->append_NAT_journal_entry(nat_journal);
     cur_journal->append_super_block_journal_entry(super_journal);
+    cur_journal->add_dependent_ino(ino);
     nat_handle.add_host_version();
 }
 
-uint32_t super_manager::alloc_node_lpa()
+uint32_t super_manager::alloc_node_lpa(log_temp temp)
 {
-    lpa_alloc_context ctx = create_lpa_alloc_context(lpa_alloc_type::node);
-    return alloc_lpa_inner(ctx);
+    return reserve_lpas(lpa_alloc_type::node, temp, 1).first;
 }
 
-uint32_t super_manager::alloc_data_lpa()
+uint32_t super_manager::alloc_data_lpa(log_temp temp)
 {
-    lpa_alloc_context ctx = create_lpa_alloc_context(lpa_alloc_type::data);
-    return alloc_lpa_inner(ctx);
+    return reserve_lpas(lpa_alloc_type::data, temp, 1).first;
+}
+
+std::pair<uint32_t, uint32_t> super_manager::reserve_node_lpas(uint32_t num, log_temp temp)
+{
+    return reserve_lpas(lpa_alloc_type::node, temp, num);
+}
+
+std::pair<uint32_t, uint32_t> super_manager::reserve_data_lpas(uint32_t num, log_temp temp)
+{
+    return reserve_lpas(lpa_alloc_type::data, temp, num);
+}
+
+std::pair<uint32_t, uint32_t> super_manager::reserve_lpas(lpa_alloc_type type, log_temp temp, uint32_t num)
+{
+    assert(num > 0);
+    if (temp != log_temp::warm)
+    {
+        lpa_alloc_context ctx = create_lpa_alloc_context(type, temp);
+        if (!prepare_temp_log(ctx))
+            temp = log_temp::warm;
+    }
+
+    lpa_alloc_context ctx = create_lpa_alloc_context(type, temp);
+    std::pair<uint32_t, uint32_t> range = alloc_lpa_inner(ctx, num);
+    uint64_t *blks = type == lpa_alloc_type::node ? wa_stat.node_blks : wa_stat.data_blks;
+    blks[static_cast<uint32_t>(temp)] += range.second - range.first;
+    return range;
 }
 
 void super_manager::add_to_node_segment_list(uint32_t segid)
@@ -116,22 +148,155 @@ std::vector<uint32_t> super_manager::get_and_clear_uncommit_data_segs()
     return ret;
 }
 
-lpa_alloc_context super_manager::create_lpa_alloc_context(lpa_alloc_type type)
+uint32_t super_manager::get_free_segment_count()
+{
+    return super->free_segment_count;
+}
+
+uint32_t super_manager::get_cur_node_segment_free_blocks()
+{
+    return BLOCK_PER_SEGMENT - super->current_node_segment_blkoff;
+}
+
+uint32_t super_manager::get_cur_data_segment_free_blocks()
+{
+    return BLOCK_PER_SEGMENT - super->current_data_segment_blkoff;
+}
+
+std::vector<uint32_t> super_manager::get_node_segments()
+{
+    return get_segment_list(super->first_node_segment_id);
+}
+
+std::vector<uint32_t> super_manager::get_data_segments()
+{
+    return get_segment_list(super->first_data_segment_id);
+}
+
+void super_manager::add_prefree_node_seg(uint32_t segid)
+{
+    assert(prefree_segs.count(segid) == 0);
+    prefree_node_segs.emplace_back(segid);
+    prefree_segs.insert(segid);
+    journal_prefree_seg(segid);
+}
+
+void super_manager::add_prefree_data_seg(uint32_t segid)
+{
+    assert(prefree_segs.count(segid) == 0);
+    prefree_data_segs.emplace_back(segid);
+    prefree_segs.insert(segid);
+    journal_prefree_seg(segid);
+}
+
+bool super_manager::is_prefree(uint32_t segid) const
 {
+    return prefree_segs.count(segid) != 0;
+}
+
+std::vector<uint32_t> super_manager::get_and_clear_prefree_node_segs()
+{
+    std::vector<uint32_t> ret;
+    prefree_node_segs.swap(ret);
+    return ret;
+}
+
+std::vector<uint32_t> super_manager::get_and_clear_prefree_data_segs()
+{
+    std::vector<uint32_t> ret;
+    prefree_data_segs.swap(ret);
+    return ret;
+}
+
+void super_manager::note_empty_segment(uint32_t segid)
+{
+    empty_segs.insert(segid);
+}
+
+std::vector<uint32_t> super_manager::get_and_clear_empty_segs()
+{
+    std::vector<uint32_t> ret(empty_segs.begin(), empty_segs.end());
+    empty_segs.clear();
+    return ret;
+}
+
+void super_manager::free_node_segment(uint32_t segid)
+{
+    remove_seg_from_list(segid, super->first_node_segment_id, offsetof(hscfs_super_block, first_node_segment_id));
+    add_seg_to_free_list(segid);
+    prefree_segs.erase(segid);
+}
+
+void super_manager::free_data_segment(uint32_t segid)
+{
+    remove_seg_from_list(segid, super->first_data_segment_id, offsetof(hscfs_super_block, first_data_segment_id));
+    add_seg_to_free_list(segid);
+    prefree_segs.erase(segid);
+}
+
+lpa_alloc_context super_manager::create_lpa_alloc_context(lpa_alloc_type type, log_temp temp)
+{
+    std::vector<uint32_t> &uncommit_segs = type == lpa_alloc_type::node ? uncommit_node_segs : uncommit_data_segs;
+
+    #define LPA_ALLOC_CONTEXT(seg_id, seg_off) \
+        lpa_alloc_context(super->seg_id, offsetof(hscfs_super_block, seg_id), \
+            super->seg_off, offsetof(hscfs_super_block, seg_off), uncommit_segs)
+
     if (type == lpa_alloc_type::node)
     {
-        lpa_alloc_context ctx(super->current_node_segment_id, offsetof(hscfs_super_block, current_node_segment_id), 
-            super->current_node_segment_blkoff, offsetof(hscfs_super_block, current_node_segment_blkoff), 
-            uncommit_node_segs);
-        return ctx;
+        switch (temp)
+        {
+        case log_temp::hot:
+            return LPA_ALLOC_CONTEXT(hot_node_segment_id, hot_node_segment_blkoff);
+        case log_temp::cold:
+            return LPA_ALLOC_CONTEXT(cold_node_segment_id, cold_node_segment_blkoff);
+        default:
+            return LPA_ALLOC_CONTEXT(current_node_segment_id, current_node_segment_blkoff);
+        }
     }
     else
     {
-        lpa_alloc_context ctx(super->current_data_segment_id, offsetof(hscfs_super_block, current_data_segment_id), 
-            super->current_data_segment_blkoff, offsetof(hscfs_super_block, current_data_segment_blkoff), 
-            uncommit_data_segs);
-        return ctx;
+        switch (temp)
+        {
+        case log_temp::hot:
+            return LPA_ALLOC_CONTEXT(hot_data_segment_id, hot_data_segment_blkoff);
+        case log_temp::cold:
+            return LPA_ALLOC_CONTEXT(cold_data_segment_id, cold_data_segment_blkoff);
+        default:
+            return LPA_ALLOC_CONTEXT(current_data_segment_id, current_data_segment_blkoff);
+        }
     }
+
+    #undef LPA_ALLOC_CONTEXT
+}
+
+bool super_manager::prepare_temp_log(lpa_alloc_context &ctx)
+{
+    journal_container *cur_journal = fs_manager->get_cur_journal();
+
+    /* 已满的活跃segment加入未提交列表，并标记为未打开 */
+    if (ctx.cur_seg_off == BLOCK_PER_SEGMENT)
+    {
+        HSCFS_LOG(HSCFS_LOG_INFO, "segment [%u] is fully written, add to uncommit list.", ctx.cur_seg_id);
+        ctx.uncommit_segs.emplace_back(ctx.cur_seg_id);
+        ctx.cur_seg_off = 0;
+        super_block_journal_entry super_journal = {.Off = ctx.seg_off_addr_offset, .newVal = 0};
+        cur_journal->append_super_block_journal_entry(super_journal);
+    }
+
+    if (ctx.cur_seg_off != 0)
+        return true;
+
+    /* 空闲segment留给warm活跃segment和segment清理 */
+    if (super->free_segment_count <= temp_log_reserved_segs)
+        return false;
+
+    /* 打开新的活跃segment，segoff的日志分配lpa后记录 */
+    ctx.cur_seg_id = alloc_segment();
+    super_block_journal_entry super_journal = {.Off = ctx.seg_id_addr_offset, .newVal = ctx.cur_seg_id};
+    cur_journal->append_super_block_journal_entry(super_journal);
+    HSCFS_LOG(HSCFS_LOG_INFO, "open segment [%u] as active segment.", ctx.cur_seg_id);
+    return true;
 }
 
 uint32_t super_manager::alloc_segment()
@@ -154,6 +319,7 @@ uint32_t super_manager::alloc_segment()
     /* 将空闲链表置为下一项 */
     super->first_free_segment_id = nxt_segid;
     --super->free_segment_count;
+    free_segment_count_hint = super->free_segment_count;
 
     /* 记录修改日志 */
     journal_container *cur_journal = fs_manager->get_cur_journal();
@@ -183,9 +349,14 @@ void super_manager::add_seg_to_list(uint32_t segid, uint32_t &list_head_segid, u
     cur_journal->append_super_block_journal_entry(super_journal);
     SIT_journal_entry sit_journal = {.segID = segid, .newValue = sit_entry};
     cur_journal->append_SIT_journal_entry(sit_journal);
+    sit_handle.add_host_version();
+
+    /* segment写满后、加入链表前，其中的block可能已经全部无效 */
+    if (SIT_operator::count_valid_blocks(sit_entry) == 0)
+        note_empty_segment(segid);
 }
 
-uint32_t super_manager::alloc_lpa_inner(lpa_alloc_context &ctx)
+std::pair<uint32_t, uint32_t> super_manager::alloc_lpa_inner(lpa_alloc_context &ctx, uint32_t num)
 {
     journal_container *cur_journal = fs_manager->get_cur_journal();
 
@@ -204,21 +375,123 @@ uint32_t super_manager::alloc_lpa_inner(lpa_alloc_context &ctx)
         cur_journal->append_super_block_journal_entry(super_journal);
     }
 
-    /* 计算分配出去的lpa */
+    /* 计算分配出去的lpa范围 */
     SIT_operator sit_operator(fs_manager);
+    uint32_t cnt = std::min(num, BLOCK_PER_SEGMENT - ctx.cur_seg_off);
     uint32_t lpa = sit_operator.get_first_lpa_of_segid(ctx.cur_seg_id) + ctx.cur_seg_off;
-    HSCFS_LOG(HSCFS_LOG_INFO, "alloc lpa [%u] in segment [%u], segment block offset [%u].", lpa, ctx.cur_seg_id, 
-        ctx.cur_seg_off);
-    ++ctx.cur_seg_off;
+    HSCFS_LOG(HSCFS_LOG_INFO, "alloc lpa [%u, %u) in segment [%u], segment block offset [%u].", lpa, lpa + cnt, 
+        ctx.cur_seg_id, ctx.cur_seg_off);
+    ctx.cur_seg_off += cnt;
 
     /* 记录活跃segment分配位置的修改日志 */
     super_block_journal_entry super_journal = {.Off = ctx.seg_off_addr_offset, .newVal = ctx.cur_seg_off};
     cur_journal->append_super_block_journal_entry(super_journal);
 
-    /* 在SIT表中标记该块有效 */
-    sit_operator.validate_lpa(lpa);
+    /* 在SIT表中标记这些块有效 */
+    sit_operator.validate_lpa_range(lpa, cnt);
+
+    return std::make_pair(lpa, lpa + cnt);
+}
+
+void super_manager::journal_prefree_seg(uint32_t segid)
+{
+    /* 记录segment当前的SIT表项，保证当前日志不为空，待释放的segment总能随一个事务提交 */
+    uint32_t sit_lpa, sit_off;
+    std::tie(sit_lpa, sit_off) = SIT_operator(fs_manager).get_segid_pos_in_sit(segid);
+    SIT_NAT_cache_entry_handle sit_handle = fs_manager->get_sit_cache()->get(sit_lpa);
+    SIT_journal_entry sit_journal = {.segID = segid, .newValue = sit_handle.get_sit_block_ptr()->entries[sit_off]};
+    fs_manager->get_cur_journal()->append_SIT_journal_entry(sit_journal);
+    sit_handle.add_host_version();
+}
+
+std::vector<uint32_t> super_manager::get_segment_list(uint32_t list_head_segid)
+{
+    /* 
+     * 空链表的表头与链表尾的next字段均为INVALID_SEGID
+     * 最多遍历segment_count项，防止链表损坏时死循环
+     */
+    std::vector<uint32_t> ret;
+    uint32_t seg_cnt = super->segment_count;
+    SIT_operator sit_operator(fs_manager);
+    for (uint32_t segid = list_head_segid; segid != INVALID_SEGID && segid < seg_cnt && ret.size() < seg_cnt; )
+    {
+        ret.emplace_back(segid);
+        hscfs_sit_entry sit_entry = sit_operator.get_sit_entry(segid);
+        segid = get_next_seg_in_list(sit_entry);
+    }
+    return ret;
+}
+
+uint32_t super_manager::get_next_seg_in_list(const hscfs_sit_entry &sit_entry)
+{
+    /* 链表尾的next字段为INVALID_SEGID(segment 0不属于主区域) */
+    return GET_NEXT_SEG(&sit_entry);
+}
+
+void super_manager::remove_seg_from_list(uint32_t segid, uint32_t &list_head_segid, uint32_t list_head_addr_off)
+{
+    SIT_operator sit_operator(fs_manager);
+    journal_container *cur_journal = fs_manager->get_cur_journal();
+
+    hscfs_sit_entry sit_entry = sit_operator.get_sit_entry(segid);
+    uint32_t nxt_segid = get_next_seg_in_list(sit_entry);
+
+    /* segid是表头，修改super block中的表头 */
+    if (list_head_segid == segid)
+    {
+        list_head_segid = nxt_segid;
+        super_block_journal_entry super_journal = {.Off = list_head_addr_off, .newVal = list_head_segid};
+        cur_journal->append_super_block_journal_entry(super_journal);
+        HSCFS_LOG(HSCFS_LOG_INFO, "remove segment [%u] from list head, new head is [%u].", segid, list_head_segid);
+        return;
+    }
+
+    /* 否则找到segid的前驱，使其指向segid的后继 */
+    std::vector<uint32_t> list = get_segment_list(list_head_segid);
+    auto it = std::find(list.begin(), list.end(), segid);
+    if (it == list.end())
+        throw std::logic_error("super manager: segment to remove is not in the list.");
+    assert(it != list.begin());
+    uint32_t prev_segid = *(it - 1);
+
+    uint32_t sit_lpa, sit_off;
+    std::tie(sit_lpa, sit_off) = sit_operator.get_segid_pos_in_sit(prev_segid);
+    SIT_NAT_cache_entry_handle sit_handle = fs_manager->get_sit_cache()->get(sit_lpa);
+    hscfs_sit_entry &prev_entry = sit_handle.get_sit_block_ptr()->entries[sit_off];
+    SET_NEXT_SEG(&prev_entry, nxt_segid);
+    SIT_journal_entry sit_journal = {.segID = prev_segid, .newValue = prev_entry};
+    cur_journal->append_SIT_journal_entry(sit_journal);
+    sit_handle.add_host_version();
+    HSCFS_LOG(HSCFS_LOG_INFO, "remove segment [%u] from list, the previous segment is [%u].", segid, prev_segid);
+}
+
+void super_manager::add_seg_to_free_list(uint32_t segid)
+{
+    uint32_t sit_lpa, sit_off;
+    std::tie(sit_lpa, sit_off) = SIT_operator(fs_manager).get_segid_pos_in_sit(segid);
+    SIT_NAT_cache_entry_handle sit_handle = fs_manager->get_sit_cache()->get(sit_lpa);
+    hscfs_sit_entry &sit_entry = sit_handle.get_sit_block_ptr()->entries[sit_off];
+    assert(SIT_operator::count_valid_blocks(sit_entry) == 0);
+
+    /* 空闲segment的有效块计数为0，next指向当前空闲链表头 */
+    sit_entry.vblocks = 0;
+    SET_NEXT_SEG(&sit_entry, super->first_free_segment_id);
+    super->first_free_segment_id = segid;
+    ++super->free_segment_count;
+    free_segment_count_hint = super->free_segment_count;
+    HSCFS_LOG(HSCFS_LOG_INFO, "free segment [%u], free segment count is %u.", segid, super->free_segment_count);
 
-    return lpa;
+    /* 记录修改日志 */
+    journal_container *cur_journal = fs_manager->get_cur_journal();
+    SIT_journal_entry sit_journal = {.segID = segid, .newValue = sit_entry};
+    cur_journal->append_SIT_journal_entry(sit_journal);
+    sit_handle.add_host_version();
+    super_block_journal_entry super_journal = {.Off = offsetof(hscfs_super_block, first_free_segment_id), 
+        .newVal = segid};
+    cur_journal->append_super_block_journal_entry(super_journal);
+    super_journal.Off = offsetof(hscfs_super_block, free_segment_count);
+    super_journal.newVal = super->free_segment_count;
+    cur_journal->append_super_block_journal_entry(super_journal);
 }
 
 } // namespace hscfs
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "cache/block_buffer.hh"
 #include "cache/node_block_cache.hh"
 #include "cache/dir_data_block_cache.hh"
+#include "cache/dentry_cache.hh"
 #include "fs/write_back_helper.hh"
 #include "fs/fs_manager.hh"
 #include "fs/SIT_utils.hh"
@@ -9,12 +10,16 @@
 #include "fs/file_utils.hh"
 #include "fs/super_manager.hh"
 #include "fs/fs.h"
-#include "fs/super_manager.hh"
 #include "fs/replace_protect.hh"
 #include "journal/journal_container.hh"
 #include "journal/journal_process_env.hh"
 #include "utils/io_utils.hh"
 #include "utils/hscfs_log.h"
+#include "utils/hscfs_exceptions.hh"
+
+#include <tuple>
+#include <vector>
+#include <memory>
 
 namespace hscfs {
 
@@ -23,27 +28,145 @@ write_back_helper::write_back_helper(file_system_manager *fs_manager)
 {
     this->fs_manager = fs_manager;
     this->super = fs_manager->get_super_manager();
+    pending_start_lpa = INVALID_LPA;
+}
+
+write_back_helper::~write_back_helper()
+{
+    /* 只在回写出现异常时会有未使用的预留lpa，将它们无效化，由segment清理回收 */
+    try
+    {
+        for (auto &type_streams : streams)
+        {
+            for (auto &stream : type_streams)
+            {
+                for (; stream.next_lpa != stream.end_lpa; ++stream.next_lpa)
+                    sit_operator.invalidate_lpa(stream.next_lpa);
+            }
+        }
+    }
+    catch (const std::exception &e)
+    {
+        HSCFS_LOG(HSCFS_LOG_WARNING, "write back helper: invalidate reserved lpa failed: %s", e.what());
+    }
+}
+
+void write_back_helper::plan_write_back(block_type type, log_temp temp, uint32_t num)
+{
+    get_stream(type, temp).planned += num;
+}
+
+uint32_t write_back_helper::alloc_lpa(block_type type, log_temp temp)
+{
+    lpa_stream &stream = get_stream(type, temp);
+    if (stream.next_lpa == stream.end_lpa && stream.planned > 0)
+    {
+        std::tie(stream.next_lpa, stream.end_lpa) = type == block_type::data ? 
+            super->reserve_data_lpas(stream.planned, temp) : super->reserve_node_lpas(stream.planned, temp);
+        stream.planned -= stream.end_lpa - stream.next_lpa;
+    }
+    if (stream.next_lpa != stream.end_lpa)
+        return stream.next_lpa++;
+
+    return type == block_type::data ? super->alloc_data_lpa(temp) : super->alloc_node_lpa(temp);
 }
 
-uint32_t write_back_helper::do_write_back_async(block_buffer &buffer, uint32_t &lpa, block_type type,
+uint32_t write_back_helper::do_write_back_async(block_buffer &buffer, uint32_t &lpa, block_type type, log_temp temp,
                                                 comm_async_cb_func cb_func, void *cb_arg)
 {
-    uint32_t new_lpa;
-    if (type == block_type::data)
-        new_lpa = super->alloc_data_lpa();
-    else
-        new_lpa = super->alloc_node_lpa();
+    uint32_t new_lpa = alloc_lpa(type, temp);
     
     if (lpa != INVALID_LPA)
         sit_operator.invalidate_lpa(lpa);
     
     lpa = new_lpa;
-    buffer.write_to_lpa_async(fs_manager->get_device(), lpa, cb_func, cb_arg);
+    if (!pending.empty() && (new_lpa != pending_start_lpa + pending.size() || pending.size() == max_blocks_per_write))
+        submit_pending_writes();
+    if (pending.empty())
+        pending_start_lpa = new_lpa;
+    pending.push_back({buffer.get_ptr(), cb_func, cb_arg});
 
     return lpa;
 }
 
+/* 合并的写命令，命令完成时依次调用每个block的回调 */
+struct coalesced_write
+{
+    std::vector<std::pair<comm_async_cb_func, void*>> callbacks;
+
+    static void callback(comm_cmd_result res, void *arg)
+    {
+        std::unique_ptr<coalesced_write> cw(static_cast<coalesced_write*>(arg));
+        for (auto &cb : cw->callbacks)
+            cb.first(res, cb.second);
+    }
+};
+
+void write_back_helper::submit_pending_writes()
+{
+    if (pending.empty())
+        return;
+    std::vector<pending_write> blks;
+    blks.swap(pending);
+    comm_dev *dev = fs_manager->get_device();
+
+    /* 单个block直接从其缓存区写入 */
+    if (blks.size() == 1)
+    {
+        int ret = comm_submit_async_rw_request(dev, blks[0].buf, LPA_TO_LBA(pending_start_lpa), LBA_PER_LPA, 
+            blks[0].cb_func, blks[0].cb_arg, COMM_IO_WRITE);
+        if (ret != 0)
+            throw io_error("async write lpa failed.");
+        return;
+    }
+
+    /* 各block的缓存区作为一个向量写命令的SGL，不需要拷贝 */
+    std::unique_ptr<coalesced_write> cw = std::make_unique<coalesced_write>();
+    std::vector<struct iovec> iov(blks.size());
+    cw->callbacks.reserve(blks.size());
+    for (size_t i = 0; i < blks.size(); ++i)
+    {
+        iov[i].iov_base = blks[i].buf;
+        iov[i].iov_len = 4096;
+        cw->callbacks.emplace_back(blks[i].cb_func, blks[i].cb_arg);
+    }
+    HSCFS_LOG(HSCFS_LOG_INFO, "write back %zu blocks to lpa [%u, %lu) in one command.", blks.size(), 
+        pending_start_lpa, pending_start_lpa + blks.size());
+
+    /* 命令完成(可能在提交返回前)时由回调释放cw */
+    int ret = comm_submit_async_rwv_request(dev, iov.data(), static_cast<int>(iov.size()), 
+        LPA_TO_LBA(pending_start_lpa), blks.size() * LBA_PER_LPA, coalesced_write::callback, cw.get(), COMM_IO_WRITE);
+    if (ret != 0)
+        throw io_error("async write coalesced lpa failed.");
+    cw.release();
+}
+
+log_temp write_back_helper::get_node_temp(const hscfs_node *node)
+{
+    if (node->footer.ino == node->footer.nid)
+        return node->i.i_type == HSCFS_FT_DIR ? log_temp::hot : log_temp::warm;
+    return file_mapping_util::is_indirect_node_offset(node->footer.offset) ? log_temp::cold : log_temp::warm;
+}
+
+log_temp write_back_helper::get_file_data_temp(write_back_source src)
+{
+    return src == write_back_source::background ? log_temp::cold : log_temp::warm;
+}
+
 void write_back_helper::write_meta_back_sync()
+{
+    do_write_meta_back_sync(nullptr);
+}
+
+void write_back_helper::write_files_meta_back_sync(const std::unordered_set<uint32_t> &inos)
+{
+    /* 当前日志需要整体提交(SIT、super block日志项是全局的)，所以依赖当前日志的文件的元数据也需要一起回写 */
+    std::unordered_set<uint32_t> all_inos = fs_manager->get_cur_journal()->get_dependent_inos();
+    all_inos.insert(inos.begin(), inos.end());
+    do_write_meta_back_sync(&all_inos);
+}
+
+void write_back_helper::do_write_meta_back_sync(const std::unordered_set<uint32_t> *inos)
 {
     /* 注意回写顺序：dir data block -> node block -> 提交日志，前一阶段的回写可能会增加下一阶段中的脏数据 */
     srmap_utils *srmap_util = fs_manager->get_srmap_util();
@@ -51,8 +174,9 @@ void write_back_helper::write_meta_back_sync()
     file_mapping_util fm_util(fs_manager);
 
     /* 回写dirty dir data block */
-    std::unordered_map<uint32_t, std::vector<dir_data_block_handle>> dirty_dir_blks = fs_manager->get_dir_data_cache()
-        ->get_and_clear_dirty_blks();
+    dir_data_block_cache *dir_data_cache = fs_manager->get_dir_data_cache();
+    std::unordered_map<uint32_t, std::vector<dir_data_block_handle>> dirty_dir_blks = inos == nullptr ? 
+        dir_data_cache->get_and_clear_dirty_blks() : dir_data_cache->get_and_clear_dirty_blks(*inos);
     uint64_t dirty_dir_blks_num = 0;
     for (auto &entry : dirty_dir_blks)
     {
@@ -60,6 +184,7 @@ void write_back_helper::write_meta_back_sync()
         assert(siz > 0);
         dirty_dir_blks_num += siz;
     }
+    plan_write_back(block_type::data, log_temp::hot, dirty_dir_blks_num);
     async_vecio_synchronizer syn1(dirty_dir_blks_num);
     for (auto &entry : dirty_dir_blks)
     {
@@ -73,7 +198,7 @@ void write_back_helper::write_meta_back_sync()
 
             /* 将data block异步写入SSD */
             uint32_t new_lpa = do_write_back_async(blk_handle->get_block_buffer(), blk_handle->get_lpa_ref(), 
-                block_type::data, async_vecio_synchronizer::generic_callback, &syn1);
+                block_type::data, log_temp::hot, async_vecio_synchronizer::generic_callback, &syn1);
             
             /* 更新file mapping */
             block_addr_info addr = fm_util.update_block_mapping(dir_ino, blkoff, new_lpa);
@@ -83,9 +208,21 @@ void write_back_helper::write_meta_back_sync()
         }
     }
 
+    submit_pending_writes();
+
     /* 回写dirty node */
-    std::list<node_block_cache_entry_handle> dirty_nodes = fs_manager->get_node_cache()->get_and_clear_dirty_list();
+    node_block_cache *node_cache = fs_manager->get_node_cache();
+    std::list<node_block_cache_entry_handle> dirty_nodes = inos == nullptr ? 
+        node_cache->get_and_clear_dirty_list() : node_cache->get_and_clear_dirty_list(*inos);
+    std::vector<log_temp> node_temps;
+    node_temps.reserve(dirty_nodes.size());
+    for (auto &node_handle : dirty_nodes)
+    {
+        node_temps.emplace_back(get_node_temp(node_handle->get_node_block_ptr()));
+        plan_write_back(block_type::node, node_temps.back(), 1);
+    }
     async_vecio_synchronizer syn2(dirty_nodes.size());
+    size_t node_idx = 0;
     for (auto &node_handle : dirty_nodes)
     {
         uint32_t nid = node_handle->get_nid();
@@ -93,7 +230,7 @@ void write_back_helper::write_meta_back_sync()
 
         /* 将node buffer异步写入SSD */
         uint32_t new_lpa = do_write_back_async(node_handle->get_node_buffer(), node_handle->get_lpa_ref(), 
-            block_type::node, async_vecio_synchronizer::generic_callback, &syn2); 
+            block_type::node, node_temps[node_idx++], async_vecio_synchronizer::generic_callback, &syn2); 
         
         /* 更新NAT表 */
         nat_map.set_lpa_of_nid(nid, new_lpa);
@@ -102,6 +239,8 @@ void write_back_helper::write_meta_back_sync()
         srmap_util->write_srmap_of_node(new_lpa, nid);
     }
 
+    submit_pending_writes();
+
     /* 回写SRMAP表并清空SRMAP缓存 */
     srmap_util->write_dirty_srmap_sync();
     srmap_util->clear_cache();
@@ -120,14 +259,19 @@ void write_back_helper::write_meta_back_sync()
         cur_journal->set_tx_id(tx_id);
 
         /* 构造淘汰保护信息并将其交给系统维护 */
-        std::vector<dentry_handle> dirty_dentrys = fs_manager->get_dentry_cache()->get_and_clear_dirty_list();
+        dentry_cache *d_cache = fs_manager->get_dentry_cache();
+        std::vector<dentry_handle> dirty_dentrys = inos == nullptr ? 
+            d_cache->get_and_clear_dirty_list() : d_cache->get_and_clear_dirty_list(*inos);
         super_manager *sp_manager = fs_manager->get_super_manager();
         std::vector<uint32_t> uncommit_node_segs = sp_manager->get_and_clear_uncommit_node_segs();
         std::vector<uint32_t> uncommit_data_segs = sp_manager->get_and_clear_uncommit_data_segs();
+        std::vector<uint32_t> prefree_node_segs = sp_manager->get_and_clear_prefree_node_segs();
+        std::vector<uint32_t> prefree_data_segs = sp_manager->get_and_clear_prefree_data_segs();
         journal_container *rawp_cur_journal = cur_journal.get();  /* 保留raw pointer便于接下来提交日志 */
 
         transaction_replace_protect_record rp_record(tx_id, std::move(dirty_nodes), std::move(dirty_dentrys), std::move(cur_journal), 
-            std::move(uncommit_node_segs), std::move(uncommit_data_segs));
+            std::move(uncommit_node_segs), std::move(uncommit_data_segs), 
+            std::move(prefree_node_segs), std::move(prefree_data_segs));
         replace_protect_manager *rp_manager = fs_manager->get_replace_protect_manager();
         rp_manager->add_tx(std::move(rp_record));
 
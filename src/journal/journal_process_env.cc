@@ -22,11 +22,41 @@ void journal_process_env::commit_journal(journal_container *journal)
         std::lock_guard<std::mutex> lg(mtx);
         need_notify = commit_queue.empty();
         commit_queue.push_back(journal);
+        committed_tx_end = journal->get_tx_id() + 1;
     }
     if (need_notify)
         cond.notify_all();
 }
 
+uint64_t journal_process_env::get_committed_tx_end()
+{
+    std::lock_guard<std::mutex> lg(mtx);
+    return committed_tx_end;
+}
+
+uint64_t journal_process_env::get_persisted_tx_end()
+{
+    std::lock_guard<std::mutex> lg(mtx);
+    return persisted_tx_end;
+}
+
+void journal_process_env::wait_tx_persisted(uint64_t tx_end)
+{
+    std::unique_lock<std::mutex> lg(mtx);
+    persist_cond.wait(lg, [this, tx_end]() {
+        return persisted_tx_end >= tx_end;
+    });
+}
+
+void journal_process_env::notify_tx_persisted(uint64_t tx_id)
+{
+    {
+        std::lock_guard<std::mutex> lg(mtx);
+        persisted_tx_end = tx_id + 1;
+    }
+    persist_cond.notify_all();
+}
+
 void journal_process_env::init(comm_dev *dev, uint64_t journal_start_lpa, 
     uint64_t journal_end_lpa, uint64_t journal_fifo_pos)
 {
@@ -115,31 +115,38 @@ void journal_processor::fetch_new_journal()
 
 void journal_processor::process_pending_journal()
 {
-    if (cur_journal == nullptr)
+    /* 
+     * 连续写入所有待处理的日志，直到SSD日志区域空间不足，不必每写一个日志就等待一次轮询定时器
+     * 每个日志写入后立即通知提交者，使其fsync能尽快返回
+     */
+    while (true)
     {
-        if (!pending_journal_list.empty())
+        if (cur_journal == nullptr)
         {
-            cur_journal = pending_journal_list.front();
-            pending_journal_list.pop_front();
-            cur_proc_state = journal_process_state::NEWLY_FETCHED;
+            if (!pending_journal_list.empty())
+            {
+                cur_journal = pending_journal_list.front();
+                pending_journal_list.pop_front();
+                cur_proc_state = journal_process_state::NEWLY_FETCHED;
+            }
+            else
+                return;
         }
-        else
-            return;
-    }
 
-    switch (cur_proc_state)
-    {
-    case journal_process_state::NEWLY_FETCHED:
-        write_journal_to_buffer();
-        // 此处无break，写到缓存后可直接尝试写入SSD，不用等到下一轮loop
-
-    case journal_process_state::WRITTEN_IN_BUFFER:
-        if (write_journal_to_SSD() == true)
+        switch (cur_proc_state)
         {
+        case journal_process_state::NEWLY_FETCHED:
+            write_journal_to_buffer();
+            // 此处无break，写到缓存后可直接尝试写入SSD，不用等到下一轮loop
+
+        case journal_process_state::WRITTEN_IN_BUFFER:
+            if (write_journal_to_SSD() == false)
+                return;
             generate_tx_record();
+            journal_process_env::get_instance()->notify_tx_persisted(cur_journal->get_tx_id());
             cur_journal = nullptr;
+            break;
         }
-        break;
     }
 }
 
@@ -0,0 +1,83 @@
+#include "cache/cache_manager.hh"
+
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+/*
+ * 缓存管理器微基准测试
+ * 对比 cache_hash_index + lru_replacer 与 open_addressing_index + clock_replacer
+ * 在缓存项数为entry_num时，命中查找(get)、获取缓存项后pin + unpin、置换 + 加入的平均耗时(ns/op)
+ * pin + unpin与缓存中的用法相同：由get(不视为访问)得到缓存项，再将其交给pin和unpin，只查找一次索引
+ *
+ * 用法：bench_cache_manager [entry_num] [ops]
+ */
+
+using namespace hscfs;
+
+struct bench_entry: public replacer_hook<uint32_t>
+{
+    uint32_t v;
+    bench_entry(uint32_t v_) : v(v_) {}
+};
+
+static volatile uint32_t sink;
+
+template <typename func_t>
+static double measure_ns_per_op(size_t ops, func_t &&func)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < ops; ++i)
+        func(i);
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / ops;
+}
+
+template <template <typename, typename> class index_t, template <typename> class replacer_t>
+static void run_bench(const char *name, uint32_t entry_num, size_t ops)
+{
+    generic_cache_manager<uint32_t, bench_entry, index_t, replacer_t> cache_manager;
+    for (uint32_t i = 0; i < entry_num; ++i)
+        cache_manager.add(i, std::make_unique<bench_entry>(i));
+
+    /* 预先生成随机key，避免随机数生成的开销计入测试 */
+    std::mt19937 gen(0);
+    std::uniform_int_distribution<uint32_t> dist(0, entry_num - 1);
+    std::vector<uint32_t> keys(ops);
+    for (auto &key : keys)
+        key = dist(gen);
+
+    double get_ns = measure_ns_per_op(ops, [&](size_t i) {
+        sink = cache_manager.get(keys[i])->v;
+    });
+
+    double pin_ns = measure_ns_per_op(ops, [&](size_t i) {
+        bench_entry *entry = cache_manager.get(keys[i], false);
+        cache_manager.pin(keys[i], entry);
+        cache_manager.unpin(keys[i], entry);
+    });
+
+    uint32_t next_key = entry_num;
+    double replace_ns = measure_ns_per_op(ops, [&](size_t i) {
+        auto victim = cache_manager.replace_one();
+        victim->v = next_key;
+        cache_manager.add(next_key++, victim);
+    });
+
+    printf("%-36s%-12.1f%-20.1f%-16.1f\n", name, get_ns, pin_ns, replace_ns);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t entry_num = argc > 1 ? strtoul(argv[1], nullptr, 10) : 4096;
+    size_t ops = argc > 2 ? strtoul(argv[2], nullptr, 10) : 2000000;
+
+    printf("entry num = %u, ops = %zu\n", entry_num, ops);
+    printf("%-36s%-12s%-20s%-16s\n", "index + replacer", "get(ns)", "get+pin+unpin(ns)", 
+        "replace+add(ns)");
+    run_bench<cache_hash_index, lru_replacer>("cache_hash_index + lru_replacer", entry_num, ops);
+    run_bench<open_addressing_index, clock_replacer>("open_addressing_index + clock", entry_num, ops);
+    return 0;
+}
@@ -2,12 +2,14 @@
 #include "gtest/gtest.h"
 
 #include <vector>
+#include <random>
+#include <unordered_map>
 
 using namespace hscfs;
 using std::unique_ptr;
 using std::vector;
 
-struct cache_obj
+struct cache_obj: public replacer_hook<int>
 {
     int k, v;
     cache_obj(int k_ = 0, int v_ = 0) {
@@ -98,6 +100,156 @@ TEST_F(test_cache_manager, lru_with_pin)
     }
 }
 
+TEST(test_open_addressing_index, random_add_remove)
+{
+    open_addressing_index<int, cache_obj> index;
+    std::unordered_map<int, int> expect;
+    std::mt19937 gen(0);
+    std::uniform_int_distribution<int> dist(0, 2047);
+    for (int i = 0; i < 20000; ++i)
+    {
+        int key = dist(gen);
+        if (expect.count(key) == 0)
+        {
+            index.add(key, std::make_unique<cache_obj>(key, i));
+            expect[key] = i;
+        }
+        else
+        {
+            EXPECT_EQ(index.get(key)->v, expect[key]);
+            unique_ptr<cache_obj> p = index.remove(key);
+            EXPECT_EQ(p->k, key);
+            expect.erase(key);
+        }
+    }
+    for (int key = 0; key < 2048; ++key)
+    {
+        cache_obj *p = index.get(key);
+        if (expect.count(key) == 0)
+            EXPECT_EQ(p, nullptr);
+        else
+            EXPECT_EQ(p->v, expect[key]);
+    }
+
+    /* 遍历时删除奇数key，剩余的key应恰好是偶数key */
+    size_t cnt = 0;
+    for (auto it = index.begin(); it != index.end(); )
+    {
+        EXPECT_EQ(expect.count(it->first), 1);
+        ++cnt;
+        if (it->first & 1)
+            it = index.erase(it);
+        else
+            ++it;
+    }
+    EXPECT_EQ(cnt, expect.size());
+    for (auto &entry : expect)
+        EXPECT_EQ(index.get(entry.first) != nullptr, (entry.first & 1) == 0);
+}
+
+class test_clock_cache_manager: public ::testing::Test
+{
+protected:
+    using cache_manager_t = generic_cache_manager<int, cache_obj, open_addressing_index, clock_replacer>;
+
+    void SetUp() override
+    {
+        cache_manager.reset(new cache_manager_t);
+        for (int i = 0; i < 10; ++i)
+            cache_manager->add(i, std::make_unique<cache_obj>(i, i));
+    }
+
+protected:
+    unique_ptr<cache_manager_t> cache_manager;
+};
+
+TEST_F(test_clock_cache_manager, second_chance)
+{
+    /* 被访问过的缓存项获得第二次机会，未访问的按加入顺序置换 */
+    for (int i = 0; i < 10; i += 2)
+        cache_manager->get(i);
+    for (int i = 1; i < 10; i += 2)
+        EXPECT_EQ(cache_manager->replace_one()->k, i);
+    for (int i = 0; i < 10; i += 2)
+        EXPECT_EQ(cache_manager->replace_one()->k, i);
+    EXPECT_EQ(cache_manager->replace_one(), nullptr);
+}
+
+/* 统计get调用次数的索引，用于检查缓存管理器查找索引的次数 */
+template <typename key_t, typename entry_t>
+class counting_index: public open_addressing_index<key_t, entry_t>
+{
+public:
+    static size_t get_num;
+
+    entry_t *get(const key_t &key)
+    {
+        ++get_num;
+        return open_addressing_index<key_t, entry_t>::get(key);
+    }
+};
+
+template <typename key_t, typename entry_t>
+size_t counting_index<key_t, entry_t>::get_num = 0;
+
+/* 给出缓存项时，侵入式置换器的pin、unpin、remove不再查找索引 */
+TEST(test_clock_cache_manager_entry, no_extra_lookup)
+{
+    using index_t = counting_index<int, cache_obj>;
+    generic_cache_manager<int, cache_obj, counting_index, clock_replacer> cache_manager;
+    for (int i = 0; i < 4; ++i)
+        cache_manager.add(i, std::make_unique<cache_obj>(i, i));
+
+    index_t::get_num = 0;
+    cache_obj *entry = cache_manager.get(1, false);
+    cache_manager.pin(1, entry);
+    EXPECT_EQ(index_t::get_num, 1);
+    EXPECT_EQ(cache_manager.replace_one()->k, 0);
+    EXPECT_EQ(cache_manager.replace_one()->k, 2);
+
+    cache_manager.unpin(1, entry);
+    entry = cache_manager.get(3, false);
+    cache_manager.remove(3, entry);
+    EXPECT_EQ(index_t::get_num, 2);
+    EXPECT_EQ(cache_manager.replace_one()->k, 1);
+    EXPECT_EQ(cache_manager.replace_one(), nullptr);
+
+    /* 只给出key时，需要通过索引找到缓存项 */
+    cache_manager.add(5, std::make_unique<cache_obj>(5, 5));
+    cache_manager.pin(5);
+    EXPECT_EQ(index_t::get_num, 3);
+}
+
+TEST_F(test_clock_cache_manager, with_pin)
+{
+    for (int i = 1; i < 10; i += 2)
+        cache_manager->pin(i);
+    cache_manager->remove(3);
+    for (int i = 0; i < 10; i += 2)
+        EXPECT_EQ(cache_manager->replace_one()->k, i);
+    EXPECT_EQ(cache_manager->replace_one(), nullptr);
+    for (int i = 1; i < 10; i += 2)
+    {
+        if (i != 3)
+            cache_manager->unpin(i);
+    }
+    for (auto it = cache_manager->begin(); it != cache_manager->end(); )
+    {
+        if (it->first == 9)
+            it = cache_manager->erase(it);
+        else
+            ++it;
+    }
+    for (int i = 1; i < 9; i += 2)
+    {
+        if (i != 3)
+        {
+            EXPECT_EQ(cache_manager->replace_one()->k, i);
+        }
+    }
+    EXPECT_EQ(cache_manager->replace_one(), nullptr);
+}
+
 // TEST(test_cache_manager_safe, 1)
 // {
 //     generic_cache_manager_safe<int, cache_obj> cache_manager;
@@ -0,0 +1,133 @@
+#include "cache/dma_block_pool.hh"
+#include "gtest/gtest.h"
+#include <cstring>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+
+using namespace hscfs;
+
+/* 释放的块被同一线程的下一次分配复用，要求清零时内容为0 */
+TEST(dma_block_pool_test, reuse_and_zero)
+{
+    dma_block_pool *pool = dma_block_pool::get_instance();
+    char *blk = pool->alloc(false);
+    std::memset(blk, 'x', dma_block_pool::block_size);
+    pool->free(blk);
+
+    dma_block_pool_stat before = pool->get_stat();
+    char *blk2 = pool->alloc(true);
+    EXPECT_EQ(blk2, blk);
+    for (size_t i = 0; i < dma_block_pool::block_size; ++i)
+        ASSERT_EQ(blk2[i], 0) << "offset: " << i;
+    pool->free(blk2);
+
+    dma_block_pool_stat after = pool->get_stat();
+    EXPECT_EQ(after.alloc_num, before.alloc_num + 1);
+    EXPECT_EQ(after.thread_cache_hit, before.thread_cache_hit + 1);
+    EXPECT_EQ(after.zeroed_num, before.zeroed_num + 1);
+    EXPECT_EQ(after.slab_num, before.slab_num);
+}
+
+/* 分配超过一个slab的块，块之间互不重叠，全部释放后都回到池中 */
+TEST(dma_block_pool_test, many_blocks)
+{
+    dma_block_pool *pool = dma_block_pool::get_instance();
+    const size_t num = dma_block_pool::blocks_per_slab + 10;
+    std::vector<char*> blks;
+    for (size_t i = 0; i < num; ++i)
+    {
+        blks.push_back(pool->alloc(false));
+        std::memset(blks.back(), static_cast<int>(i & 0xff), dma_block_pool::block_size);
+    }
+    for (size_t i = 0; i < num; ++i)
+    {
+        EXPECT_EQ(blks[i][0], static_cast<char>(i & 0xff));
+        EXPECT_EQ(blks[i][dma_block_pool::block_size - 1], static_cast<char>(i & 0xff));
+    }
+    EXPECT_GE(pool->get_stat().slab_num, 2U);
+    for (char *blk : blks)
+        pool->free(blk);
+
+    dma_block_pool_stat stat = pool->get_stat();
+    EXPECT_EQ(stat.free_blocks, stat.total_blocks);
+}
+
+/* 多线程并发分配释放，线程退出后其缓存的块归还全局 */
+TEST(dma_block_pool_test, multi_thread)
+{
+    dma_block_pool *pool = dma_block_pool::get_instance();
+    const size_t th_num = 8, round_num = 10000;
+    std::vector<std::thread> ths;
+    for (size_t t = 0; t < th_num; ++t)
+    {
+        ths.emplace_back([pool, t]() {
+            std::vector<char*> held;
+            for (size_t i = 0; i < round_num; ++i)
+            {
+                if (held.size() < 100 && (i + t) % 3 != 0)
+                {
+                    held.push_back(pool->alloc(false));
+                    std::memset(held.back(), static_cast<int>(t), 64);
+                }
+                else if (!held.empty())
+                {
+                    EXPECT_EQ(held.back()[63], static_cast<char>(t));
+                    pool->free(held.back());
+                    held.pop_back();
+                }
+            }
+            for (char *blk : held)
+                pool->free(blk);
+        });
+    }
+    for (auto &th : ths)
+        th.join();
+
+    dma_block_pool_stat stat = pool->get_stat();
+    EXPECT_EQ(stat.free_blocks, stat.total_blocks);
+    EXPECT_GT(stat.thread_cache_hit, 0U);
+}
+
+/* 线程缓存析构后，同一线程中其它thread_local对象析构时仍能分配和释放块 */
+struct late_block_user
+{
+    char *blk = nullptr;
+    static std::atomic_bool done;
+
+    ~late_block_user()
+    {
+        dma_block_pool *pool = dma_block_pool::get_instance();
+        pool->free(blk);
+        char *blk2 = pool->alloc(true);
+        done = std::all_of(blk2, blk2 + dma_block_pool::block_size, [](char c) { return c == 0; });
+        pool->free(blk2);
+    }
+};
+
+std::atomic_bool late_block_user::done{false};
+
+TEST(dma_block_pool_test, use_after_thread_cache_destroyed)
+{
+    dma_block_pool *pool = dma_block_pool::get_instance();
+    dma_block_pool_stat before = pool->get_stat();
+    std::thread th([pool]() {
+        /* user先于线程缓存构造，因此在线程缓存之后析构 */
+        thread_local late_block_user user;
+        user.blk = pool->alloc(false);
+    });
+    th.join();
+
+    EXPECT_TRUE(late_block_user::done);
+    dma_block_pool_stat after = pool->get_stat();
+    EXPECT_EQ(after.alloc_num, before.alloc_num + 2);
+    EXPECT_EQ(after.zeroed_num, before.zeroed_num + 1);
+    EXPECT_EQ(after.free_blocks, after.total_blocks);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,96 @@
+#include "cache/extent_cache.hh"
+#include "gtest/gtest.h"
+
+using namespace hscfs;
+
+/* 块偏移和lpa都连续的插入合并为一个extent */
+TEST(extent_cache_test, merge)
+{
+    extent_cache cache;
+    cache.insert(10, 100);
+    cache.insert(12, 102);
+    EXPECT_EQ(cache.get_extent_num(), 2U);
+    cache.insert(11, 101);
+    EXPECT_EQ(cache.get_extent_num(), 1U);
+
+    /* 块偏移连续但lpa不连续，不合并 */
+    cache.insert(13, 200, 2);
+    EXPECT_EQ(cache.get_extent_num(), 2U);
+
+    uint32_t lpa;
+    ASSERT_TRUE(cache.lookup(10, lpa));
+    EXPECT_EQ(lpa, 100U);
+    ASSERT_TRUE(cache.lookup(12, lpa));
+    EXPECT_EQ(lpa, 102U);
+    ASSERT_TRUE(cache.lookup(14, lpa));
+    EXPECT_EQ(lpa, 201U);
+    EXPECT_FALSE(cache.lookup(9, lpa));
+    EXPECT_FALSE(cache.lookup(15, lpa));
+    EXPECT_EQ(cache.get_stat().hit_num, 3U);
+    EXPECT_EQ(cache.get_stat().miss_num, 2U);
+}
+
+/* 覆盖extent中间的块，原extent被拆分为三段 */
+TEST(extent_cache_test, overwrite)
+{
+    extent_cache cache;
+    cache.insert(0, 100, 10);
+    cache.insert(4, 500);
+    EXPECT_EQ(cache.get_extent_num(), 3U);
+
+    uint32_t lpa;
+    ASSERT_TRUE(cache.lookup(3, lpa));
+    EXPECT_EQ(lpa, 103U);
+    ASSERT_TRUE(cache.lookup(4, lpa));
+    EXPECT_EQ(lpa, 500U);
+    ASSERT_TRUE(cache.lookup(5, lpa));
+    EXPECT_EQ(lpa, 105U);
+
+    /* 写回原lpa后重新合并 */
+    cache.insert(4, 104);
+    EXPECT_EQ(cache.get_extent_num(), 1U);
+}
+
+/* 删除一段范围，范围两端的extent只保留范围外的部分 */
+TEST(extent_cache_test, remove)
+{
+    extent_cache cache;
+    cache.insert(0, 100, 10);
+    cache.insert(10, 300, 10);
+    cache.insert(20, 500, 10);
+    cache.remove(5, 25);
+    EXPECT_EQ(cache.get_extent_num(), 2U);
+
+    uint32_t lpa;
+    ASSERT_TRUE(cache.lookup(4, lpa));
+    EXPECT_EQ(lpa, 104U);
+    EXPECT_FALSE(cache.lookup(5, lpa));
+    EXPECT_FALSE(cache.lookup(15, lpa));
+    EXPECT_FALSE(cache.lookup(24, lpa));
+    ASSERT_TRUE(cache.lookup(25, lpa));
+    EXPECT_EQ(lpa, 505U);
+
+    /* 截断：删除某个块偏移之后的全部映射 */
+    cache.remove(2, UINT32_MAX);
+    EXPECT_EQ(cache.get_extent_num(), 1U);
+    ASSERT_TRUE(cache.lookup(1, lpa));
+    EXPECT_FALSE(cache.lookup(2, lpa));
+    EXPECT_FALSE(cache.lookup(29, lpa));
+}
+
+/* extent数超过上限时清空 */
+TEST(extent_cache_test, limit)
+{
+    extent_cache cache;
+    for (uint32_t i = 0; i < extent_cache::max_extent_num; ++i)
+        cache.insert(i * 2, 1000 + i * 2);
+    EXPECT_EQ(cache.get_extent_num(), extent_cache::max_extent_num);
+    cache.insert(extent_cache::max_extent_num * 2, 1);
+    EXPECT_EQ(cache.get_extent_num(), 1U);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,151 @@
+#include "cache/cache_manager.hh"
+#include "gtest/gtest.h"
+
+#include <vector>
+#include <random>
+#include <cstdio>
+
+using namespace hscfs;
+using std::unique_ptr;
+using std::vector;
+
+TEST(two_queue_replacer_test, basic_function)
+{
+    two_queue_replacer<int> replacer;
+    for (int i = 0; i < 4; ++i)
+        replacer.add(i);
+    EXPECT_EQ(replacer.get_num_can_replace(), 4);
+
+    replacer.pin(0);
+    replacer.pin(0);
+    EXPECT_EQ(replacer.get_num_can_replace(), 3);
+    replacer.remove(1);
+    EXPECT_EQ(replacer.get_num_can_replace(), 2);
+
+    /* a1in为FIFO，访问不改变置换顺序 */
+    replacer.access(2);
+    EXPECT_EQ(replacer.pop_replaced(), 2);
+    EXPECT_EQ(replacer.pop_replaced(), 3);
+    EXPECT_EQ(replacer.get_num_can_replace(), 0);
+
+    replacer.unpin(0);
+    EXPECT_EQ(replacer.get_num_can_replace(), 1);
+    EXPECT_EQ(replacer.pop_replaced(), 0);
+}
+
+TEST(two_queue_replacer_test, promote_from_ghost)
+{
+    two_queue_replacer<int> replacer;
+    for (int i = 0; i < 8; ++i)
+        replacer.add(i);
+
+    /* 0被置换后记录在a1out中，再次加入时进入am */
+    EXPECT_EQ(replacer.pop_replaced(), 0);
+    replacer.add(0);
+
+    /* a1in超过目标大小时优先从a1in置换，虽然0比它们更晚加入，但它们先被置换 */
+    for (int i = 1; i < 6; ++i)
+        EXPECT_EQ(replacer.pop_replaced(), i);
+    EXPECT_EQ(replacer.get_num_can_replace(), 3);
+}
+
+TEST(two_queue_replacer_test, am_lru)
+{
+    two_queue_replacer<int> replacer;
+    for (int i = 0; i < 8; ++i)
+        replacer.add(i);
+    for (int i = 0; i < 4; ++i)
+        EXPECT_EQ(replacer.pop_replaced(), i);
+    for (int i = 0; i < 3; ++i)
+        replacer.add(i);
+
+    /* 0, 1, 2都在am中，按lru置换；a1in中的4, 5, 6先被置换，7在a1in目标大小以内 */
+    replacer.access(0);
+    replacer.pin(1);
+    replacer.unpin(1);
+    for (int i = 4; i < 7; ++i)
+        EXPECT_EQ(replacer.pop_replaced(), i);
+    EXPECT_EQ(replacer.pop_replaced(), 2);
+    EXPECT_EQ(replacer.pop_replaced(), 0);
+    EXPECT_EQ(replacer.pop_replaced(), 1);
+    EXPECT_EQ(replacer.pop_replaced(), 7);
+}
+
+/*
+ * 使用访问序列驱动容量为capacity的缓存，返回命中率
+ * 缓存的使用方式与各个cache相同：命中时get，缺失时若已满则置换一个，再add
+ */
+template <template <typename> class replacer_t>
+static double run_trace(const vector<int> &trace, size_t capacity)
+{
+    generic_cache_manager<int, int, cache_hash_index, replacer_t> cache_manager;
+    size_t size = 0, hit = 0;
+    for (int key : trace)
+    {
+        if (cache_manager.get(key) != nullptr)
+        {
+            ++hit;
+            continue;
+        }
+        if (size >= capacity)
+        {
+            auto victim = cache_manager.replace_one();
+            assert(victim != nullptr);
+            --size;
+        }
+        cache_manager.add(key, std::make_unique<int>(key));
+        ++size;
+    }
+    return static_cast<double>(hit) / trace.size();
+}
+
+/*
+ * 热点工作集的访问与顺序扫描交替进行(如一个线程顺序读大文件，其它线程访问热点文件)
+ * 每次访问以hot_percent%的概率随机访问hot_num个热点key中的一个，否则访问一个新的扫描key
+ */
+static vector<int> make_hot_scan_trace(int hot_num, int hot_percent, int len)
+{
+    std::mt19937 gen(0);
+    std::uniform_int_distribution<int> hot_dist(0, hot_num - 1), percent_dist(0, 99);
+    vector<int> trace;
+    int scan_key = hot_num;
+    for (int i = 0; i < len; ++i)
+    {
+        if (percent_dist(gen) < hot_percent)
+            trace.push_back(hot_dist(gen));
+        else
+            trace.push_back(scan_key++);
+    }
+    return trace;
+}
+
+TEST(replacer_hit_rate, scan_resistance)
+{
+    const size_t capacity = 128;
+    vector<int> trace = make_hot_scan_trace(64, 50, 100000);
+    double lru_rate = run_trace<lru_replacer>(trace, capacity);
+    double two_queue_rate = run_trace<two_queue_replacer>(trace, capacity);
+    printf("hot set with scan: lru hit rate = %.3f, 2Q hit rate = %.3f\n", lru_rate, two_queue_rate);
+    EXPECT_GT(two_queue_rate, lru_rate + 0.1);
+}
+
+TEST(replacer_hit_rate, skewed_without_scan)
+{
+    /* 没有扫描时，2Q的命中率不应明显低于lru */
+    const size_t capacity = 128;
+    std::mt19937 gen(1);
+    std::geometric_distribution<int> dist(0.01);
+    vector<int> trace;
+    for (int i = 0; i < 100000; ++i)
+        trace.push_back(dist(gen));
+    double lru_rate = run_trace<lru_replacer>(trace, capacity);
+    double two_queue_rate = run_trace<two_queue_replacer>(trace, capacity);
+    printf("skewed access: lru hit rate = %.3f, 2Q hit rate = %.3f\n", lru_rate, two_queue_rate);
+    EXPECT_GT(two_queue_rate, lru_rate - 0.05);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
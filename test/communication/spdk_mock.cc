@@ -107,6 +107,61 @@ int spdk_nvme_ns_cmd_write(struct spdk_nvme_ns *ns, struct spdk_nvme_qpair *qpai
     return 0;
 }
 
+// 按SPDK的方式遍历SGL，对第i个LBA调用op(lba + i, 该LBA在SGE中的地址)
+// 测试中每个SGE长度为LBA大小的整数倍
+static int for_each_sgl_lba(uint64_t lba, uint32_t lba_count, void *cb_arg, 
+    spdk_nvme_req_reset_sgl_cb reset_sgl_fn, spdk_nvme_req_next_sge_cb next_sge_fn, void (*op)(uint64_t, char*))
+{
+    reset_sgl_fn(cb_arg, 0);
+    uint32_t cnt = 0;
+    while (cnt < lba_count)
+    {
+        void *addr;
+        uint32_t len;
+        int ret = next_sge_fn(cb_arg, &addr, &len);
+        if (ret != 0 || len == 0 || len % lba_size != 0)
+            return -EINVAL;
+        for (uint32_t off = 0; off < len && cnt < lba_count; off += lba_size, ++cnt)
+            op(lba + cnt, static_cast<char*>(addr) + off);
+    }
+    return 0;
+}
+
+int spdk_nvme_ns_cmd_readv(struct spdk_nvme_ns *ns, struct spdk_nvme_qpair *qpair,
+			   uint64_t lba, uint32_t lba_count,
+			   spdk_nvme_cmd_cb cb_fn, void *cb_arg, uint32_t io_flags,
+			   spdk_nvme_req_reset_sgl_cb reset_sgl_fn,
+			   spdk_nvme_req_next_sge_cb next_sge_fn)
+{
+    std::lock_guard<std::mutex> lg(io_mtx);
+    int ret = for_each_sgl_lba(lba, lba_count, cb_arg, reset_sgl_fn, next_sge_fn, [](uint64_t cur, char *buf) {
+        if (vir_lba_storage.count(cur))
+            memcpy(buf, vir_lba_storage[cur].get_ptr(), lba_size);
+        else
+            memcpy(buf, "empty block.", sizeof("empty block."));
+    });
+    if (ret != 0)
+        return ret;
+    qpair_io_cmds[qpair_addr_to_idx(qpair)].emplace_back(INVALID_TID, cb_fn, cb_arg);
+    return 0;
+}
+
+int spdk_nvme_ns_cmd_writev(struct spdk_nvme_ns *ns, struct spdk_nvme_qpair *qpair,
+			    uint64_t lba, uint32_t lba_count,
+			    spdk_nvme_cmd_cb cb_fn, void *cb_arg, uint32_t io_flags,
+			    spdk_nvme_req_reset_sgl_cb reset_sgl_fn,
+			    spdk_nvme_req_next_sge_cb next_sge_fn)
+{
+    std::lock_guard<std::mutex> lg(io_mtx);
+    int ret = for_each_sgl_lba(lba, lba_count, cb_arg, reset_sgl_fn, next_sge_fn, [](uint64_t cur, char *buf) {
+        memcpy(vir_lba_storage[cur].get_ptr(), buf, lba_size);
+    });
+    if (ret != 0)
+        return ret;
+    qpair_io_cmds[qpair_addr_to_idx(qpair)].emplace_back(INVALID_TID, cb_fn, cb_arg);
+    return 0;
+}
+
 int spdk_nvme_ctrlr_cmd_admin_raw(struct spdk_nvme_ctrlr *ctrlr,
 				  struct spdk_nvme_cmd *cmd,
 				  void *buf, uint32_t len,
@@ -8,6 +8,7 @@
 #include <stdexcept>
 #include <thread>
 #include <cstdio>
+#include <cstring>
 
 comm_dev dev;
 std::thread th;
@@ -80,6 +81,30 @@ TEST(comm_test, async_read_multi_thread)
     }
 }
 
+/* 用两个缓存区向量写4个LBA，再用不同的划分向量读出，以及普通读出，检查内容一致 */
+TEST(comm_test, sync_rwv)
+{
+    const uint64_t start_lba = 1024;
+    char wbuf0[lba_size], wbuf1[lba_size * 3];
+    for (size_t i = 0; i < lba_size; ++i)
+        wbuf0[i] = 'a';
+    for (size_t i = 0; i < lba_size * 3; ++i)
+        wbuf1[i] = static_cast<char>('b' + i / lba_size);
+    struct iovec wiov[2] = {{wbuf0, sizeof(wbuf0)}, {wbuf1, sizeof(wbuf1)}};
+    ASSERT_EQ(comm_submit_sync_rwv_request(&dev, wiov, 2, start_lba, 4, COMM_IO_WRITE), 0);
+
+    char rbuf0[lba_size * 2], rbuf1[lba_size * 2];
+    struct iovec riov[2] = {{rbuf0, sizeof(rbuf0)}, {rbuf1, sizeof(rbuf1)}};
+    ASSERT_EQ(comm_submit_sync_rwv_request(&dev, riov, 2, start_lba, 4, COMM_IO_READ), 0);
+    EXPECT_EQ(memcmp(rbuf0, wbuf0, lba_size), 0);
+    EXPECT_EQ(memcmp(rbuf0 + lba_size, wbuf1, lba_size), 0);
+    EXPECT_EQ(memcmp(rbuf1, wbuf1 + lba_size, lba_size * 2), 0);
+
+    char buf[lba_size];
+    ASSERT_EQ(comm_submit_sync_rw_request(&dev, buf, start_lba + 3, 1, COMM_IO_READ), 0);
+    EXPECT_EQ(buf[0], 'd');
+}
+
 void sync_raw_long_cmd_test(size_t idx)
 {
     const size_t cmd_res_len = 128;
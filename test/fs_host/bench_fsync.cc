@@ -0,0 +1,93 @@
+#include "api/hscfs.hh"
+#include "fs/fs_manager.hh"
+#include "fs/group_commit.hh"
+#include "host_test_env.hh"
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+
+/*
+ * 多线程fsync性能测试(模拟OLTP负载的日志写入)
+ *
+ * 分别以1、2、4...max_threads个线程，每个线程向自己的文件追加ops_per_thread次4KB写入，每次写入后fsync
+ * 统计吞吐量，以及组提交中每个事务平均包含的fsync次数和fsync时延分布
+ *
+ * 用法：bench_fsync [max_threads] [ops_per_thread]
+ * 测试镜像只有一个node segment和一个data segment，且回收空间前，每次fsync都会消耗新的块，所以总fsync次数不宜超过400
+ * 可设置环境变量HSCFS_MOCK_IO_DELAY_US模拟SSD时延，如：
+ * HSCFS_MOCK_IO_DELAY_US=100 ./bench_fsync 8 2>/dev/null
+ */
+
+static const size_t block_size = 4096;
+
+static void append_fsync_thread(size_t idx, size_t ops, std::atomic_size_t &err_cnt)
+{
+    std::string path = "/a/b/bench_fsync_" + std::to_string(idx);
+    int fd = hscfs::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC);
+    if (fd == -1)
+    {
+        ++err_cnt;
+        return;
+    }
+
+    std::vector<char> buf(block_size, static_cast<char>(idx));
+    for (size_t i = 0; i < ops; ++i)
+    {
+        if (hscfs::write(fd, buf.data(), block_size) != ssize_t(block_size) || hscfs::fsync(fd) != 0)
+            ++err_cnt;
+    }
+
+    if (hscfs::close(fd) != 0)
+        ++err_cnt;
+}
+
+int main(int argc, char **argv)
+{
+    size_t max_threads = argc > 1 ? strtoul(argv[1], nullptr, 10) : 8;
+    size_t ops_per_thread = argc > 2 ? strtoul(argv[2], nullptr, 10) : 16;
+
+    host_test_env_setup();
+    hscfs::group_committer *committer = hscfs::file_system_manager::get_instance()->get_group_committer();
+
+    printf("%-10s%-15s%-15s%-15s%-15s%-15s\n", "threads", "fsync/s", "fsync/tx", "avg(us)", "p50(us)<", "p99(us)<");
+    int ret = 0;
+    for (size_t th_num = 1; th_num <= max_threads; th_num *= 2)
+    {
+        std::atomic_size_t err_cnt(0);
+        std::vector<std::thread> ths;
+        hscfs::group_commit_stat before = committer->get_stat();
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < th_num; ++i)
+            ths.emplace_back(append_fsync_thread, i, ops_per_thread, std::ref(err_cnt));
+        for (auto &th : ths)
+            th.join();
+        auto end = std::chrono::steady_clock::now();
+
+        /* 只统计本轮的fsync */
+        hscfs::group_commit_stat stat = committer->get_stat();
+        stat.tx_num -= before.tx_num;
+        stat.fsync_num -= before.fsync_num;
+        stat.total_latency_us -= before.total_latency_us;
+        for (size_t i = 0; i < hscfs::group_commit_stat::latency_bucket_num; ++i)
+            stat.latency_hist[i] -= before.latency_hist[i];
+
+        double sec = std::chrono::duration<double>(end - start).count();
+        printf("%-10zu%-15.0f%-15.2f%-15.1f%-15lu%-15lu\n", th_num, stat.fsync_num / sec, stat.get_commits_per_tx(),
+            stat.fsync_num == 0 ? 0 : static_cast<double>(stat.total_latency_us) / stat.fsync_num,
+            stat.get_latency_percentile_us(0.5), stat.get_latency_percentile_us(0.99));
+        if (err_cnt != 0)
+        {
+            fprintf(stderr, "%zu errors occurred with %zu threads.\n", err_cnt.load(), th_num);
+            ret = 1;
+        }
+    }
+
+    host_test_env_teardown();
+    return ret;
+}
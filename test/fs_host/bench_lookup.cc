@@ -0,0 +1,104 @@
+#include "api/hscfs.hh"
+#include "fs/fs_manager.hh"
+#include "fs/lookup_policy.hh"
+#include "host_test_env.hh"
+
+#include <chrono>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+/*
+ * 路径解析不命中时的查找方式性能测试
+ *
+ * 在镜像中的目录/a/b下查找不存在的文件，目录项缓存总是不命中，目录/a/b的inode和数据块在第一次查找后留在缓存中
+ * 依次以ssd(总是交给SSD)、host(总是在主机侧查找)和adaptive(按代价选择)模式各查找lookup_num次，
+ * 以及batch模式：总是交给SSD，但每batch_size个路径由lookup_paths批量解析，命令同时下发
+ * 统计耗时、SSD读命令数，以及在主机侧查找和交给SSD的次数
+ *
+ * 用法：bench_lookup [lookup_num] [mode]
+ * mode为ssd、host、adaptive或batch时只测试该模式
+ * 可设置环境变量HSCFS_MOCK_IO_DELAY_US和HSCFS_MOCK_OFFLOAD_DELAY_US模拟SSD读命令和查找命令的时延，如：
+ * HSCFS_MOCK_IO_DELAY_US=100 HSCFS_MOCK_OFFLOAD_DELAY_US=300 ./bench_lookup 1000 2>/dev/null
+ */
+
+using namespace hscfs;
+
+static const size_t batch_size = 64;
+
+static lookup_policy_stat get_policy_stat()
+{
+    file_system_manager *fs_manager = file_system_manager::get_instance();
+    std::lock_guard<std::mutex> lg(fs_manager->get_fs_meta_lock());
+    return fs_manager->get_lookup_policy()->get_stat();
+}
+
+static void run_mode(const char *name, lookup_mode mode, bool batch, size_t lookup_num)
+{
+    file_system_manager::get_instance()->get_lookup_policy()->set_mode(mode);
+    lookup_policy_stat before = get_policy_stat();
+    uint64_t read_cmds = host_test_env_get_read_cmd_num();
+    size_t err_num = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < lookup_num; i += batch ? batch_size : 1)
+    {
+        if (!batch)
+        {
+            std::string path = "/a/b/" + std::string(name) + std::to_string(i);
+            if (hscfs::open(path.c_str(), O_RDONLY) != -1 || errno != ENOENT)
+                ++err_num;
+            continue;
+        }
+
+        std::vector<std::string> paths;
+        std::vector<const char*> p_paths;
+        for (size_t j = i; j < std::min(i + batch_size, lookup_num); ++j)
+            paths.emplace_back("/a/b/" + std::string(name) + std::to_string(j));
+        for (auto &path : paths)
+            p_paths.push_back(path.c_str());
+        std::unique_ptr<bool[]> exist(new bool[paths.size()]);
+        if (hscfs::lookup_paths(p_paths.data(), p_paths.size(), exist.get()) != 0)
+            ++err_num;
+        for (size_t j = 0; j < paths.size(); ++j)
+            err_num += exist[j];
+    }
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    lookup_policy_stat after = get_policy_stat();
+    printf("%-10s%-10zu%-15.3f%-15.0f%-12lu%-12lu%-12lu\n", name, lookup_num, sec, lookup_num / sec,
+        host_test_env_get_read_cmd_num() - read_cmds, after.host_path_num - before.host_path_num,
+        after.ssd_path_num - before.ssd_path_num);
+    if (err_num != 0)
+        fprintf(stderr, "%zu errors occurred in %s mode.\n", err_num, name);
+}
+
+int main(int argc, char **argv)
+{
+    size_t lookup_num = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1000;
+    const char *only_mode = argc > 2 ? argv[2] : nullptr;
+    const struct {
+        const char *name;
+        lookup_mode mode;
+        bool batch;
+    } modes[] = {
+        {"ssd", lookup_mode::ssd, false}, {"host", lookup_mode::host, false},
+        {"adaptive", lookup_mode::adaptive, false}, {"batch", lookup_mode::ssd, true}
+    };
+
+    host_test_env_setup();
+    printf("%-10s%-10s%-15s%-15s%-12s%-12s%-12s\n", "mode", "lookups", "time(s)", "lookups/s", "read cmds",
+        "on host", "offloaded");
+    for (auto &m : modes)
+    {
+        if (only_mode == nullptr || strcmp(only_mode, m.name) == 0)
+            run_mode(m.name, m.mode, m.batch, lookup_num);
+    }
+    host_test_env_teardown();
+    return 0;
+}
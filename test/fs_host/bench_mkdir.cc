@@ -0,0 +1,95 @@
+#include "api/hscfs.hh"
+#include "host_test_env.hh"
+
+#include <chrono>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cerrno>
+
+/*
+ * 目录树创建性能测试(模拟mkdir -p和解压归档)
+ *
+ * 1. 解压：在/a下逐层创建深度为depth、每个目录有fanout个子目录的目录树，每个叶子目录中创建files_per_dir个文件
+ *    每个新目录都是刚创建、还未写回SSD的目录，在其中创建目录项前需要查找同名目录项
+ * 2. mkdir -p：对每个叶子目录，从根开始逐级mkdir，已存在的目录返回EEXIST
+ * 统计每个阶段的耗时、操作速率和SSD写命令数
+ *
+ * 用法：bench_mkdir [depth] [fanout] [files_per_dir]
+ * 测试镜像只有一个node segment，目录和文件总数不宜超过400
+ * 可设置环境变量HSCFS_MOCK_IO_DELAY_US模拟SSD时延，如：
+ * HSCFS_MOCK_IO_DELAY_US=100 ./bench_mkdir 4 3 2 2>/dev/null
+ */
+
+static size_t op_num, err_num;
+
+static void untar(const std::string &dir, size_t level, size_t depth, size_t fanout, size_t files_per_dir)
+{
+    ++op_num;
+    if (hscfs::mkdir(dir.c_str()) != 0)
+        ++err_num;
+    if (level == depth)
+    {
+        for (size_t i = 0; i < files_per_dir; ++i)
+        {
+            ++op_num;
+            std::string path = dir + "/f" + std::to_string(i);
+            int fd = hscfs::open(path.c_str(), O_RDWR | O_CREAT);
+            if (fd == -1 || hscfs::close(fd) != 0)
+                ++err_num;
+        }
+        return;
+    }
+    for (size_t i = 0; i < fanout; ++i)
+        untar(dir + "/d" + std::to_string(i), level + 1, depth, fanout, files_per_dir);
+}
+
+static void mkdir_p(const std::string &dir, size_t level, size_t depth, size_t fanout)
+{
+    if (level == depth)
+    {
+        /* 从根开始逐级创建叶子目录的每一级 */
+        for (size_t pos = dir.find('/', 1); ; pos = dir.find('/', pos + 1))
+        {
+            ++op_num;
+            if (hscfs::mkdir(dir.substr(0, pos).c_str()) == 0 || errno != EEXIST)
+                ++err_num;
+            if (pos == std::string::npos)
+                break;
+        }
+        return;
+    }
+    for (size_t i = 0; i < fanout; ++i)
+        mkdir_p(dir + "/d" + std::to_string(i), level + 1, depth, fanout);
+}
+
+template <typename Fn>
+static void run_phase(const char *name, Fn fn)
+{
+    op_num = err_num = 0;
+    uint64_t write_cmds = host_test_env_get_write_cmd_num();
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto end = std::chrono::steady_clock::now();
+    double sec = std::chrono::duration<double>(end - start).count();
+    printf("%-10s%-10zu%-15.3f%-15.0f%-15lu\n", name, op_num, sec, op_num / sec, 
+        host_test_env_get_write_cmd_num() - write_cmds);
+    if (err_num != 0)
+        fprintf(stderr, "%zu errors occurred in %s.\n", err_num, name);
+}
+
+int main(int argc, char **argv)
+{
+    size_t depth = argc > 1 ? strtoul(argv[1], nullptr, 10) : 4;
+    size_t fanout = argc > 2 ? strtoul(argv[2], nullptr, 10) : 3;
+    size_t files_per_dir = argc > 3 ? strtoul(argv[3], nullptr, 10) : 2;
+    const std::string root = "/a/bench_tree";
+
+    host_test_env_setup();
+    printf("%-10s%-10s%-15s%-15s%-15s\n", "phase", "ops", "time(s)", "ops/s", "write cmds");
+    run_phase("untar", [&]() { untar(root, 0, depth, fanout, files_per_dir); });
+    size_t untar_err = err_num;
+    run_phase("mkdir -p", [&]() { mkdir_p(root, 0, depth, fanout); });
+    host_test_env_teardown();
+    return untar_err != 0 || err_num != 0;
+}
@@ -0,0 +1,113 @@
+#include "api/hscfs.hh"
+#include "host_test_env.hh"
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+
+/*
+ * 多线程随机读性能测试
+ *
+ * 先向/a/b/c写入file_blocks个块，然后分别以1、2、4...max_threads个线程，
+ * 每个线程独立打开文件，进行ops_per_thread次4KB随机读，统计吞吐量
+ *
+ * 用法：bench_random_read [max_threads] [file_blocks] [ops_per_thread]
+ * 可设置环境变量HSCFS_MOCK_IO_DELAY_US模拟SSD时延，如：
+ * HSCFS_MOCK_IO_DELAY_US=100 ./bench_random_read 8 2>/dev/null
+ * 页缓存默认能够容纳整个测试文件，可设置环境变量HSCFS_PAGE_CACHE_BUDGET(字节数)缩小页缓存，测试缓存缺失时的性能，如：
+ * HSCFS_PAGE_CACHE_BUDGET=131072 HSCFS_MOCK_IO_DELAY_US=100 ./bench_random_read 8 2>/dev/null
+ */
+
+static const size_t block_size = 4096;
+static const size_t fsync_interval = 16;
+
+static void prepare_test_file(size_t file_blocks)
+{
+    int fd = hscfs::open("/a/b/c", O_RDWR | O_TRUNC);
+    if (fd == -1)
+        do_exit("open failed");
+
+    std::vector<char> buf(block_size);
+    for (size_t i = 0; i < file_blocks; ++i)
+    {
+        memset(buf.data(), static_cast<int>(i & 0xFF), block_size);
+        if (hscfs::write(fd, buf.data(), block_size) != ssize_t(block_size))
+            do_exit("write failed");
+
+        /* 分批fsync，使干净页能被之后写入的页置换，页缓存较小时，读测试开始时page cache中只保留最后写入的部分页 */
+        if ((i + 1) % fsync_interval == 0 || i + 1 == file_blocks)
+        {
+            if (hscfs::fsync(fd) != 0)
+                do_exit("fsync failed");
+        }
+    }
+
+    if (hscfs::close(fd) != 0)
+        do_exit("close failed");
+}
+
+static void random_read_thread(size_t idx, size_t file_blocks, size_t ops, std::atomic_size_t &err_cnt)
+{
+    int fd = hscfs::open("/a/b/c", O_RDONLY);
+    if (fd == -1)
+    {
+        ++err_cnt;
+        return;
+    }
+
+    std::mt19937 gen(idx);
+    std::uniform_int_distribution<size_t> dist(0, file_blocks - 1);
+    std::vector<char> buf(block_size);
+    for (size_t i = 0; i < ops; ++i)
+    {
+        size_t blkno = dist(gen);
+        if (hscfs::lseek(fd, blkno * block_size, SEEK_SET) == -1
+            || hscfs::read(fd, buf.data(), block_size) != ssize_t(block_size)
+            || buf[0] != static_cast<char>(blkno & 0xFF))
+            ++err_cnt;
+    }
+
+    if (hscfs::close(fd) != 0)
+        ++err_cnt;
+}
+
+int main(int argc, char **argv)
+{
+    size_t max_threads = argc > 1 ? strtoul(argv[1], nullptr, 10) : 8;
+    size_t file_blocks = argc > 2 ? strtoul(argv[2], nullptr, 10) : 256;
+    size_t ops_per_thread = argc > 3 ? strtoul(argv[3], nullptr, 10) : 2000;
+
+    host_test_env_setup();
+    prepare_test_file(file_blocks);
+
+    printf("%-10s%-15s%-15s\n", "threads", "ops/s", "MiB/s");
+    int ret = 0;
+    for (size_t th_num = 1; th_num <= max_threads; th_num *= 2)
+    {
+        std::atomic_size_t err_cnt(0);
+        std::vector<std::thread> ths;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < th_num; ++i)
+            ths.emplace_back(random_read_thread, i, file_blocks, ops_per_thread, std::ref(err_cnt));
+        for (auto &th : ths)
+            th.join();
+        auto end = std::chrono::steady_clock::now();
+
+        double sec = std::chrono::duration<double>(end - start).count();
+        double ops = static_cast<double>(th_num * ops_per_thread) / sec;
+        printf("%-10zu%-15.0f%-15.2f\n", th_num, ops, ops * block_size / (1024 * 1024));
+        if (err_cnt != 0)
+        {
+            fprintf(stderr, "%zu errors occurred with %zu threads.\n", err_cnt.load(), th_num);
+            ret = 1;
+        }
+    }
+
+    host_test_env_teardown();
+    return ret;
+}
@@ -14,25 +14,52 @@
  * *********************************************************************
  * 
  * 布局
- * 总共1034个block，其中：
- * blkno: 0          1   2   3           7     10          522         1034
+ * 与mkfs相同，segment 0从lpa 0开始，存放元数据区域，不属于主区域(INVALID_SEGID因此可以表示无效的segment)
+ * 总共1536个block(3个segment)，其中：
+ * blkno: 0          1   2   3           7     512         1024        1536
+ * segid: 0                                    1           2
  * area:  SuperBlock SIT NAT MetaJournal SRMAP NodeSegment DataSegment (没有FreeSegment)
  * 
  * *********************************************************************
  * 
  * 初始状态下，包含的文件和目录：
  * /a/b/c
- * 根目录：inode = 2，包含1个node block(lpa = 10)，1个data block(lpa = 522)，含有目录项a
+ * 根目录：inode = 2，包含1个node block(lpa = 512)，1个data block(lpa = 1024)，含有目录项a
  * 
- * 目录a：inode = 3，包含1个node block(lpa = 11)，1个data block(lpa = 523)，含有目录项b
+ * 目录a：inode = 3，包含1个node block(lpa = 513)，1个data block(lpa = 1025)，含有目录项b
  * 
- * 目录b：inode = 4，包含1个node block(lpa = 12)，1个data block(lpa = 524)，含有目录项c
+ * 目录b：inode = 4，包含1个node block(lpa = 514)，1个data block(lpa = 1026)，含有目录项c
  * 
- * 文件c：inode = 5，包含1个node block(lpa = 13)，1个data block(lpa = 525)。
+ * 文件c：inode = 5，包含1个node block(lpa = 515)，1个data block(lpa = 1027)。
  * 初始数据为：从偏移0开始的字符串"hello hscfs!"
  * 
+ * *********************************************************************
+ * 
+ * 带参数N(build_fs_image N，0 < N <= 57)时，在DataSegment后增加N个FreeSegment(segid 3 ~ N + 2)，
+ * SRMAP仍在segment 0中，覆盖所有block：
+ * blkno: 0          1   2   3           7     512         1024        1536                    1536 + 512 * N
+ * area:  SuperBlock SIT NAT MetaJournal SRMAP NodeSegment DataSegment FreeSegment * N
+ * 
  */
 
+static uint32_t free_segment_num = 0;
+
+/* 主区域从segment 1开始，node segment和data segment的起始lpa */
+static const uint32_t node_seg_lpa = BLOCK_PER_SEGMENT;
+static const uint32_t data_seg_lpa = 2 * BLOCK_PER_SEGMENT;
+static const uint32_t srmap_blkaddr = 7;
+
+/* segment总数，包括segment 0 */
+static uint32_t get_segment_count()
+{
+    return 3 + free_segment_num;
+}
+
+static uint32_t get_block_count()
+{
+    return get_segment_count() * BLOCK_PER_SEGMENT;
+}
+
 void do_write(int fd, void *buffer, size_t count)
 {
     if (write(fd, buffer, count) < ssize_t(count))
@@ -49,31 +76,31 @@ void generate_super_block(void *buffer)
 {
     hscfs_super_block *super = static_cast<hscfs_super_block*>(buffer);
     memset(super, 0, sizeof(hscfs_super_block));
-    super->block_count = 1034;
-    super->segment_count = 2;
+    super->block_count = get_block_count();
+    super->segment_count = get_segment_count();
     super->segment_count_sit = 1; // 代码中只用来做正确性判断，此处写1不影响，以下同理
     super->segment_count_nat = 1;
     super->segment_count_srmap = 1;
     super->segment_count_meta_journal = 1;
-    super->segment_count_main = 2;
-    super->segment0_blkaddr = 10; // NodeSegment起始位置
+    super->segment_count_main = get_segment_count() - 1;
+    super->segment0_blkaddr = 0;
     super->sit_blkaddr = 1;
     super->nat_blkaddr = 2;
-    super->srmap_blkaddr = 7;
+    super->srmap_blkaddr = srmap_blkaddr;
     super->meta_journal_blkaddr = 3;
-    super->main_blkaddr = 10;
+    super->main_blkaddr = node_seg_lpa;
     super->root_ino = 2;
 
-    super->first_free_segment_id = HSCFS_MAX_SEGMENT;
-    super->first_data_segment_id = HSCFS_MAX_SEGMENT;
-    super->first_node_segment_id = HSCFS_MAX_SEGMENT;
-    super->current_data_segment_id = 1;
+    super->first_free_segment_id = free_segment_num == 0 ? INVALID_SEGID : 3;
+    super->first_data_segment_id = INVALID_SEGID;
+    super->first_node_segment_id = INVALID_SEGID;
+    super->current_data_segment_id = 2;
     super->current_data_segment_blkoff = 4;
-    super->current_node_segment_id = 0;
+    super->current_node_segment_id = 1;
     super->current_node_segment_blkoff = 4;
     super->meta_journal_start_blkoff = 3;
     super->meta_journal_end_blkoff = 7;
-    super->free_segment_count = 0;
+    super->free_segment_count = free_segment_num;
     super->next_free_nid = 6;
 }
 
@@ -82,19 +109,38 @@ void generate_sit(void *buffer)
     hscfs_sit_block *sit = static_cast<hscfs_sit_block*>(buffer);
     memset(sit, 0, sizeof(hscfs_sit_block));
 
-    /* node 和 data segment内前4个block有效，位图中首元素为1111b */
-    for (int i = 0; i < 2; ++i)
+    /* node 和 data segment(segid 1、2)内前4个block有效，位图中首元素为1111b */
+    for (int i = 1; i <= 2; ++i)
     {
         sit->entries[i].valid_map[0] = 15;
         sit->entries[i].vblocks = 4;
     }
+
+    /* 空闲segment链表：3 -> 4 -> ... -> N + 2，链表尾的next为INVALID_SEGID */
+    for (uint32_t segid = 3; segid + 1 < get_segment_count(); ++segid)
+        SET_NEXT_SEG(&sit->entries[segid], segid + 1);
+}
+
+/* 初始的8个block的反向映射：node block在第1个SRMAP块中，data block在第2个SRMAP块中 */
+void write_srmap(int fd)
+{
+    static_assert(BLOCK_PER_SEGMENT == ENTRIES_IN_SUM, "one SRMAP block per segment");
+    hscfs_summary_block srmap[2];
+    memset(srmap, 0, sizeof(srmap));
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        srmap[0].entries[i].nid = 2 + i;  // node block
+        srmap[1].entries[i].nid = 2 + i;  // data block，块偏移为0
+    }
+    do_lseek(fd, (srmap_blkaddr + node_seg_lpa / ENTRIES_IN_SUM) * 4096, SEEK_SET);
+    do_write(fd, srmap, sizeof(srmap));
 }
 
 void generate_nat(void *buffer)
 {
     hscfs_nat_block *nat = static_cast<hscfs_nat_block*>(buffer);
     memset(nat, 0, sizeof(hscfs_nat_block));
-    for (uint32_t i = 0, ino_base = 2, lpa_base = 10; i < 4; ++i)
+    for (uint32_t i = 0, ino_base = 2, lpa_base = node_seg_lpa; i < 4; ++i)
     {
         uint32_t nid = ino_base + i;
         nat->entries[nid].ino = nid;
@@ -226,7 +272,7 @@ void write_dir_and_file(int fd)
     auto node = reinterpret_cast<hscfs_node*>(buffer);
 
     /* 写node blocks */
-    for (uint32_t i = 0, ino_base = 2, node_lpa_base = 10, data_lpa_base = 522; i < 4; ++i)
+    for (uint32_t i = 0, ino_base = 2, node_lpa_base = node_seg_lpa, data_lpa_base = data_seg_lpa; i < 4; ++i)
     {
         memset(node, 0, sizeof(hscfs_node));
         uint32_t ino = ino_base + i;
@@ -250,7 +296,7 @@ void write_dir_and_file(int fd)
     /* 写data blocks */
     auto dir_blk = reinterpret_cast<hscfs_dentry_block*>(buffer);
     std::string dentrys[3] = {"a", "b", "c"};
-    for (uint32_t i = 0, data_lpa_base = 522, ino_base = 3; i < 3; ++i)
+    for (uint32_t i = 0, data_lpa_base = data_seg_lpa, ino_base = 3; i < 3; ++i)
     {
         memset(dir_blk, 0, sizeof(hscfs_dentry_block));
         write_dentry_in_dir_block(dir_blk, dentrys[i], i == 2 ? HSCFS_FT_REG_FILE : HSCFS_FT_DIR, ino_base + i);
@@ -261,7 +307,7 @@ void write_dir_and_file(int fd)
 
     memset(buffer, 0, 4096);
     memcpy(buffer, test_file_content, sizeof(test_file_content));
-    do_lseek(fd, 525 * 4096, SEEK_SET);
+    do_lseek(fd, (data_seg_lpa + 3) * 4096, SEEK_SET);
     do_write(fd, buffer, 4096);
 }
 
@@ -281,11 +327,23 @@ void build_test_image(int fd)
     do_lseek(fd, 2 * 4096, SEEK_SET);
     do_write(fd, buffer, 4096);
 
-    write_dir_and_file(fd);   
+    write_dir_and_file(fd);
+    write_srmap(fd);
+
+    /* 将镜像扩展到完整大小 */
+    if (ftruncate(fd, static_cast<off_t>(get_block_count()) * 4096) == -1)
+        throw std::runtime_error("ftruncate error");
 }
 
-int main()
+int main(int argc, char *argv[])
 {
+    if (argc > 1)
+    {
+        free_segment_num = strtoul(argv[1], nullptr, 10);
+        if (get_segment_count() > SIT_ENTRY_PER_BLOCK)
+            throw std::runtime_error("too many free segments");
+    }
+
     int fd = open("./fsImage", O_WRONLY | O_CREAT | O_TRUNC, S_IRWXU);
     if (fd == -1)
         throw std::runtime_error("open error");
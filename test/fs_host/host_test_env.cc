@@ -2,6 +2,7 @@
 #include "fs/fs.h"
 #include "fs/path_utils.hh"
 #include "fs/server_thread.hh"
+#include "fs/NAT_utils.hh"
 #include "cache/super_cache.hh"
 #include "journal/journal_process_env.hh"
 #include "communication/comm_api.h"
@@ -12,10 +13,14 @@
 #include <unordered_map>
 #include <cassert>
 #include <iostream>
+#include <cstdlib>
 
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <sys/uio.h>
+#include <atomic>
+#include <thread>
 
 using namespace hscfs;
 
@@ -26,6 +31,9 @@ struct journal_area_mock
 
 int fd;
 std::mutex rw_mtx;
+std::atomic<uint64_t> write_cmd_num(0);  // 收到的写命令数
+std::atomic<uint64_t> read_cmd_num(0);  // 收到的读命令数
+std::atomic_bool journal_apply_held(false);  // 是否暂停应用日志
 
 #define LBA_SIZE 512
 
@@ -40,7 +48,12 @@ void host_test_env_setup()
 {
     host_mock_init();
 
-    file_system_manager::init(nullptr);
+    /* 可通过环境变量HSCFS_PAGE_CACHE_BUDGET设置页缓存内存预算(字节数) */
+    size_t page_cache_budget = file_system_manager::default_page_cache_budget;
+    const char *budget_env = getenv("HSCFS_PAGE_CACHE_BUDGET");
+    if (budget_env != nullptr && strtoull(budget_env, nullptr, 10) != 0)
+        page_cache_budget = strtoull(budget_env, nullptr, 10);
+    file_system_manager::init(nullptr, page_cache_budget);
     file_system_manager *fs_manager = file_system_manager::get_instance();
     super_cache &super = *(fs_manager->get_super_cache());
     
@@ -59,6 +72,21 @@ void host_test_env_teardown()
     close(fd);
 }
 
+uint64_t host_test_env_get_write_cmd_num()
+{
+    return write_cmd_num.load();
+}
+
+uint64_t host_test_env_get_read_cmd_num()
+{
+    return read_cmd_num.load();
+}
+
+void host_test_env_hold_journal_apply(bool hold)
+{
+    journal_apply_held = hold;
+}
+
 void do_exit(const char *msg)
 {
     perror(msg);
@@ -103,16 +131,52 @@ static void print_block(uint64_t lpa)
 
 extern "C" {
 
+/* 
+ * 模拟SSD的I/O时延(微秒)，由环境变量HSCFS_MOCK_IO_DELAY_US设置，默认为0
+ * 时延在rw_mtx外模拟，使并发的I/O能够重叠，用于测试多线程的性能
+ */
+static unsigned long get_mock_io_delay_us()
+{
+    static const unsigned long delay_us = []() {
+        const char *env = getenv("HSCFS_MOCK_IO_DELAY_US");
+        return env == nullptr ? 0UL : strtoul(env, nullptr, 10);
+    }();
+    return delay_us;
+}
+
+/* 
+ * 模拟SSD执行path lookup和file mapping查询命令的时延(微秒)，由环境变量HSCFS_MOCK_OFFLOAD_DELAY_US设置
+ * 默认与I/O时延相同，可设置得更大以模拟SSD繁忙
+ */
+static unsigned long get_mock_offload_delay_us()
+{
+    static const unsigned long delay_us = []() {
+        const char *env = getenv("HSCFS_MOCK_OFFLOAD_DELAY_US");
+        return env == nullptr ? get_mock_io_delay_us() : strtoul(env, nullptr, 10);
+    }();
+    return delay_us;
+}
+
 int comm_submit_sync_rw_request(comm_dev *dev, void *buffer, uint64_t lba, uint32_t lba_count, 
     comm_io_direction dir)
 {
+    unsigned long delay_us = get_mock_io_delay_us();
+    if (delay_us != 0)
+        usleep(delay_us);
+
     std::lock_guard<std::mutex> lg(rw_mtx);
     size_t count = lba_count * LBA_SIZE;
     off_t offset = lba * LBA_SIZE;
     if (dir == comm_io_direction::COMM_IO_READ)
+    {
         do_pread(fd, buffer, count, offset);
+        ++read_cmd_num;
+    }
     else
+    {
         do_pwrite(fd, buffer, count, offset);
+        ++write_cmd_num;
+    }
     return 0;
 }
 
@@ -124,8 +188,42 @@ int comm_submit_async_rw_request(comm_dev *dev, void *buffer, uint64_t lba, uint
     return 0;
 }
 
+/* 向量读写一次完成，记为一个读或写命令 */
+int comm_submit_sync_rwv_request(comm_dev *dev, const struct iovec *iov, int iovcnt, uint64_t lba, uint32_t lba_count, 
+    comm_io_direction dir)
+{
+    unsigned long delay_us = get_mock_io_delay_us();
+    if (delay_us != 0)
+        usleep(delay_us);
+
+    std::lock_guard<std::mutex> lg(rw_mtx);
+    ssize_t count = lba_count * LBA_SIZE;
+    off_t offset = lba * LBA_SIZE;
+    if (dir == comm_io_direction::COMM_IO_READ)
+    {
+        if (preadv(fd, iov, iovcnt, offset) < count)
+            throw std::runtime_error("readv error");
+        ++read_cmd_num;
+    }
+    else
+    {
+        if (pwritev(fd, iov, iovcnt, offset) < count)
+            throw std::runtime_error("writev error");
+        ++write_cmd_num;
+    }
+    return 0;
+}
+
+int comm_submit_async_rwv_request(comm_dev *dev, const struct iovec *iov, int iovcnt, uint64_t lba, uint32_t lba_count,
+    comm_async_cb_func cb_func, void *cb_arg, comm_io_direction dir)
+{
+    comm_submit_sync_rwv_request(dev, iov, iovcnt, lba, lba_count, dir);
+    cb_func(comm_cmd_result::COMM_CMD_SUCCESS, cb_arg);
+    return 0;
+}
+
 /* 模拟，直接返回fsImage上的数据 */
-int comm_submit_sync_path_lookup_request(comm_dev *dev, path_lookup_task *task, size_t task_length, path_lookup_result *res)
+static void mock_path_lookup(path_lookup_task *task, path_lookup_result *res)
 {
     static std::unordered_map<std::string, uint32_t> dentry_ino_map = {
         {"a", 3}, {"b", 4}, {"c", 5}
@@ -140,6 +238,14 @@ int comm_submit_sync_path_lookup_request(comm_dev *dev, path_lookup_task *task,
     uint32_t cur_idx = 0;
     uint32_t parent_ino = task->start_ino;
 
+    /* 返回父目录的inode及其第0个数据块。mock不应用日志，从主机侧的NAT表得到inode的位置 */
+    auto read_parent_dir_pages = [res](uint32_t dir_ino) {
+        uint32_t lpa = nat_lpa_mapping(file_system_manager::get_instance()).get_lpa_of_nid(dir_ino);
+        do_pread(fd, res->parent_dir_node_page, 4096, static_cast<off_t>(lpa) * 4096);
+        hscfs_node *node = reinterpret_cast<hscfs_node*>(res->parent_dir_node_page);
+        do_pread(fd, res->parent_dir_data_page, 4096, static_cast<off_t>(node->i.i_addr[0]) * 4096);
+    };
+
     for (auto it = p_parser.begin(); it != p_parser.end(); it.next(), ++cur_idx)
     {
         auto name = it.get();
@@ -149,40 +255,91 @@ int comm_submit_sync_path_lookup_request(comm_dev *dev, path_lookup_task *task,
             res->path_inos[cur_idx] = INVALID_NID;
             if (it.is_last_component(p_parser.end()))
             {
+                /* 目标不存在但父目录存在，返回插入位置及其所在的父目录块 */
                 res->dentry_blkidx = 0;
                 res->dentry_bitpos = 1;
+                if (ino_next.count(parent_ino) != 0)
+                    read_parent_dir_pages(parent_ino);
             }
             break;
         }
 
         uint32_t cur_ino = dentry_ino_map.at(name);
         res->path_inos[cur_idx] = cur_ino;
-        parent_ino = cur_ino;
         if (it.is_last_component(p_parser.end()))
         {
             res->dentry_blkidx = 0;
             res->dentry_bitpos = 0;
+            read_parent_dir_pages(parent_ino);
         }
+        parent_ino = cur_ino;
     }
+}
+
+int comm_submit_sync_path_lookup_request(comm_dev *dev, path_lookup_task *task, size_t task_length, path_lookup_result *res)
+{
+    unsigned long delay_us = get_mock_offload_delay_us();
+    if (delay_us != 0)
+        usleep(delay_us);
+    mock_path_lookup(task, res);
+    return 0;
+}
 
+/* 
+ * 每个命令在独立的线程中模拟时延，使并发下发的命令的时延能够重叠
+ * 查找本身互斥执行，它会访问NAT缓存，而下发命令的线程持有fs_meta_lock等待所有命令完成
+ */
+int comm_submit_async_path_lookup_request(comm_dev *dev, path_lookup_task *task, size_t task_length, path_lookup_result *res, 
+    comm_async_cb_func cb_func, void *cb_arg)
+{
+    static std::mutex lookup_mtx;
+    std::thread([=]() {
+        unsigned long delay_us = get_mock_offload_delay_us();
+        if (delay_us != 0)
+            usleep(delay_us);
+        {
+            std::lock_guard<std::mutex> lg(lookup_mtx);
+            mock_path_lookup(task, res);
+        }
+        cb_func(comm_cmd_result::COMM_CMD_SUCCESS, cb_arg);
+    }).detach();
     return 0;
 }
 
 int comm_submit_sync_filemapping_search_request(comm_dev *dev, filemapping_search_task *task, 
     void *res, uint32_t res_len)
 {
-    static std::unordered_map<uint32_t, uint32_t> ino_lpa_map = {
-        {2, 10}, {3, 11}, {4, 12}, {5, 13}
-    };
-
     assert(task->nid_to_start == task->ino);
     assert(res_len == 4096);
+    unsigned long delay_us = get_mock_offload_delay_us();
+    if (delay_us != 0)
+        usleep(delay_us);
 
-    off_t offset = ino_lpa_map[task->ino] * 4096;
+    /* mock不应用日志，从主机侧的NAT表得到inode的位置。调用者持有fs_meta_lock */
+    uint32_t lpa = nat_lpa_mapping(file_system_manager::get_instance()).get_lpa_of_nid(task->ino);
+    off_t offset = static_cast<off_t>(lpa) * 4096;
     do_pread(fd, res, res_len, offset);
     return 0;
 }
 
+/* 模拟，将位图中标记的第i个块复制到dst + i */
+int comm_submit_sync_migrate_request(comm_dev *dev, migrate_task *task)
+{
+    std::lock_guard<std::mutex> lg(rw_mtx);
+    char buffer[4096];
+    uint32_t cnt = 0;
+    for (uint32_t off = 0; off < BLOCK_PER_SEGMENT && cnt < task->migrate_lpa_cnt; ++off)
+    {
+        if (!(task->victim_seg_info.valid_map[off / 8] & (1U << (off % 8))))
+            continue;
+        do_pread(fd, buffer, 4096, (task->migrate_src_lpa + off) * 4096);
+        do_pwrite(fd, buffer, 4096, (task->migrate_dst_lpa + cnt) * 4096);
+        ++cnt;
+    }
+    assert(cnt == task->migrate_lpa_cnt);
+    return 0;
+}
+
 int comm_submit_sync_update_metajournal_tail_request(comm_dev *dev, uint64_t origin_lpa, uint32_t write_block_num)
 {
     if (origin_lpa != journal_area.tail_lpa)
@@ -208,7 +365,7 @@ int comm_submit_sync_update_metajournal_tail_request(comm_dev *dev, uint64_t ori
     return 0;
 }
 
-/* mock获取头指针，将头指针推进upper(unapplied_lpa_num / 2)，并print出推进的日志内容 */
+/* mock获取头指针，将头指针推进upper(unapplied_lpa_num / 2)，并print出推进的日志内容。暂停应用日志时不推进 */
 int comm_submit_sync_get_metajournal_head_request(comm_dev *dev, uint64_t *head_lpa)
 {
     auto get_unapplied_lpa_num = [](const journal_area_mock &journal)
@@ -220,7 +377,7 @@ int comm_submit_sync_get_metajournal_head_request(comm_dev *dev, uint64_t *head_
     };
 
     uint64_t unapplied = get_unapplied_lpa_num(journal_area);
-    if (unapplied == 0)
+    if (unapplied == 0 || journal_apply_held)
     {
         *head_lpa = journal_area.head_lpa;
         return 0;
@@ -257,7 +414,7 @@ struct spdk_nvme_ns{
 
 void *spdk_zmalloc(size_t size, size_t align, uint64_t *phys_addr, int socket_id, uint32_t flags)
 {
-    return malloc(size);
+    return calloc(1, size);
 }
 
 void spdk_free(void *buf)
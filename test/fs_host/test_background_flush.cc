@@ -0,0 +1,137 @@
+#include "api/hscfs.hh"
+#include "cache/node_block_cache.hh"
+#include "fs/fs_manager.hh"
+#include "fs/fd_array.hh"
+#include "fs/opened_file.hh"
+#include "fs/file.hh"
+#include "fs/background_flusher.hh"
+#include "gtest/gtest.h"
+#include "host_test_env.hh"
+#include <cstring>
+#include <chrono>
+#include <thread>
+#include <functional>
+
+using namespace hscfs;
+
+static uint32_t get_ino_of_fd(int fd)
+{
+    file_system_manager *fs_manager = file_system_manager::get_instance();
+    return fs_manager->get_fd_array()->get_opened_file_of_fd(fd)->get_file_handle()->get_inode();
+}
+
+/* 后台回写会并发访问缓存，检查时加fs_meta_lock */
+static bool is_inode_dirty(uint32_t ino)
+{
+    file_system_manager *fs_manager = file_system_manager::get_instance();
+    std::lock_guard<std::mutex> lg(fs_manager->get_fs_meta_lock());
+    node_block_cache_entry_handle handle = fs_manager->get_node_cache()->get(ino);
+    return !handle.is_empty() && handle->get_state() == node_block_cache_entry_state::dirty;
+}
+
+static size_t get_dirty_file_num()
+{
+    return file_system_manager::get_instance()->get_file_obj_cache()->get_dirty_file_num();
+}
+
+/* 每10ms检查一次，直到pred成立或超时 */
+static bool wait_until(const std::function<bool()> &pred, std::chrono::milliseconds timeout)
+{
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (!pred())
+    {
+        if (std::chrono::steady_clock::now() >= deadline)
+            return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return true;
+}
+
+/* 脏数据超时后，不需要fsync也会被后台回写 */
+TEST(background_flush_test, expire)
+{
+    background_flusher *flusher = file_system_manager::get_instance()->get_background_flusher();
+    flush_policy origin = flusher->get_policy();
+    flush_stat before = flusher->get_stat();
+
+    int fd = hscfs::open("/a/b/bg1", O_RDWR | O_CREAT);
+    ASSERT_NE(fd, -1);
+    uint32_t ino = get_ino_of_fd(fd);
+    char buf[4096];
+    memset(buf, 3, sizeof(buf));
+    ASSERT_EQ(hscfs::write(fd, buf, sizeof(buf)), ssize_t(sizeof(buf)));
+
+    flush_policy policy = origin;
+    policy.period = std::chrono::milliseconds(20);
+    policy.dirty_expire = std::chrono::milliseconds(0);
+    flusher->set_policy(policy);
+    EXPECT_TRUE(wait_until([ino] { return get_dirty_file_num() == 0 && !is_inode_dirty(ino); },
+        std::chrono::milliseconds(2000)));
+    flusher->set_policy(origin);
+
+    flush_stat after = flusher->get_stat();
+    EXPECT_GE(after.file_num, before.file_num + 1);
+    EXPECT_GT(after.tx_num, before.tx_num);
+
+    memset(buf, 0, sizeof(buf));
+    ASSERT_EQ(hscfs::lseek(fd, 0, SEEK_SET), 0);
+    ASSERT_EQ(hscfs::read(fd, buf, sizeof(buf)), ssize_t(sizeof(buf)));
+    EXPECT_EQ(buf[0], 3);
+    EXPECT_EQ(buf[4095], 3);
+    ASSERT_EQ(hscfs::close(fd), 0);
+}
+
+/* 脏页总数超过限制时，从最早变脏的文件开始回写，直到剩余脏页数不超过限制 */
+TEST(background_flush_test, dirty_pages_limit)
+{
+    background_flusher *flusher = file_system_manager::get_instance()->get_background_flusher();
+    flush_policy origin = flusher->get_policy();
+
+    int fd1 = hscfs::open("/a/b/bg2", O_RDWR | O_CREAT);
+    int fd2 = hscfs::open("/a/b/bg3", O_RDWR | O_CREAT);
+    ASSERT_NE(fd1, -1);
+    ASSERT_NE(fd2, -1);
+    ASSERT_EQ(hscfs::fsync(fd1), 0);
+    ASSERT_EQ(hscfs::fsync(fd2), 0);
+
+    flush_policy policy = origin;
+    policy.period = std::chrono::milliseconds(20);
+    policy.dirty_expire = std::chrono::hours(1);
+    policy.dirty_pages_limit = 2;
+    flusher->set_policy(policy);
+
+    /* 
+     * bg2有8个脏页，bg3只有1个脏页。更早变脏的文件(如上一个测试中读取后更新了atime的bg1)和bg2一起被回写，
+     * 之后剩余脏页数未超出限制，bg3保持dirty
+     */
+    char buf[4096 * 8];
+    memset(buf, 4, sizeof(buf));
+    ASSERT_EQ(hscfs::write(fd1, buf, sizeof(buf)), ssize_t(sizeof(buf)));
+    ASSERT_EQ(hscfs::write(fd2, buf, 4096), 4096);
+    EXPECT_TRUE(wait_until([] { return get_dirty_file_num() == 1; }, std::chrono::milliseconds(2000)));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_EQ(get_dirty_file_num(), 1);
+    flusher->set_policy(origin);
+
+    /* 只剩bg3需要fsync回写 */
+    ASSERT_EQ(hscfs::fsync(fd2), 0);
+    EXPECT_EQ(get_dirty_file_num(), 0);
+    EXPECT_FALSE(is_inode_dirty(get_ino_of_fd(fd1)));
+
+    memset(buf, 0, sizeof(buf));
+    ASSERT_EQ(hscfs::lseek(fd1, 0, SEEK_SET), 0);
+    ASSERT_EQ(hscfs::read(fd1, buf, sizeof(buf)), ssize_t(sizeof(buf)));
+    EXPECT_EQ(buf[0], 4);
+    EXPECT_EQ(buf[sizeof(buf) - 1], 4);
+    ASSERT_EQ(hscfs::close(fd1), 0);
+    ASSERT_EQ(hscfs::close(fd2), 0);
+}
+
+int main(int argc, char **argv)
+{
+    host_test_env_setup();
+    ::testing::InitGoogleTest(&argc, argv);
+    int ret = RUN_ALL_TESTS();
+    host_test_env_teardown();
+    return ret;
+}
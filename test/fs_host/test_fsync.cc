@@ -0,0 +1,359 @@
+#include "api/hscfs.hh"
+#include "cache/node_block_cache.hh"
+#include "fs/fs_manager.hh"
+#include "fs/fd_array.hh"
+#include "fs/opened_file.hh"
+#include "fs/file.hh"
+#include "fs/group_commit.hh"
+#include "fs/file_utils.hh"
+#include "fs/super_manager.hh"
+#include "fs/SIT_utils.hh"
+#include "fs/replace_protect.hh"
+#include "journal/journal_container.hh"
+#include "journal/journal_process_env.hh"
+#include "gtest/gtest.h"
+#include "host_test_env.hh"
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace hscfs;
+
+static uint32_t get_ino_of_fd(int fd)
+{
+    file_system_manager *fs_manager = file_system_manager::get_instance();
+    return fs_manager->get_fd_array()->get_opened_file_of_fd(fd)->get_file_handle()->get_inode();
+}
+
+static bool is_inode_dirty(uint32_t ino)
+{
+    node_block_cache *node_cache = file_system_manager::get_instance()->get_node_cache();
+    node_block_cache_entry_handle handle = node_cache->get(ino);
+    return !handle.is_empty() && handle->get_state() == node_block_cache_entry_state::dirty;
+}
+
+/* 由SIT表项的位图判断lpa是否有效。调用者持有fs_meta_lock */
+static bool is_lpa_valid(uint32_t lpa)
+{
+    SIT_operator sit_operator(file_system_manager::get_instance());
+    std::pair<uint32_t, uint32_t> pos = sit_operator.get_seg_pos_of_lpa(lpa);
+    hscfs_sit_entry entry = sit_operator.get_sit_entry(pos.first);
+    return entry.valid_map[pos.second / 8] & (1U << (pos.second % 8));
+}
+
+/* fsync只回写该文件的元数据，与当前日志无关的其它文件的脏元数据保持dirty */
+TEST(fsync_test, scoped)
+{
+    int fd1 = hscfs::open("/a/b/f1", O_RDWR | O_CREAT);
+    int fd2 = hscfs::open("/a/b/f2", O_RDWR | O_CREAT);
+    ASSERT_NE(fd1, -1);
+    ASSERT_NE(fd2, -1);
+    uint32_t ino1 = get_ino_of_fd(fd1), ino2 = get_ino_of_fd(fd2);
+
+    /* 两个文件在同一事务中创建，互相依赖，fsync一个文件时会一起提交 */
+    ASSERT_EQ(hscfs::fsync(fd1), 0);
+    ASSERT_FALSE(is_inode_dirty(ino1));
+    ASSERT_FALSE(is_inode_dirty(ino2));
+
+    /* f2扩展文件大小，只修改了inode，不产生日志 */
+    ASSERT_EQ(hscfs::truncate(fd2, 8192), 0);
+    char buf[4096];
+    memset(buf, 1, sizeof(buf));
+    ASSERT_EQ(hscfs::write(fd1, buf, sizeof(buf)), ssize_t(sizeof(buf)));
+    ASSERT_EQ(hscfs::fsync(fd1), 0);
+    EXPECT_FALSE(is_inode_dirty(ino1));
+    EXPECT_TRUE(is_inode_dirty(ino2));
+
+    ASSERT_EQ(hscfs::fsync(fd2), 0);
+    EXPECT_FALSE(is_inode_dirty(ino2));
+
+    memset(buf, 0, sizeof(buf));
+    ASSERT_EQ(hscfs::lseek(fd1, 0, SEEK_SET), 0);
+    ASSERT_EQ(hscfs::read(fd1, buf, sizeof(buf)), ssize_t(sizeof(buf)));
+    EXPECT_EQ(buf[0], 1);
+    EXPECT_EQ(buf[4095], 1);
+
+    ASSERT_EQ(hscfs::close(fd1), 0);
+    ASSERT_EQ(hscfs::close(fd2), 0);
+}
+
+/* fsync返回时，此前提交的所有事务日志都已写入SSD */
+TEST(fsync_test, journal_persisted)
+{
+    int fd = hscfs::open("/a/b/p1", O_RDWR | O_CREAT);
+    ASSERT_NE(fd, -1);
+    char buf[4096];
+    memset(buf, 2, sizeof(buf));
+    journal_process_env *env = journal_process_env::get_instance();
+    for (int i = 0; i < 4; ++i)
+    {
+        ASSERT_EQ(hscfs::write(fd, buf, sizeof(buf)), ssize_t(sizeof(buf)));
+        ASSERT_EQ(hscfs::fsync(fd), 0);
+        EXPECT_GE(env->get_persisted_tx_end(), env->get_committed_tx_end());
+    }
+    ASSERT_EQ(hscfs::close(fd), 0);
+}
+
+/* 删除文件会修改目录，fsync目录中的另一个文件时，被删除文件的元数据一起提交 */
+TEST(fsync_test, dependent_on_unlink)
+{
+    int fd1 = hscfs::open("/a/b/f3", O_RDWR | O_CREAT);
+    int fd2 = hscfs::open("/a/b/f4", O_RDWR | O_CREAT);
+    ASSERT_NE(fd1, -1);
+    ASSERT_NE(fd2, -1);
+    uint32_t ino2 = get_ino_of_fd(fd2);
+    ASSERT_EQ(hscfs::fsync(fd1), 0);
+
+    ASSERT_EQ(hscfs::truncate(fd2, 8192), 0);
+    ASSERT_EQ(hscfs::unlink("/a/b/f4"), 0);
+    ASSERT_TRUE(is_inode_dirty(ino2));
+    ASSERT_EQ(hscfs::fsync(fd1), 0);
+    EXPECT_FALSE(is_inode_dirty(ino2));
+
+    ASSERT_EQ(hscfs::close(fd1), 0);
+    ASSERT_EQ(hscfs::close(fd2), 0);
+}
+
+/* 一次回写的多个数据块从活跃segment中一次预留，分配到连续的lpa */
+TEST(fsync_test, reserve_contiguous_lpa)
+{
+    const uint32_t blk_num = 16;
+    int fd = hscfs::open("/a/b/f5", O_RDWR | O_CREAT);
+    ASSERT_NE(fd, -1);
+    char buf[4096];
+    memset(buf, 3, sizeof(buf));
+    for (uint32_t i = 0; i < blk_num; ++i)
+        ASSERT_EQ(hscfs::write(fd, buf, sizeof(buf)), ssize_t(sizeof(buf)));
+    ASSERT_EQ(hscfs::fsync(fd), 0);
+
+    uint32_t ino = get_ino_of_fd(fd);
+    file_system_manager *fs_manager = file_system_manager::get_instance();
+    {
+        std::lock_guard<std::mutex> lg(fs_manager->get_fs_meta_lock());
+        file_mapping_util fm_util(fs_manager);
+        uint32_t min_lpa = UINT32_MAX, max_lpa = 0;
+        for (uint32_t i = 0; i < blk_num; ++i)
+        {
+            uint32_t lpa = fm_util.get_addr_of_block(ino, i).lpa;
+            ASSERT_NE(lpa, INVALID_LPA);
+            min_lpa = std::min(min_lpa, lpa);
+            max_lpa = std::max(max_lpa, lpa);
+        }
+        EXPECT_EQ(max_lpa - min_lpa, blk_num - 1);
+
+        /* 一次预留只记录一条super block日志和一条SIT日志 */
+        journal_container *journal = fs_manager->get_cur_journal();
+        size_t super_entries = journal->get_super_block_journal().size();
+        size_t sit_entries = journal->get_SIT_journal().size();
+        std::pair<uint32_t, uint32_t> range = fs_manager->get_super_manager()->reserve_data_lpas(blk_num);
+        EXPECT_EQ(range.second - range.first, blk_num);
+        EXPECT_EQ(journal->get_super_block_journal().size(), super_entries + 1);
+        EXPECT_EQ(journal->get_SIT_journal().size(), sit_entries + 1);
+
+        SIT_operator sit_operator(fs_manager);
+        for (uint32_t lpa = range.first; lpa < range.second; ++lpa)
+            sit_operator.invalidate_lpa(lpa);
+    }
+    ASSERT_EQ(hscfs::close(fd), 0);
+}
+
+/* LPA连续的数据块合并为一个写命令 */
+TEST(fsync_test, coalesce_writes)
+{
+    const uint32_t blk_num = 16;
+    int fd = hscfs::open("/a/b/f6", O_RDWR | O_CREAT);
+    ASSERT_NE(fd, -1);
+    ASSERT_EQ(hscfs::fsync(fd), 0);
+
+    char buf[4096];
+    for (uint32_t i = 0; i < blk_num; ++i)
+    {
+        memset(buf, i, sizeof(buf));
+        ASSERT_EQ(hscfs::write(fd, buf, sizeof(buf)), ssize_t(sizeof(buf)));
+    }
+    uint64_t write_cmds = host_test_env_get_write_cmd_num();
+    ASSERT_EQ(hscfs::fsync(fd), 0);
+    EXPECT_LT(host_test_env_get_write_cmd_num() - write_cmds, blk_num);
+
+    /* 关闭后重新打开，从SSD读出检查 */
+    ASSERT_EQ(hscfs::close(fd), 0);
+    fd = hscfs::open("/a/b/f6", O_RDONLY);
+    ASSERT_NE(fd, -1);
+    for (uint32_t i = 0; i < blk_num; ++i)
+    {
+        ASSERT_EQ(hscfs::read(fd, buf, sizeof(buf)), ssize_t(sizeof(buf)));
+        EXPECT_EQ(buf[0], char(i));
+        EXPECT_EQ(buf[4095], char(i));
+    }
+    ASSERT_EQ(hscfs::close(fd), 0);
+}
+
+/* 覆盖整个page的写不从SSD读旧内容，回写时仍能将旧lpa无效化 */
+TEST(fsync_test, full_page_overwrite)
+{
+    /* 镜像中的/a/b/c有一个数据块，此前未被访问，不在page cache中 */
+    int fd = hscfs::open("/a/b/c", O_RDWR);
+    ASSERT_NE(fd, -1);
+    uint32_t ino = get_ino_of_fd(fd);
+    file_system_manager *fs_manager = file_system_manager::get_instance();
+    uint32_t old_lpa;
+    {
+        std::lock_guard<std::mutex> lg(fs_manager->get_fs_meta_lock());
+        old_lpa = file_mapping_util(fs_manager).get_addr_of_block(ino, 0).lpa;
+        ASSERT_NE(old_lpa, INVALID_LPA);
+        ASSERT_TRUE(is_lpa_valid(old_lpa));
+    }
+
+    char buf[4096];
+    memset(buf, 'o', sizeof(buf));
+    uint64_t read_cmds = host_test_env_get_read_cmd_num();
+    ASSERT_EQ(hscfs::write(fd, buf, sizeof(buf)), ssize_t(sizeof(buf)));
+    EXPECT_EQ(host_test_env_get_read_cmd_num(), read_cmds);
+    ASSERT_EQ(hscfs::fsync(fd), 0);
+
+    {
+        std::lock_guard<std::mutex> lg(fs_manager->get_fs_meta_lock());
+        uint32_t new_lpa = file_mapping_util(fs_manager).get_addr_of_block(ino, 0).lpa;
+        EXPECT_NE(new_lpa, INVALID_LPA);
+        EXPECT_NE(new_lpa, old_lpa);
+        EXPECT_FALSE(is_lpa_valid(old_lpa));
+    }
+
+    ASSERT_EQ(hscfs::lseek(fd, 0, SEEK_SET), 0);
+    memset(buf, 0, sizeof(buf));
+    ASSERT_EQ(hscfs::read(fd, buf, sizeof(buf)), ssize_t(sizeof(buf)));
+    EXPECT_EQ(buf[0], 'o');
+    EXPECT_EQ(buf[4095], 'o');
+    ASSERT_EQ(hscfs::close(fd), 0);
+}
+
+/* 事务提交后记录其修改的文件，只等待与某文件相关的事务被SSD应用，与其无关的文件不需要等待 */
+TEST(fsync_test, per_ino_journal_wait)
+{
+    int fd = hscfs::open("/a/b/p2", O_RDWR | O_CREAT);
+    ASSERT_NE(fd, -1);
+    uint32_t ino = get_ino_of_fd(fd);
+    char buf[4096];
+    memset(buf, 3, sizeof(buf));
+    ASSERT_EQ(hscfs::write(fd, buf, sizeof(buf)), ssize_t(sizeof(buf)));
+    ASSERT_EQ(hscfs::fsync(fd), 0);
+
+    file_system_manager *fs_manager = file_system_manager::get_instance();
+    replace_protect_manager *rp_manager = fs_manager->get_replace_protect_manager();
+    {
+        std::lock_guard<std::mutex> lg(fs_manager->get_fs_meta_lock());
+        EXPECT_FALSE(rp_manager->is_ino_journal_pending(ino + 1000));
+        rp_manager->wait_ino_journal_applied_in_SSD(ino);
+        EXPECT_FALSE(rp_manager->is_ino_journal_pending(ino));
+
+        /* 事务已应用，SSD侧查询到的映射与主机一致 */
+        uint32_t lpa = file_mapping_util(fs_manager).get_addr_of_block(ino, 0).lpa;
+        EXPECT_NE(lpa, INVALID_LPA);
+    }
+    ASSERT_EQ(hscfs::close(fd), 0);
+}
+
+/* 文件a的事务未被SSD应用时，等待文件b的事务应用不受影响；a的事务应用后，a不再处于等待状态 */
+TEST(fsync_test, per_ino_journal_wait_unrelated)
+{
+    int fd_a = hscfs::open("/a/b/pa", O_RDWR | O_CREAT), fd_b = hscfs::open("/a/b/pb", O_RDWR | O_CREAT);
+    ASSERT_NE(fd_a, -1);
+    ASSERT_NE(fd_b, -1);
+    uint32_t ino_a = get_ino_of_fd(fd_a), ino_b = get_ino_of_fd(fd_b);
+    char buf[4096];
+    memset(buf, 5, sizeof(buf));
+    ASSERT_EQ(hscfs::write(fd_b, buf, sizeof(buf)), ssize_t(sizeof(buf)));
+    ASSERT_EQ(hscfs::fsync(fd_b), 0);
+
+    file_system_manager *fs_manager = file_system_manager::get_instance();
+    replace_protect_manager *rp_manager = fs_manager->get_replace_protect_manager();
+    rp_manager->wait_all_journal_applied_in_SSD();
+
+    /* 暂停应用日志，a的事务落盘后保持未应用 */
+    host_test_env_hold_journal_apply(true);
+    ASSERT_EQ(hscfs::write(fd_a, buf, sizeof(buf)), ssize_t(sizeof(buf)));
+    ASSERT_EQ(hscfs::fsync(fd_a), 0);
+    EXPECT_TRUE(rp_manager->is_ino_journal_pending(ino_a));
+    EXPECT_FALSE(rp_manager->is_ino_journal_pending(ino_b));
+
+    /* 等待b不应阻塞。若阻塞，超时后恢复应用日志，使等待线程能够退出 */
+    std::promise<void> b_waited;
+    std::future<void> b_waited_future = b_waited.get_future();
+    std::thread waiter([&]() {
+        std::lock_guard<std::mutex> lg(fs_manager->get_fs_meta_lock());
+        rp_manager->wait_ino_journal_applied_in_SSD(ino_b);
+        b_waited.set_value();
+    });
+    bool b_not_blocked = b_waited_future.wait_for(std::chrono::seconds(5)) == std::future_status::ready;
+    EXPECT_TRUE(b_not_blocked);
+    EXPECT_TRUE(rp_manager->is_ino_journal_pending(ino_a));
+    host_test_env_hold_journal_apply(false);
+    waiter.join();
+
+    {
+        std::lock_guard<std::mutex> lg(fs_manager->get_fs_meta_lock());
+        rp_manager->wait_ino_journal_applied_in_SSD(ino_a);
+        EXPECT_FALSE(rp_manager->is_ino_journal_pending(ino_a));
+    }
+    ASSERT_EQ(hscfs::close(fd_a), 0);
+    ASSERT_EQ(hscfs::close(fd_b), 0);
+}
+
+/* 多线程并发fsync不同的文件，组提交后数据均可读出，事务数不超过fsync次数 */
+TEST(fsync_test, group_commit)
+{
+    const int th_num = 4, fsync_per_thread = 8;
+    group_commit_stat before = file_system_manager::get_instance()->get_group_committer()->get_stat();
+
+    auto worker = [](int idx) {
+        std::string path = "/a/b/g" + std::to_string(idx);
+        int fd = hscfs::open(path.c_str(), O_RDWR | O_CREAT);
+        ASSERT_NE(fd, -1);
+        char buf[4096];
+        for (int i = 0; i < fsync_per_thread; ++i)
+        {
+            memset(buf, idx * fsync_per_thread + i, sizeof(buf));
+            ASSERT_EQ(hscfs::write(fd, buf, sizeof(buf)), ssize_t(sizeof(buf)));
+            ASSERT_EQ(hscfs::fsync(fd), 0);
+        }
+        ASSERT_EQ(hscfs::close(fd), 0);
+    };
+    std::vector<std::thread> ths;
+    for (int i = 0; i < th_num; ++i)
+        ths.emplace_back(worker, i);
+    for (auto &th : ths)
+        th.join();
+
+    group_commit_stat after = file_system_manager::get_instance()->get_group_committer()->get_stat();
+    uint64_t fsync_num = after.fsync_num - before.fsync_num, tx_num = after.tx_num - before.tx_num;
+    printf("%lu fsyncs in %lu transactions.\n", fsync_num, tx_num);
+    EXPECT_EQ(fsync_num, uint64_t(th_num * fsync_per_thread));
+    EXPECT_LE(tx_num, fsync_num);
+
+    for (int idx = 0; idx < th_num; ++idx)
+    {
+        std::string path = "/a/b/g" + std::to_string(idx);
+        int fd = hscfs::open(path.c_str(), O_RDONLY);
+        ASSERT_NE(fd, -1);
+        char buf[4096];
+        for (int i = 0; i < fsync_per_thread; ++i)
+        {
+            ASSERT_EQ(hscfs::read(fd, buf, sizeof(buf)), ssize_t(sizeof(buf)));
+            EXPECT_EQ(buf[0], char(idx * fsync_per_thread + i));
+        }
+        ASSERT_EQ(hscfs::close(fd), 0);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    host_test_env_setup();
+    ::testing::InitGoogleTest(&argc, argv);
+    int ret = RUN_ALL_TESTS();
+    host_test_env_teardown();
+    return ret;
+}
@@ -0,0 +1,179 @@
+#include "api/hscfs.hh"
+#include "fs/fs_manager.hh"
+#include "fs/super_manager.hh"
+#include "fs/segment_cleaner.hh"
+#include "fs/replace_protect.hh"
+#include "cache/super_cache.hh"
+#include "cache/SIT_NAT_cache.hh"
+#include "utils/lock_guards.hh"
+#include "gtest/gtest.h"
+#include "host_test_env.hh"
+#include <cstring>
+#include <random>
+#include <vector>
+
+/*
+ * segment清理测试
+ * 需要带空闲segment的镜像，运行前执行：./build_fs_image 16
+ * 主区域共18个segment，反复覆盖写并fsync文件，写入量远超主区域容量，依靠segment清理回收空间
+ */
+
+using namespace hscfs;
+
+static const uint32_t file_blks = 3072;
+static const uint32_t overwrite_num = 10000;
+static const uint32_t small_file_blks = 64;
+static const uint32_t overwrite_pass_num = 200;
+
+static uint32_t get_free_segment_count()
+{
+    file_system_manager *fs_manager = file_system_manager::get_instance();
+    std::lock_guard<std::mutex> lg(fs_manager->get_fs_meta_lock());
+    return fs_manager->get_super_manager()->get_free_segment_count();
+}
+
+static write_amp_stat get_write_amp_stat()
+{
+    file_system_manager *fs_manager = file_system_manager::get_instance();
+    std::lock_guard<std::mutex> lg(fs_manager->get_fs_meta_lock());
+    return fs_manager->get_super_manager()->get_write_amp_stat();
+}
+
+/* 空闲segment充足时，目录项写入hot活跃segment，fsync的文件数据写入warm活跃segment */
+TEST(gc_test, log_temperature)
+{
+    write_amp_stat before = get_write_amp_stat();
+
+    int fd = hscfs::open("/a/b/temp", O_RDWR | O_CREAT);
+    ASSERT_NE(fd, -1);
+    char buf[4096];
+    memset(buf, 'x', sizeof(buf));
+    ASSERT_EQ(hscfs::write(fd, buf, sizeof(buf)), ssize_t(sizeof(buf)));
+    ASSERT_EQ(hscfs::fsync(fd), 0);
+    ASSERT_EQ(hscfs::close(fd), 0);
+
+    write_amp_stat after = get_write_amp_stat();
+    EXPECT_GT(after.data_blks[uint32_t(log_temp::hot)], before.data_blks[uint32_t(log_temp::hot)]);
+    EXPECT_GT(after.data_blks[uint32_t(log_temp::warm)], before.data_blks[uint32_t(log_temp::warm)]);
+    EXPECT_EQ(after.user_blks, before.user_blks + 1);
+    EXPECT_GT(after.get_write_amplification(), 1.0);
+}
+
+/* 随机覆盖写一个占据主区域约1/3空间的文件，segment中总有剩余的有效块，需要迁移清理 */
+TEST(gc_test, overwrite_and_fsync)
+{
+    ASSERT_GT(get_free_segment_count(), 0U) << "run ./build_fs_image 16 first.";
+
+    int fd = hscfs::open("/a/b/gc", O_RDWR | O_CREAT);
+    ASSERT_NE(fd, -1);
+
+    /* 每个块的内容为其最近一次写入的序号 */
+    std::vector<uint32_t> expect(file_blks, 0);
+    char buf[4096];
+    memset(buf, 0, sizeof(buf));
+    for (uint32_t i = 0; i < file_blks; ++i)
+        ASSERT_EQ(hscfs::write(fd, buf, sizeof(buf)), ssize_t(sizeof(buf)));
+    ASSERT_EQ(hscfs::fsync(fd), 0);
+
+    std::mt19937 rng(2024);
+    for (uint32_t seq = 1; seq <= overwrite_num; ++seq)
+    {
+        uint32_t blk = rng() % file_blks;
+        memset(buf, 0, sizeof(buf));
+        memcpy(buf, &seq, sizeof(seq));
+        ASSERT_EQ(hscfs::lseek(fd, blk * 4096, SEEK_SET), off_t(blk * 4096));
+        ASSERT_EQ(hscfs::write(fd, buf, sizeof(buf)), ssize_t(sizeof(buf))) << "seq: " << seq;
+        ASSERT_EQ(hscfs::fsync(fd), 0) << "seq: " << seq << ", errno: " << errno;
+        expect[blk] = seq;
+    }
+
+    gc_stat stat = file_system_manager::get_instance()->get_segment_cleaner()->get_stat();
+    EXPECT_GT(stat.victim_num, 0U);
+    EXPECT_GT(stat.migrated_blocks, 0U);
+
+    /* 关闭后重新打开，从SSD读出所有块进行检查 */
+    ASSERT_EQ(hscfs::close(fd), 0);
+    fd = hscfs::open("/a/b/gc", O_RDWR);
+    ASSERT_NE(fd, -1);
+    for (uint32_t blk = 0; blk < file_blks; ++blk)
+    {
+        uint32_t seq;
+        ASSERT_EQ(hscfs::read(fd, buf, sizeof(buf)), ssize_t(sizeof(buf)));
+        memcpy(&seq, buf, sizeof(seq));
+        EXPECT_EQ(seq, expect[blk]) << "blk: " << blk;
+    }
+    ASSERT_EQ(hscfs::close(fd), 0);
+
+    /* 初始文件不受清理影响 */
+    fd = hscfs::open("/a/b/c", O_RDONLY);
+    ASSERT_NE(fd, -1);
+    memset(buf, 0, sizeof(buf));
+    ASSERT_GT(hscfs::read(fd, buf, sizeof(buf)), 0);
+    EXPECT_STREQ(buf, "hello hscfs!");
+    ASSERT_EQ(hscfs::close(fd), 0);
+}
+
+/* 顺序覆盖写整个文件，写入量超过主区域容量。旧segment中的块全部失效，不需要迁移即可回收 */
+TEST(gc_test, reclaim_empty)
+{
+    gc_stat before = file_system_manager::get_instance()->get_segment_cleaner()->get_stat();
+
+    int fd = hscfs::open("/a/b/gc_small", O_RDWR | O_CREAT);
+    ASSERT_NE(fd, -1);
+    char buf[4096];
+    for (uint32_t pass = 1; pass <= overwrite_pass_num; ++pass)
+    {
+        ASSERT_EQ(hscfs::lseek(fd, 0, SEEK_SET), 0);
+        for (uint32_t blk = 0; blk < small_file_blks; ++blk)
+        {
+            memset(buf, 0, sizeof(buf));
+            memcpy(buf, &pass, sizeof(pass));
+            ASSERT_EQ(hscfs::write(fd, buf, sizeof(buf)), ssize_t(sizeof(buf))) << "pass: " << pass;
+        }
+        ASSERT_EQ(hscfs::fsync(fd), 0) << "pass: " << pass << ", errno: " << errno;
+    }
+
+    gc_stat after = file_system_manager::get_instance()->get_segment_cleaner()->get_stat();
+    EXPECT_GT(after.reclaimed_num, before.reclaimed_num);
+
+    ASSERT_EQ(hscfs::close(fd), 0);
+    fd = hscfs::open("/a/b/gc_small", O_RDONLY);
+    ASSERT_NE(fd, -1);
+    for (uint32_t blk = 0; blk < small_file_blks; ++blk)
+    {
+        uint32_t pass;
+        ASSERT_EQ(hscfs::read(fd, buf, sizeof(buf)), ssize_t(sizeof(buf)));
+        memcpy(&pass, buf, sizeof(pass));
+        EXPECT_EQ(pass, overwrite_pass_num) << "blk: " << blk;
+    }
+    ASSERT_EQ(hscfs::close(fd), 0);
+}
+
+/* 
+ * segment清理过程中记录的SIT日志都增加了主机侧版本号，事务在SSD应用后被逐一抵消
+ * 回写所有脏数据并等待淘汰保护完成后，SIT/NAT缓存项的引用计数应全部归零
+ */
+TEST(gc_test, sit_nat_refcount_balanced)
+{
+    file_system_manager *fs_manager = file_system_manager::get_instance();
+    rwlock_guard fs_freeze_lg(fs_manager->get_fs_freeze_lock(), rwlock_guard::lock_type::wrlock);
+    fs_manager->write_back_all_dirty_sync();
+    fs_manager->get_replace_protect_manager()->wait_all_protect_task_cplt();
+
+    super_cache &super = *fs_manager->get_super_cache();
+    uint32_t sit_start = super->sit_blkaddr, sit_end = sit_start + super->segment_count_sit * BLOCK_PER_SEGMENT;
+    for (uint32_t lpa = sit_start; lpa < sit_end; ++lpa)
+        EXPECT_EQ(fs_manager->get_sit_cache()->get_refcount(lpa), 0U) << "SIT lpa: " << lpa;
+    uint32_t nat_start = super->nat_blkaddr, nat_end = nat_start + super->segment_count_nat * BLOCK_PER_SEGMENT;
+    for (uint32_t lpa = nat_start; lpa < nat_end; ++lpa)
+        EXPECT_EQ(fs_manager->get_nat_cache()->get_refcount(lpa), 0U) << "NAT lpa: " << lpa;
+}
+
+int main(int argc, char **argv)
+{
+    host_test_env_setup();
+    ::testing::InitGoogleTest(&argc, argv);
+    int ret = RUN_ALL_TESTS();
+    host_test_env_teardown();
+    return ret;
+}
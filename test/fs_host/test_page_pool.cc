@@ -0,0 +1,140 @@
+#include "cache/page_cache.hh"
+#include "gtest/gtest.h"
+
+#include <new>
+
+using namespace hscfs;
+
+/* 预算用完后，置换所有文件中最久未访问的page，且按文件统计页数 */
+TEST(page_pool_test, global_replace)
+{
+    page_pool pool(4 * 4096);
+    {
+        page_cache a(&pool), b(&pool);
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            page_entry_handle page = a.get(i);
+            page->set_state(page_state::ready);
+        }
+        ASSERT_EQ(pool.get_cur_pages(), 4);
+
+        /* b的page置换a中最久未访问的0、1号page */
+        for (uint32_t i = 0; i < 2; ++i)
+            b.get(i);
+        ASSERT_EQ(pool.get_cur_pages(), 4);
+        ASSERT_EQ(a.get_page_num(), 2);
+        ASSERT_EQ(b.get_page_num(), 2);
+
+        ASSERT_EQ(a.get(2)->get_state(), page_state::ready);
+        ASSERT_EQ(a.get(3)->get_state(), page_state::ready);
+        ASSERT_EQ(a.get(0)->get_state(), page_state::invalid);
+        ASSERT_EQ(pool.get_cur_pages(), 4);
+    }
+    ASSERT_EQ(pool.get_cur_pages(), 0);
+}
+
+/* 被引用的page和dirty page不能被置换，暂时超出预算，可置换后回到预算内 */
+TEST(page_pool_test, pinned_and_dirty)
+{
+    page_pool pool(2 * 4096);
+    page_cache a(&pool);
+    {
+        page_cache b(&pool);
+        page_entry_handle a0 = a.get(0);
+        a.get(1).mark_dirty();
+        {
+            page_entry_handle b0 = b.get(0), b1 = b.get(1);
+            ASSERT_EQ(pool.get_cur_pages(), 4);
+        }
+
+        /* b2复用b0，然后b1也被置换，a的page都无法置换 */
+        page_entry_handle b2 = b.get(2);
+        ASSERT_EQ(pool.get_cur_pages(), 3);
+        ASSERT_EQ(a.get_page_num(), 2);
+        ASSERT_EQ(b.get_page_num(), 1);
+    }
+    ASSERT_EQ(pool.get_cur_pages(), 2);
+
+    a.clear_dirty_pages();
+    a.get(2);
+    ASSERT_EQ(pool.get_cur_pages(), 2);
+    ASSERT_EQ(a.get_page_num(), 2);
+}
+
+/* 截断后，范围外的干净page也应当无效 */
+TEST(page_pool_test, truncate)
+{
+    page_pool pool(4 * 4096);
+    page_cache a(&pool);
+    a.get(0)->set_state(page_state::ready);
+    a.get(1)->set_state(page_state::ready);
+    a.truncate(1);
+    ASSERT_EQ(a.get(0)->get_state(), page_state::ready);
+    ASSERT_EQ(a.get(1)->get_state(), page_state::invalid);
+
+    /* 截断为空文件时，所有page都应当无效 */
+    a.truncate(0);
+    ASSERT_EQ(a.get(0)->get_state(), page_state::invalid);
+}
+
+/* 零页共享全0块，不分配块缓存区，引用计数减为0时被移除；首次获取块缓存区时写时复制 */
+TEST(page_pool_test, zero_page)
+{
+    page_pool pool(4 * 4096);
+    page_cache a(&pool);
+    {
+        page_entry_handle page = a.get(0);
+        page->set_zero_page();
+        ASSERT_EQ(page->get_state(), page_state::ready);
+        ASSERT_TRUE(page->is_zero_page());
+        for (size_t i = 0; i < 4096; ++i)
+            ASSERT_EQ(page->get_content_ptr()[i], 0);
+        ASSERT_EQ(a.get_page_num(), 1);
+    }
+    ASSERT_EQ(a.get_page_num(), 0);
+    ASSERT_EQ(pool.get_cur_pages(), 0);
+
+    {
+        page_entry_handle page = a.get(1);
+        page->set_zero_page();
+        char *buf = page->get_page_buffer().get_ptr();
+        ASSERT_FALSE(page->is_zero_page());
+        for (size_t i = 0; i < 4096; ++i)
+            ASSERT_EQ(buf[i], 0);
+        buf[0] = 'x';
+        ASSERT_EQ(page->get_content_ptr()[0], 'x');
+    }
+    ASSERT_EQ(a.get_page_num(), 1);
+    ASSERT_EQ(a.get(1)->get_content_ptr()[0], 'x');
+}
+
+/* page_cache释放后地址被新文件复用，幽灵队列中残留的旧文件key不应使新文件的page进入热队列 */
+TEST(page_pool_test, ghost_key_not_aliased)
+{
+    page_pool pool(4 * 4096);
+    page_cache b(&pool);
+    alignas(page_cache) unsigned char storage[sizeof(page_cache)];
+
+    /* a的page被b的page置换，进入幽灵队列 */
+    page_cache *a = new (storage) page_cache(&pool);
+    for (uint32_t i = 0; i < 4; ++i)
+        a->get(i);
+    for (uint32_t i = 0; i < 4; ++i)
+        b.get(i);
+    ASSERT_EQ(a->get_page_num(), 0);
+    a->~page_cache();
+
+    /* c复用a的地址，它的3号page是新page，应当与b的page一样按进入顺序被置换 */
+    page_cache *c = new (storage) page_cache(&pool);
+    c->get(3);
+    for (uint32_t i = 4; i < 8; ++i)
+        b.get(i);
+    ASSERT_EQ(c->get_page_num(), 0);
+    c->~page_cache();
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -1,7 +1,9 @@
 #include "api/hscfs.hh"
+#include "cache/dma_block_pool.hh"
 #include "gtest/gtest.h"
 #include "host_test_env.hh"
 #include <cstring>
+#include <vector>
 
 TEST(read_test, 1)
 {
@@ -20,6 +22,119 @@ TEST(read_test, 1)
         do_exit("close failed");
 }
 
+/* 向path写入block_num个块，第i块的内容全部为i，分批fsync使写入的page能被置换出page cache */
+static void write_test_file(const char *path, size_t block_num)
+{
+    const size_t fsync_interval = 8;
+    int fd = hscfs::open(path, O_RDWR | O_CREAT);
+    if (fd == -1)
+        do_exit("open failed");
+
+    char buf[4096];
+    for (size_t i = 0; i < block_num; ++i)
+    {
+        memset(buf, static_cast<int>(i & 0xFF), sizeof(buf));
+        ASSERT_EQ(hscfs::write(fd, buf, sizeof(buf)), ssize_t(sizeof(buf)));
+        if ((i + 1) % fsync_interval == 0)
+        {
+            ASSERT_EQ(hscfs::fsync(fd), 0);
+        }
+    }
+
+    if (hscfs::close(fd) != 0)
+        do_exit("close failed");
+}
+
+/* 顺序读一个远大于page cache的文件，读过程中会触发预读 */
+TEST(read_test, sequential)
+{
+    const size_t block_num = 128;
+    const ssize_t chunk_size = 1000;  // 不与块对齐，覆盖读跨越page边界的情况
+
+    write_test_file("/a/b/seq", block_num);
+    int fd = hscfs::open("/a/b/seq", O_RDONLY);
+    if (fd == -1)
+        do_exit("open failed");
+
+    size_t pos = 0;
+    while (true)
+    {
+        char rd_buf[chunk_size];
+        ssize_t ret = hscfs::read(fd, rd_buf, chunk_size);
+        ASSERT_GE(ret, 0);
+        if (ret == 0)
+            break;
+        for (ssize_t i = 0; i < ret; ++i, ++pos)
+        {
+            ASSERT_EQ(rd_buf[i], static_cast<char>((pos / 4096) & 0xFF));
+        }
+    }
+    EXPECT_EQ(pos, block_num * 4096);
+
+    if (hscfs::close(fd) != 0)
+        do_exit("close failed");
+}
+
+/* 一次读取多个不在page cache中的page，这些page将被批量并发读取 */
+TEST(read_test, large_read)
+{
+    const size_t block_num = 64;
+    const size_t read_off = 100;  // 不与块对齐
+
+    write_test_file("/a/b/large", block_num);
+    int fd = hscfs::open("/a/b/large", O_RDONLY);
+    if (fd == -1)
+        do_exit("open failed");
+
+    std::vector<char> rd_buf(block_num * 4096);
+    ASSERT_EQ(hscfs::lseek(fd, read_off, SEEK_SET), off_t(read_off));
+    ssize_t ret = hscfs::read(fd, rd_buf.data(), rd_buf.size());
+    ASSERT_EQ(ret, ssize_t(rd_buf.size() - read_off));
+    for (ssize_t i = 0; i < ret; ++i)
+    {
+        ASSERT_EQ(rd_buf[i], static_cast<char>(((i + read_off) / 4096) & 0xFF));
+    }
+
+    if (hscfs::close(fd) != 0)
+        do_exit("close failed");
+}
+
+/* 读稀疏文件的空洞，内容为0且不分配块缓存区；之后写入空洞中的page时才分配 */
+TEST(read_test, sparse_read)
+{
+    const size_t hole_blks = 64;
+    int fd = hscfs::open("/a/b/sparse", O_RDWR | O_CREAT);
+    if (fd == -1)
+        do_exit("open failed");
+
+    char buf[4096];
+    memset(buf, 'x', sizeof(buf));
+    ASSERT_EQ(hscfs::lseek(fd, hole_blks * 4096, SEEK_SET), off_t(hole_blks * 4096));
+    ASSERT_EQ(hscfs::write(fd, buf, sizeof(buf)), ssize_t(sizeof(buf)));
+    ASSERT_EQ(hscfs::fsync(fd), 0);
+
+    hscfs::dma_block_pool_stat before = hscfs::dma_block_pool::get_instance()->get_stat();
+    std::vector<char> rd_buf((hole_blks + 1) * 4096, 'y');
+    ASSERT_EQ(hscfs::lseek(fd, 0, SEEK_SET), 0);
+    ASSERT_EQ(hscfs::read(fd, rd_buf.data(), rd_buf.size()), ssize_t(rd_buf.size()));
+    hscfs::dma_block_pool_stat after = hscfs::dma_block_pool::get_instance()->get_stat();
+    for (size_t i = 0; i < hole_blks * 4096; ++i)
+        ASSERT_EQ(rd_buf[i], 0) << "offset: " << i;
+    EXPECT_EQ(memcmp(rd_buf.data() + hole_blks * 4096, buf, sizeof(buf)), 0);
+    EXPECT_LT(after.alloc_num - before.alloc_num, hole_blks / 8);
+
+    /* 写入空洞中的一个page的一部分，其余部分仍为0 */
+    ASSERT_EQ(hscfs::lseek(fd, 4096 + 100, SEEK_SET), off_t(4096 + 100));
+    ASSERT_EQ(hscfs::write(fd, buf, 10), 10);
+    ASSERT_EQ(hscfs::lseek(fd, 4096, SEEK_SET), off_t(4096));
+    ASSERT_EQ(hscfs::read(fd, rd_buf.data(), 4096), 4096);
+    for (size_t i = 0; i < 4096; ++i)
+        ASSERT_EQ(rd_buf[i], i >= 100 && i < 110 ? 'x' : 0) << "offset: " << i;
+
+    if (hscfs::close(fd) != 0)
+        do_exit("close failed");
+}
+
 int main(int argc, char **argv)
 {
     host_test_env_setup();
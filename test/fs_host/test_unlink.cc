@@ -1,6 +1,144 @@
 #include "api/hscfs.hh"
+#include "cache/node_block_cache.hh"
+#include "cache/dir_data_block_cache.hh"
+#include "fs/fs_manager.hh"
+#include "fs/lookup_policy.hh"
 #include "gtest/gtest.h"
 #include "host_test_env.hh"
+#include <cstring>
+#include <string>
+
+using namespace hscfs;
+
+/* 镜像中根目录和/a/b的inode号为2和4，目录项c在/a/b的第0个数据块中 */
+static const uint32_t root_ino = 2;
+static const uint32_t dir_b_ino = 4;
+
+/* SSD路径查找返回的父目录数据块和node被加入缓存，之后unlink或create不需要再从SSD读取它们 */
+TEST(unlink_test, lookup_caches_dir_pages)
+{
+    file_system_manager *fs_manager = file_system_manager::get_instance();
+    fs_manager->get_lookup_policy()->set_mode(lookup_mode::ssd);
+    {
+        std::lock_guard<std::mutex> lg(fs_manager->get_fs_meta_lock());
+        ASSERT_TRUE(fs_manager->get_node_cache()->get(dir_b_ino).is_empty());
+        ASSERT_TRUE(fs_manager->get_dir_data_cache()->get(dir_b_ino, 0).is_empty());
+    }
+
+    int fd = hscfs::open("/a/b/c", O_RDONLY);
+    ASSERT_NE(fd, -1);
+    {
+        std::lock_guard<std::mutex> lg(fs_manager->get_fs_meta_lock());
+        EXPECT_FALSE(fs_manager->get_node_cache()->get(dir_b_ino).is_empty());
+        EXPECT_FALSE(fs_manager->get_dir_data_cache()->get(dir_b_ino, 0).is_empty());
+    }
+    ASSERT_EQ(hscfs::close(fd), 0);
+
+    /* 查找不命中时，SSD返回插入位置所在的父目录块，随后创建目标不需要再同步读取它们 */
+    {
+        std::lock_guard<std::mutex> lg(fs_manager->get_fs_meta_lock());
+        ASSERT_TRUE(fs_manager->get_dir_data_cache()->get(root_ino, 0).is_empty());
+    }
+    uint64_t read_cmds = host_test_env_get_read_cmd_num();
+    fd = hscfs::open("/new_after_miss", O_RDWR | O_CREAT);
+    ASSERT_NE(fd, -1);
+    EXPECT_EQ(host_test_env_get_read_cmd_num(), read_cmds);
+    {
+        std::lock_guard<std::mutex> lg(fs_manager->get_fs_meta_lock());
+        EXPECT_FALSE(fs_manager->get_dir_data_cache()->get(root_ino, 0).is_empty());
+    }
+    ASSERT_EQ(hscfs::close(fd), 0);
+    fs_manager->get_lookup_policy()->set_mode(lookup_mode::adaptive);
+}
+
+/* 在新建还未写回的目录下查找不命中时，在主机侧完成查找，不回写元数据 */
+TEST(unlink_test, lookup_in_new_dir)
+{
+    uint64_t write_cmds = host_test_env_get_write_cmd_num();
+    ASSERT_EQ(hscfs::mkdir("/a/n1"), 0);
+    ASSERT_EQ(hscfs::mkdir("/a/n1/n2"), 0);
+    int fd = hscfs::open("/a/n1/n2/f", O_RDWR | O_CREAT);
+    ASSERT_NE(fd, -1);
+    ASSERT_EQ(hscfs::close(fd), 0);
+    ASSERT_EQ(hscfs::unlink("/a/n1/n2/g"), -1);
+    EXPECT_EQ(errno, ENOENT);
+    EXPECT_EQ(host_test_env_get_write_cmd_num(), write_cmds);
+
+    ASSERT_EQ(hscfs::unlink("/a/n1/n2/f"), 0);
+    ASSERT_EQ(hscfs::unlink("/a/n1/n2/f"), -1);
+    EXPECT_EQ(errno, ENOENT);
+}
+
+static lookup_policy_stat get_lookup_policy_stat()
+{
+    file_system_manager *fs_manager = file_system_manager::get_instance();
+    std::lock_guard<std::mutex> lg(fs_manager->get_fs_meta_lock());
+    return fs_manager->get_lookup_policy()->get_stat();
+}
+
+/* 可强制在主机侧查找或交给SSD；自适应模式下，父目录的块都在缓存中时在主机侧查找 */
+TEST(unlink_test, lookup_policy_mode)
+{
+    lookup_policy *policy = file_system_manager::get_instance()->get_lookup_policy();
+    const char *modes[] = {"ssd", "host", "adaptive"};
+    for (const char *mode : modes)
+    {
+        if (strcmp(mode, "ssd") == 0)
+            policy->set_mode(lookup_mode::ssd);
+        else if (strcmp(mode, "host") == 0)
+            policy->set_mode(lookup_mode::host);
+        else
+            policy->set_mode(lookup_mode::adaptive);
+
+        lookup_policy_stat before = get_lookup_policy_stat();
+        std::string path = std::string("/a/b/none_") + mode;
+        ASSERT_EQ(hscfs::open(path.c_str(), O_RDONLY), -1);
+        EXPECT_EQ(errno, ENOENT);
+        lookup_policy_stat after = get_lookup_policy_stat();
+
+        bool expect_host = strcmp(mode, "ssd") != 0;
+        EXPECT_EQ(after.host_path_num - before.host_path_num, expect_host ? 1U : 0U) << mode;
+        EXPECT_EQ(after.ssd_path_num - before.ssd_path_num, expect_host ? 0U : 1U) << mode;
+    }
+
+    /* 主机侧查找得到的创建位置可以直接使用 */
+    policy->set_mode(lookup_mode::host);
+    int fd = hscfs::open("/a/b/created_on_host", O_RDWR | O_CREAT);
+    ASSERT_NE(fd, -1);
+    ASSERT_EQ(hscfs::close(fd), 0);
+    fd = hscfs::open("/a/b/created_on_host", O_RDONLY);
+    ASSERT_NE(fd, -1);
+    ASSERT_EQ(hscfs::close(fd), 0);
+    ASSERT_EQ(hscfs::unlink("/a/b/created_on_host"), 0);
+    policy->set_mode(lookup_mode::adaptive);
+}
+
+/* 批量解析路径，不命中的路径同时交给SSD，结果加入目录项缓存 */
+TEST(unlink_test, batch_lookup)
+{
+    file_system_manager *fs_manager = file_system_manager::get_instance();
+    fs_manager->get_lookup_policy()->set_mode(lookup_mode::ssd);
+    const char *paths[] = {"/a/b/none1", "/a/b/c", "/a/none2/x", "/a/b/c/d", "/a/b/none3"};
+    const size_t num = sizeof(paths) / sizeof(paths[0]);
+    bool exist[num];
+
+    lookup_policy_stat before = get_lookup_policy_stat();
+    ASSERT_EQ(hscfs::lookup_paths(paths, num, exist), 0);
+    lookup_policy_stat after = get_lookup_policy_stat();
+    EXPECT_FALSE(exist[0]);
+    EXPECT_TRUE(exist[1]);
+    EXPECT_FALSE(exist[2]);
+    EXPECT_FALSE(exist[3]);
+    EXPECT_FALSE(exist[4]);
+
+    /* /a/b/c已在目录项缓存中，/a/b/c/d在主机侧即可判断不存在，其余3个路径交给SSD */
+    EXPECT_EQ(after.ssd_path_num - before.ssd_path_num, 3U);
+
+    const char *invalid_paths[] = {"/a/b/c", "a/b"};
+    EXPECT_EQ(hscfs::lookup_paths(invalid_paths, 2), -1);
+    EXPECT_EQ(errno, EINVAL);
+    fs_manager->get_lookup_policy()->set_mode(lookup_mode::adaptive);
+}
 
 TEST(unlink_test, 1)
 {
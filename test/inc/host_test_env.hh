@@ -1,5 +1,16 @@
 #pragma once
 
+#include <cstdint>
+
 void host_test_env_setup();
 void host_test_env_teardown();
+
+/* 模拟的SSD收到的读写命令中，写命令的个数 */
+uint64_t host_test_env_get_write_cmd_num();
+
+/* 模拟的SSD收到的读写命令中，读命令的个数 */
+uint64_t host_test_env_get_read_cmd_num();
+
+/* hold为true时，模拟的SSD暂停应用日志(不推进日志头指针)，已提交的事务保持未应用状态，直到以false调用 */
+void host_test_env_hold_journal_apply(bool hold);
 void do_exit(const char *msg);
\ No newline at end of file